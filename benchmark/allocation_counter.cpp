@@ -0,0 +1,50 @@
+/*
+ * allocation_counter.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include "allocation_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace afsm {
+namespace bench {
+
+namespace {
+
+thread_local ::std::size_t allocations = 0;
+
+}  /* namespace  */
+
+::std::size_t
+allocation_count() noexcept
+{
+    return allocations;
+}
+
+}  /* namespace bench */
+}  /* namespace afsm */
+
+void*
+operator new(::std::size_t size)
+{
+    ++::afsm::bench::allocations;
+    if (auto p = ::std::malloc(size ? size : 1))
+        return p;
+    throw ::std::bad_alloc{};
+}
+
+void
+operator delete(void* p) noexcept
+{
+    ::std::free(p);
+}
+
+void
+operator delete(void* p, ::std::size_t) noexcept
+{
+    ::std::free(p);
+}
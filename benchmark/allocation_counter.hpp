@@ -0,0 +1,50 @@
+/*
+ * allocation_counter.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_BENCHMARK_ALLOCATION_COUNTER_HPP_
+#define AFSM_BENCHMARK_ALLOCATION_COUNTER_HPP_
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+
+namespace afsm {
+namespace bench {
+
+/**
+ * Number of calls to global operator new made by the current thread
+ */
+::std::size_t
+allocation_count() noexcept;
+
+/**
+ * Counts allocations made by the benchmark loop and reports them
+ * as allocs/event. Each benchmark iteration is expected to process
+ * exactly one event, so the reported time is also per event.
+ */
+class allocation_counter {
+public:
+    explicit
+    allocation_counter(::benchmark::State& state)
+        : state_(state), start_{allocation_count()} {}
+
+    void
+    report()
+    {
+        state_.counters["allocs/event"] = ::benchmark::Counter(
+                static_cast<double>(allocation_count() - start_),
+                ::benchmark::Counter::kAvgIterations);
+        state_.SetItemsProcessed(state_.iterations());
+    }
+private:
+    ::benchmark::State& state_;
+    ::std::size_t       start_;
+};
+
+}  /* namespace bench */
+}  /* namespace afsm */
+
+#endif /* AFSM_BENCHMARK_ALLOCATION_COUNTER_HPP_ */
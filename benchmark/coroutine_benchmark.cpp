@@ -0,0 +1,82 @@
+/*
+ * coroutine_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/coroutine.hpp>
+
+#ifdef AFSM_HAS_COROUTINES
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct tick {};
+
+}  /* namespace events */
+
+struct submit_fsm_def : def::state_machine<submit_fsm_def> {
+    struct a : state<a> {};
+    struct b : state<b> {};
+    using initial_state = a;
+    using transitions = transition_table<
+        tr< a,  events::tick,   b >,
+        tr< b,  events::tick,   a >
+    >;
+};
+
+using submit_fsm = state_machine<submit_fsm_def>;
+
+void
+SyncSubmit(::benchmark::State& state)
+{
+    submit_fsm fsm;
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::tick{}));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void
+CompletionHandlerSubmit(::benchmark::State& state)
+{
+    submit_fsm fsm;
+    while (state.KeepRunning()) {
+        fsm.process_event(events::tick{},
+            [](actions::event_process_result res)
+            {
+                ::benchmark::DoNotOptimize(res);
+            });
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+task<>
+submit_loop(submit_fsm& fsm, ::benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(co_await co_process_event(fsm, events::tick{}));
+    }
+}
+
+void
+CoroutineSubmit(::benchmark::State& state)
+{
+    submit_fsm fsm;
+    submit_loop(fsm, state).get();
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(SyncSubmit);
+BENCHMARK(CompletionHandlerSubmit);
+BENCHMARK(CoroutineSubmit);
+
+}  /* namespace bench */
+}  /* namespace afsm */
+
+#endif /* AFSM_HAS_COROUTINES */
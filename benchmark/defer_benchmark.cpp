@@ -45,11 +45,13 @@ struct defer_fsm_def : ::afsm::def::state_machine_def<defer_fsm_def> {
 };
 
 using defer_fsm = ::afsm::state_machine<defer_fsm_def>;
+using priority_defer_fsm = ::afsm::priority_state_machine<defer_fsm_def>;
 
 namespace {
 
+template < typename FSM >
 void
-enqueue_events(defer_fsm& fsm, int n)
+enqueue_events(FSM& fsm, int n)
 {
     for (int i = 0; i < n; ++i) {
         fsm.process_event(events::a_to_b{});
@@ -88,12 +90,13 @@ DeferEnqueue(::benchmark::State& state)
     }
 }
 
+template < typename FSM >
 void
 DeferIgnore(::benchmark::State& state)
 {
     while(state.KeepRunning()) {
         state.PauseTiming();
-        defer_fsm fsm;
+        FSM fsm;
         fsm.process_event(events::a_to_b{});
         // Enqueue N events
         enqueue_events(fsm, state.range(0));
@@ -103,12 +106,13 @@ DeferIgnore(::benchmark::State& state)
     state.SetComplexityN(state.range(0));
 }
 
+template < typename FSM >
 void
 DeferProcessOne(::benchmark::State& state)
 {
     while(state.KeepRunning()) {
         state.PauseTiming();
-        defer_fsm fsm;
+        FSM fsm;
         fsm.process_event(events::a_to_b{});
         // Enqueue N events
         enqueue_events(fsm, state.range(0));
@@ -121,8 +125,10 @@ DeferProcessOne(::benchmark::State& state)
 BENCHMARK(DeferNoDefer);
 BENCHMARK(DeferReject);
 BENCHMARK(DeferEnqueue);
-BENCHMARK(DeferIgnore)->RangeMultiplier(10)->Range(1, 100000)->Complexity();
-BENCHMARK(DeferProcessOne)->RangeMultiplier(10)->Range(1, 100000)->Complexity();
+BENCHMARK_TEMPLATE(DeferIgnore, defer_fsm)->RangeMultiplier(10)->Range(1, 100000)->Complexity();
+BENCHMARK_TEMPLATE(DeferProcessOne, defer_fsm)->RangeMultiplier(10)->Range(1, 100000)->Complexity();
+BENCHMARK_TEMPLATE(DeferIgnore, priority_defer_fsm)->RangeMultiplier(10)->Range(1, 100000)->Complexity();
+BENCHMARK_TEMPLATE(DeferProcessOne, priority_defer_fsm)->RangeMultiplier(10)->Range(1, 100000)->Complexity();
 
 }  /* namespace bench */
 }  /* namespace afsm */
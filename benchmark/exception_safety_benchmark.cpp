@@ -0,0 +1,71 @@
+/*
+ * exception_safety_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fsm.hpp>
+#include <vector>
+
+#include "allocation_counter.hpp"
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct flip {};
+
+}  /* namespace events */
+
+/**
+ * State with data that is expensive to copy
+ */
+template < typename T, bool Nothrow >
+struct heavy_state : def::state<T> {
+    template < typename Event, typename FSM >
+    void
+    on_enter(Event&&, FSM&) noexcept(Nothrow)
+    { ++visits; }
+
+    ::std::vector<int> data = ::std::vector<int>(256);
+    ::std::size_t visits{0};
+};
+
+template < bool Nothrow >
+struct heavy_a : heavy_state<heavy_a<Nothrow>, Nothrow>, def::tags::no_state_reset {};
+template < bool Nothrow >
+struct heavy_b : heavy_state<heavy_b<Nothrow>, Nothrow>, def::tags::no_state_reset {};
+
+template < typename SafetyTag, bool Nothrow >
+struct safety_fsm_def : def::state_machine_def< safety_fsm_def<SafetyTag, Nothrow>, SafetyTag > {
+    using initial_state = heavy_a<Nothrow>;
+    using transitions = def::transition_table<
+        def::transition< heavy_a<Nothrow>, events::flip, heavy_b<Nothrow> >,
+        def::transition< heavy_b<Nothrow>, events::flip, heavy_a<Nothrow> >
+    >;
+};
+
+template < typename SafetyTag, bool Nothrow >
+void
+ExceptionSafety(::benchmark::State& state)
+{
+    state_machine< safety_fsm_def<SafetyTag, Nothrow> > fsm;
+    allocation_counter allocs{state};
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::flip{}));
+    }
+    allocs.report();
+}
+
+BENCHMARK_TEMPLATE(ExceptionSafety, def::tags::basic_exception_safety, false);
+BENCHMARK_TEMPLATE(ExceptionSafety, def::tags::strong_exception_safety, false);
+BENCHMARK_TEMPLATE(ExceptionSafety, def::tags::nothrow_guarantee, false);
+BENCHMARK_TEMPLATE(ExceptionSafety, def::tags::strong_exception_safety, true);
+BENCHMARK_TEMPLATE(ExceptionSafety, def::tags::nothrow_guarantee, true);
+
+}  /* namespace bench */
+}  /* namespace afsm */
@@ -0,0 +1,60 @@
+/*
+ * executor_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/executor.hpp>
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct tick {};
+
+}  /* namespace events */
+
+struct session_fsm_def : def::state_machine<session_fsm_def> {
+    struct a : state<a> {};
+    struct b : state<b> {};
+    using initial_state = a;
+    using transitions = transition_table<
+        tr< a,  events::tick,   b >,
+        tr< b,  events::tick,   a >
+    >;
+};
+
+using session_executor = executor< state_machine<session_fsm_def> >;
+
+::std::size_t const machine_count = 1000000;
+
+/**
+ * One event is posted to each of the machines per iteration, the argument
+ * is the number of worker threads.
+ */
+void
+ExecutorScaling(::benchmark::State& state)
+{
+    session_executor exec{ static_cast<::std::size_t>(state.range(0)) };
+    for (::std::size_t i = 0; i < machine_count; ++i)
+        exec.spawn(i);
+    exec.wait_idle();
+
+    while (state.KeepRunning()) {
+        for (::std::size_t i = 0; i < machine_count; ++i)
+            exec.post(i, events::tick{});
+        exec.wait_idle();
+    }
+    state.SetItemsProcessed(state.iterations() * machine_count);
+}
+
+BENCHMARK(ExecutorScaling)
+    ->RangeMultiplier(2)->Range(1, session_executor::default_workers())
+    ->Unit(::benchmark::kMillisecond)->UseRealTime();
+
+}  /* namespace bench */
+}  /* namespace afsm */
@@ -0,0 +1,299 @@
+/*
+ * feature_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fsm.hpp>
+#include <utility>
+
+#include "allocation_counter.hpp"
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct tick {};
+struct enter {};
+struct leave {};
+
+struct literal {};
+struct start_array {};
+struct comma {};
+
+}  /* namespace events */
+
+//@{
+/** @name Orthogonal regions */
+struct ortho_fsm_def : def::state_machine<ortho_fsm_def> {
+    struct region_a : state_machine<region_a> {
+        struct on  : state<on> {};
+        struct off : state<off> {};
+        using initial_state = off;
+        using transitions = transition_table<
+            tr< off,    events::tick,   on  >,
+            tr< on,     events::tick,   off >
+        >;
+    };
+    struct region_b : state_machine<region_b> {
+        struct on  : state<on> {};
+        struct off : state<off> {};
+        using initial_state = on;
+        using transitions = transition_table<
+            tr< on,     events::tick,   off >,
+            tr< off,    events::tick,   on  >
+        >;
+    };
+    using orthogonal_regions = type_tuple<region_a, region_b>;
+};
+
+void
+OrthogonalRegions(::benchmark::State& state)
+{
+    state_machine<ortho_fsm_def> fsm;
+    allocation_counter allocs{state};
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::tick{}));
+    }
+    allocs.report();
+}
+//@}
+
+//@{
+/** @name Pushdown automaton */
+struct stack_fsm_def : def::state_machine<stack_fsm_def> {
+    struct context : state_machine<context> {
+        struct start : state<start> {};
+        struct array : state_machine<array> {
+            struct value : push<value, stack_fsm_def> {};
+            using initial_state = value;
+            using transitions = transition_table<
+                tr< value,  events::comma,  value >
+            >;
+        };
+        struct end : pop<end, stack_fsm_def> {};
+
+        using initial_state = start;
+        using transitions = transition_table<
+            tr< start,  events::literal,        end     >,
+            tr< start,  events::start_array,    array   >
+        >;
+    };
+    using orthogonal_regions = type_tuple<context>;
+};
+
+/**
+ * Every literal pops the stack and every comma pushes it back
+ */
+void
+PushdownStack(::benchmark::State& state)
+{
+    state_machine<stack_fsm_def> fsm;
+    fsm.process_event(events::start_array{});
+    allocation_counter allocs{state};
+    ::std::size_t n = 0;
+    while (state.KeepRunning()) {
+        if (n++ % 2) {
+            ::benchmark::DoNotOptimize(fsm.process_event(events::comma{}));
+        } else {
+            ::benchmark::DoNotOptimize(fsm.process_event(events::literal{}));
+        }
+    }
+    allocs.report();
+}
+//@}
+
+//@{
+/** @name Nested state machines */
+struct innermost : def::state_machine<innermost> {
+    struct a : state<a> {};
+    struct b : state<b> {};
+    using initial_state = a;
+    using transitions = transition_table<
+        tr< a,  events::tick,   b >,
+        tr< b,  events::tick,   a >
+    >;
+};
+
+template < typename Inner >
+struct nesting_level : def::state_machine< nesting_level<Inner> > {
+    struct idle : def::state<idle> {};
+    using initial_state = Inner;
+    using transitions = def::transition_table<
+        def::transition< Inner, events::leave,  idle  >,
+        def::transition< idle,  events::enter,  Inner >
+    >;
+};
+
+/**
+ * Root machine with three levels of inner state machines below it
+ */
+using nested_fsm = state_machine<
+        nesting_level< nesting_level< nesting_level< innermost > > > >;
+
+void
+NestedMachines(::benchmark::State& state)
+{
+    nested_fsm fsm;
+    allocation_counter allocs{state};
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::tick{}));
+    }
+    allocs.report();
+}
+//@}
+
+//@{
+/** @name Priority state machine and observers */
+struct toggle_fsm_def : def::state_machine<toggle_fsm_def> {
+    struct a : state<a> {};
+    struct b : state<b> {};
+    using initial_state = a;
+    using transitions = transition_table<
+        tr< a,  events::tick,   b >,
+        tr< b,  events::tick,   a >
+    >;
+};
+
+struct counting_observer : detail::null_observer {
+    template < typename FSM, typename SourceState, typename TargetState, typename Event>
+    void
+    state_changed(FSM const&, SourceState const&, TargetState const&, Event const&) noexcept
+    { ++changes; }
+
+    ::std::size_t changes{0};
+};
+
+using plain_toggle_fsm      = state_machine<toggle_fsm_def>;
+using priority_toggle_fsm   = priority_state_machine<toggle_fsm_def>;
+using observed_toggle_fsm   = state_machine<toggle_fsm_def, none, counting_observer>;
+
+template < typename FSM >
+void
+Toggle(::benchmark::State& state)
+{
+    FSM fsm;
+    allocation_counter allocs{state};
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::tick{}));
+    }
+    allocs.report();
+}
+
+void
+ObservedToggle(::benchmark::State& state)
+{
+    observed_toggle_fsm fsm;
+    fsm.make_observer();
+    allocation_counter allocs{state};
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::tick{}));
+    }
+    allocs.report();
+}
+//@}
+
+//@{
+/** @name History */
+template < typename ... Tags >
+struct history_fsm_def : def::state_machine< history_fsm_def<Tags...> > {
+    struct outside : def::state<outside> {};
+    struct inside : def::state_machine<inside, Tags...> {
+        struct a : def::state<a> {};
+        struct b : def::state<b> {};
+        using initial_state = a;
+        using transitions = def::transition_table<
+            def::transition< a, events::tick,   b >,
+            def::transition< b, events::tick,   a >
+        >;
+    };
+    using initial_state = outside;
+    using transitions = def::transition_table<
+        def::transition< outside,   events::enter,  inside  >,
+        def::transition< inside,    events::leave,  outside >
+    >;
+};
+
+/**
+ * Enter the inner machine, make a step inside and leave it again
+ */
+template < typename ... Tags >
+void
+History(::benchmark::State& state)
+{
+    state_machine< history_fsm_def<Tags...> > fsm;
+    allocation_counter allocs{state};
+    ::std::size_t n = 0;
+    while (state.KeepRunning()) {
+        switch (n++ % 3) {
+            case 0:
+                ::benchmark::DoNotOptimize(fsm.process_event(events::enter{}));
+                break;
+            case 1:
+                ::benchmark::DoNotOptimize(fsm.process_event(events::tick{}));
+                break;
+            default:
+                ::benchmark::DoNotOptimize(fsm.process_event(events::leave{}));
+                break;
+        }
+    }
+    allocs.report();
+}
+//@}
+
+//@{
+/** @name Large generated tables */
+template < ::std::size_t Size, ::std::size_t N >
+struct ring_state : def::state< ring_state<Size, N> > {};
+
+template < ::std::size_t Size, typename Indexes >
+struct ring_fsm_def;
+
+/**
+ * Machine with Size states connected in a ring by a single event
+ */
+template < ::std::size_t Size, ::std::size_t ... Indexes >
+struct ring_fsm_def< Size, ::std::index_sequence<Indexes...> >
+    : def::state_machine_def< ring_fsm_def< Size, ::std::index_sequence<Indexes...> > > {
+    using initial_state = ring_state<Size, 0>;
+    using transitions = def::transition_table<
+        def::transition<
+            ring_state<Size, Indexes>,
+            events::tick,
+            ring_state<Size, (Indexes + 1) % Size> >...
+    >;
+};
+
+template < ::std::size_t Size >
+using ring_fsm = state_machine< ring_fsm_def< Size, ::std::make_index_sequence<Size> > >;
+
+template < ::std::size_t Size >
+void
+LargeTable(::benchmark::State& state)
+{
+    ring_fsm<Size> fsm;
+    allocation_counter allocs{state};
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::tick{}));
+    }
+    allocs.report();
+}
+//@}
+
+BENCHMARK(OrthogonalRegions);
+BENCHMARK(PushdownStack);
+BENCHMARK(NestedMachines);
+BENCHMARK_TEMPLATE(Toggle, plain_toggle_fsm);
+BENCHMARK_TEMPLATE(Toggle, priority_toggle_fsm);
+BENCHMARK(ObservedToggle);
+BENCHMARK_TEMPLATE(History);
+BENCHMARK_TEMPLATE(History, def::tags::has_history);
+BENCHMARK_TEMPLATE(LargeTable, 64);
+BENCHMARK_TEMPLATE(LargeTable, 256);
+
+}  /* namespace bench */
+}  /* namespace afsm */
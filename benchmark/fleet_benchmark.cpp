@@ -0,0 +1,115 @@
+/*
+ * fleet_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fleet.hpp>
+#include <memory>
+#include <vector>
+
+namespace afsm {
+namespace bench {
+
+namespace {
+
+namespace events {
+
+struct start {};
+struct tick {};
+
+}  /* namespace events */
+
+/**
+ * Only the running timers handle ticks
+ */
+struct timer_def : def::state_machine<timer_def> {
+    struct count_tick {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::tick const&, FSM& fsm, Source&, Target&) const
+        {
+            ++fsm.ticks;
+        }
+    };
+
+    struct idle : state<idle> {};
+    struct running : state<running> {
+        using internal_transitions = transition_table<
+            in< events::tick, count_tick >
+        >;
+    };
+    using initial_state = idle;
+    using transitions = transition_table<
+        tr< idle,   events::start,  running >
+    >;
+
+    int ticks = 0;
+};
+
+using timer_fsm = state_machine<timer_def>;
+
+::std::size_t const timer_count = 100000;
+
+/**
+ * Every n-th timer is started, the argument is n
+ */
+bool
+started(::std::size_t i, ::benchmark::State const& state)
+{
+    return i % static_cast<::std::size_t>(state.range(0)) == 0;
+}
+
+}  /* namespace  */
+
+/**
+ * A tick is passed to each of the timers one by one per iteration
+ */
+void
+TimerLoopBroadcast(::benchmark::State& state)
+{
+    ::std::vector< ::std::unique_ptr<timer_fsm> > timers;
+    timers.reserve(timer_count);
+    for (::std::size_t i = 0; i < timer_count; ++i) {
+        timers.emplace_back(new timer_fsm{});
+        if (started(i, state))
+            timers.back()->process_event(events::start{});
+    }
+
+    while (state.KeepRunning()) {
+        for (auto& t : timers)
+            ::benchmark::DoNotOptimize(t->process_event(events::tick{}));
+    }
+    state.SetItemsProcessed(state.iterations() * timer_count);
+}
+
+/**
+ * A tick is broadcast to a fleet of the timers per iteration
+ */
+void
+TimerFleetBroadcast(::benchmark::State& state)
+{
+    fleet<timer_fsm> timers;
+    timers.reserve(timer_count);
+    for (::std::size_t i = 0; i < timer_count; ++i) {
+        timers.emplace_back();
+        if (started(i, state))
+            timers.process_event(i, events::start{});
+    }
+
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(timers.broadcast(events::tick{}));
+    }
+    state.SetItemsProcessed(state.iterations() * timer_count);
+}
+
+BENCHMARK(TimerLoopBroadcast)->Arg(1)->Arg(10)->Arg(100)
+    ->Unit(::benchmark::kMicrosecond);
+BENCHMARK(TimerFleetBroadcast)->Arg(1)->Arg(10)->Arg(100)
+    ->Unit(::benchmark::kMicrosecond);
+
+}  /* namespace bench */
+}  /* namespace afsm */
@@ -0,0 +1,200 @@
+/*
+ * parallel_regions_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fsm.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct step {};
+template < ::std::size_t N >
+struct hit {};
+
+}  /* namespace events */
+
+/**
+ * Fixed size pool of threads taking tasks from a shared queue
+ */
+class thread_pool {
+public:
+    explicit
+    thread_pool(::std::size_t size)
+    {
+        for (::std::size_t i = 0; i < size; ++i)
+            threads_.emplace_back([this]{ run(); });
+    }
+    thread_pool(thread_pool const&) = delete;
+    thread_pool&
+    operator = (thread_pool const&) = delete;
+    ~thread_pool()
+    {
+        {
+            ::std::lock_guard< ::std::mutex > lock{mutex_};
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    template < typename Task >
+    void
+    post(Task&& task)
+    {
+        {
+            ::std::lock_guard< ::std::mutex > lock{mutex_};
+            tasks_.emplace_back(::std::forward<Task>(task));
+        }
+        wake_.notify_one();
+    }
+private:
+    void
+    run()
+    {
+        while (true) {
+            ::std::function< void() > task;
+            {
+                ::std::unique_lock< ::std::mutex > lock{mutex_};
+                wake_.wait(lock, [this]{ return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                task = ::std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+private:
+    ::std::mutex                            mutex_{};
+    ::std::condition_variable               wake_{};
+    ::std::deque< ::std::function<void()> > tasks_{};
+    ::std::vector< ::std::thread >          threads_{};
+    bool                                    stopping_{false};
+};
+
+/**
+ * Action burning CPU
+ */
+struct crunch {
+    template < typename Event, typename FSM, typename Source, typename Target >
+    void
+    operator()(Event const&, FSM&, Source&, Target&) const
+    {
+        ::std::uint64_t x = 0;
+        for (int i = 0; i < 20000; ++i) {
+            x += i * i;
+            ::benchmark::DoNotOptimize(x);
+        }
+    }
+};
+
+template < ::std::size_t N >
+struct crunch_region : def::state_machine< crunch_region<N> > {
+    struct a : def::state<a> {};
+    struct b : def::state<b> {};
+    using initial_state = a;
+    using transitions = def::transition_table<
+        def::transition< a, events::step, b, crunch >,
+        def::transition< b, events::step, a, crunch >
+    >;
+};
+
+/**
+ * Region handling only its own event
+ */
+template < ::std::size_t N >
+struct sparse_region : def::state_machine< sparse_region<N> > {
+    struct a : def::state<a> {};
+    struct b : def::state<b> {};
+    using initial_state = a;
+    using transitions = def::transition_table<
+        def::transition< a, events::hit<N>, b >,
+        def::transition< b, events::hit<N>, a >
+    >;
+};
+
+template < typename Indexes, typename ... Tags >
+struct regions_fsm_def;
+
+template < ::std::size_t ... Indexes, typename ... Tags >
+struct regions_fsm_def< ::std::index_sequence<Indexes...>, Tags... >
+    : def::state_machine_def< regions_fsm_def< ::std::index_sequence<Indexes...>, Tags... >, Tags... > {
+    using orthogonal_regions = ::psst::meta::type_tuple< crunch_region<Indexes>... >;
+
+    static thread_pool&
+    region_executor()
+    {
+        static thread_pool pool{ ::std::max(::std::thread::hardware_concurrency(), 1u) };
+        return pool;
+    }
+};
+
+template < ::std::size_t N, typename ... Tags >
+using regions_fsm = state_machine<
+        regions_fsm_def< ::std::make_index_sequence<N>, Tags... >, ::std::mutex >;
+
+template < ::std::size_t N, typename ... Tags >
+void
+OrthogonalDispatch(::benchmark::State& state)
+{
+    regions_fsm<N, Tags...> fsm;
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::step{}));
+    }
+}
+
+BENCHMARK_TEMPLATE(OrthogonalDispatch, 4)->UseRealTime();
+BENCHMARK_TEMPLATE(OrthogonalDispatch, 4, def::tags::parallel_regions)->UseRealTime();
+BENCHMARK_TEMPLATE(OrthogonalDispatch, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(OrthogonalDispatch, 8, def::tags::parallel_regions)->UseRealTime();
+BENCHMARK_TEMPLATE(OrthogonalDispatch, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(OrthogonalDispatch, 16, def::tags::parallel_regions)->UseRealTime();
+
+template < typename Indexes >
+struct sparse_fsm_def;
+
+template < ::std::size_t ... Indexes >
+struct sparse_fsm_def< ::std::index_sequence<Indexes...> >
+    : def::state_machine< sparse_fsm_def< ::std::index_sequence<Indexes...> > > {
+    using orthogonal_regions = ::psst::meta::type_tuple< sparse_region<Indexes>... >;
+};
+
+/**
+ * Each event is handled by one of the regions, the others are filtered
+ * out at compile time.
+ */
+template < ::std::size_t N >
+void
+OrthogonalSparseDispatch(::benchmark::State& state)
+{
+    state_machine< sparse_fsm_def< ::std::make_index_sequence<N> > > fsm;
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::hit<0>{}));
+        ::benchmark::DoNotOptimize(fsm.process_event(events::hit<N - 1>{}));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+BENCHMARK_TEMPLATE(OrthogonalSparseDispatch, 4);
+BENCHMARK_TEMPLATE(OrthogonalSparseDispatch, 16);
+BENCHMARK_TEMPLATE(OrthogonalSparseDispatch, 64);
+
+}  /* namespace bench */
+}  /* namespace afsm */
@@ -0,0 +1,143 @@
+/*
+ * priority_queue_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fsm.hpp>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct burst {};
+struct tick {};
+struct stop {};
+
+}  /* namespace events */
+
+using invokation = ::std::function< int() >;
+
+/**
+ * The heap the priority state machine used before the buckets
+ */
+class heap_queue {
+public:
+    void
+    push(event_priority_type priority, invokation&& item)
+    {
+        queue_.emplace(::std::move(item), priority);
+    }
+    invokation&
+    top()
+    { return const_cast<invokation&>(queue_.top().first); }
+    void
+    pop()
+    { queue_.pop(); }
+    bool
+    empty() const
+    { return queue_.empty(); }
+private:
+    using item_type = ::std::pair< invokation, event_priority_type >;
+    struct compare {
+        bool
+        operator()(item_type const& lhs, item_type const& rhs) const
+        { return lhs.second < rhs.second; }
+    };
+    ::std::priority_queue< item_type, ::std::vector<item_type>, compare > queue_{};
+};
+
+using bucket_queue = detail::priority_buckets< invokation, event_priority_type >;
+
+/**
+ * Push a batch of items with the number of distinct priorities given by
+ * the argument, then pop them all.
+ */
+template < typename Queue >
+void
+PriorityQueue(::benchmark::State& state)
+{
+    int const batch = 256;
+    auto const levels = static_cast<int>(state.range(0));
+    Queue queue;
+    int sum = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < batch; ++i) {
+            queue.push(i % levels, [i]{ return i; });
+        }
+        while (!queue.empty()) {
+            sum += queue.top()();
+            queue.pop();
+        }
+    }
+    ::benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+BENCHMARK_TEMPLATE(PriorityQueue, heap_queue)->Arg(1)->Arg(4)->Arg(32);
+BENCHMARK_TEMPLATE(PriorityQueue, bucket_queue)->Arg(1)->Arg(4)->Arg(32);
+
+struct burst_fsm_def : def::state_machine<burst_fsm_def> {
+    static constexpr int batch = 64;
+    struct post_ticks {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::burst const&, FSM& fsm, Source&, Target&) const
+        {
+            auto& root = root_machine(fsm);
+            for (int i = 0; i < batch; ++i)
+                root.process_event(events::tick{}, i % 4);
+        }
+    };
+    struct count_tick {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::tick const&, FSM& fsm, Source&, Target&) const
+        {
+            ++fsm.ticks;
+        }
+    };
+    struct idle : state<idle> {
+        using internal_transitions = transition_table<
+            in< events::burst,  post_ticks  >,
+            in< events::tick,   count_tick  >
+        >;
+    };
+    struct stopped : state<stopped> {};
+    using initial_state = idle;
+    using transitions = transition_table<
+        tr< idle, events::stop, stopped >
+    >;
+
+    ::std::size_t ticks{0};
+};
+
+constexpr int burst_fsm_def::batch;
+
+/**
+ * Events posted from an action are queued by priority and processed
+ * after the action returns.
+ */
+void
+PriorityMachineQueue(::benchmark::State& state)
+{
+    priority_state_machine<burst_fsm_def> fsm;
+    while (state.KeepRunning()) {
+        fsm.process_event(events::burst{});
+    }
+    ::benchmark::DoNotOptimize(fsm.ticks);
+    state.SetItemsProcessed(state.iterations() * burst_fsm_def::batch);
+}
+
+BENCHMARK(PriorityMachineQueue);
+
+}  /* namespace bench */
+}  /* namespace afsm */
@@ -0,0 +1,72 @@
+/*
+ * pushdown_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fsm.hpp>
+#include "allocation_counter.hpp"
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct open {};
+struct close {};
+
+}  /* namespace events */
+
+template < typename ... Tags >
+struct nest_def : def::state_machine< nest_def<Tags...>, Tags... > {
+    using this_type = nest_def<Tags...>;
+    struct idle : def::state<idle> {};
+    struct inner : def::pushdown< inner, this_type > {};
+    struct done : def::popup< done, this_type > {};
+
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,  events::open,   inner   >,
+        def::transition< idle,  events::close,  done    >,
+        def::transition< inner, events::close,  done    >,
+        def::transition< inner, events::open,   inner   >
+    >;
+};
+
+constexpr int nest_depth = 8;
+
+using heap_nest_fsm     = state_machine< nest_def<> >;
+using inline_nest_fsm   = state_machine<
+        nest_def< def::tags::pushdown_depth< nest_depth + 1 > > >;
+
+/**
+ * Pushes nest_depth frames and pops them back, one event per iteration
+ */
+template < typename FSM >
+void
+PushdownPushPop(::benchmark::State& state)
+{
+    FSM fsm;
+    int depth = 0;
+    bool push = true;
+    allocation_counter allocs{state};
+    while (state.KeepRunning()) {
+        if (push) {
+            ::benchmark::DoNotOptimize(fsm.process_event(events::open{}));
+            push = ++depth < nest_depth;
+        } else {
+            ::benchmark::DoNotOptimize(fsm.process_event(events::close{}));
+            push = --depth == 0;
+        }
+    }
+    allocs.report();
+}
+
+BENCHMARK_TEMPLATE(PushdownPushPop, heap_nest_fsm);
+BENCHMARK_TEMPLATE(PushdownPushPop, inline_nest_fsm);
+
+}  /* namespace bench */
+}  /* namespace afsm */
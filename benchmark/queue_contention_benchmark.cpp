@@ -0,0 +1,62 @@
+/*
+ * queue_contention_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fsm.hpp>
+#include <mutex>
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct tick {};
+
+}  /* namespace events */
+
+struct state_a : def::state<state_a> {};
+struct state_b : def::state<state_b> {};
+
+template < typename ... Tags >
+struct contention_fsm_def
+    : def::state_machine_def< contention_fsm_def<Tags...>, Tags... > {
+    using initial_state = state_a;
+
+    using transitions = def::transition_table<
+        def::transition< state_a, events::tick, state_b >,
+        def::transition< state_b, events::tick, state_a >
+    >;
+};
+
+using mutex_queue_fsm = state_machine<
+        contention_fsm_def<>, ::std::mutex >;
+using lock_free_queue_fsm = state_machine<
+        contention_fsm_def< def::tags::lock_free_event_queue >, ::std::mutex >;
+
+/**
+ * All benchmark threads post events to one state machine. The thread
+ * that finds the machine idle processes the queue for everyone.
+ */
+template < typename FSM >
+void
+QueueContention(::benchmark::State& state)
+{
+    static FSM fsm;
+    while (state.KeepRunning()) {
+        fsm.process_event(events::tick{});
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(QueueContention, mutex_queue_fsm)
+    ->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(QueueContention, lock_free_queue_fsm)
+    ->ThreadRange(1, 32)->UseRealTime();
+
+}  /* namespace bench */
+}  /* namespace afsm */
@@ -0,0 +1,70 @@
+/*
+ * state_reset_benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <afsm/fsm.hpp>
+#include <vector>
+
+namespace afsm {
+namespace bench {
+
+namespace events {
+
+struct toggle {};
+
+}  /* namespace events */
+
+/**
+ * State owning a vector that is filled when the state is entered
+ */
+template < typename T >
+struct buffer_state : def::state<T> {
+    template < typename Event, typename FSM >
+    void
+    on_enter(Event&&, FSM&)
+    {
+        for (int i = 0; i < 16; ++i)
+            buffer.push_back(i);
+    }
+
+    ::std::vector<int> buffer{};
+};
+
+struct reconstructed_buffer : buffer_state<reconstructed_buffer> {};
+struct reset_buffer : buffer_state<reset_buffer> {
+    void
+    reset()
+    { buffer.clear(); }
+};
+
+template < typename BufferState >
+struct reset_fsm_def : def::state_machine_def< reset_fsm_def<BufferState> > {
+    struct idle : def::state<idle> {};
+
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,          events::toggle, BufferState >,
+        def::transition< BufferState,   events::toggle, idle        >
+    >;
+};
+
+template < typename BufferState >
+void
+StateReset(::benchmark::State& state)
+{
+    state_machine< reset_fsm_def<BufferState> > fsm;
+    while (state.KeepRunning()) {
+        ::benchmark::DoNotOptimize(fsm.process_event(events::toggle{}));
+    }
+}
+
+BENCHMARK_TEMPLATE(StateReset, reconstructed_buffer);
+BENCHMARK_TEMPLATE(StateReset, reset_buffer);
+
+}  /* namespace bench */
+}  /* namespace afsm */
@@ -0,0 +1,321 @@
+/*
+ * coroutine.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_COROUTINE_HPP_
+#define AFSM_COROUTINE_HPP_
+
+#include <afsm/fsm.hpp>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#define AFSM_HAS_COROUTINES 1
+
+namespace afsm {
+
+template < typename T = void >
+class task;
+
+namespace detail {
+
+/**
+ * Wakes the thread waiting in task::get when the coroutine finishes
+ * in another thread. Lives on the waiting thread's stack.
+ */
+class task_waiter {
+public:
+    void
+    signal()
+    {
+        ::std::lock_guard< ::std::mutex > lock{mutex_};
+        done_ = true;
+        finished_.notify_all();
+    }
+    void
+    wait()
+    {
+        ::std::unique_lock< ::std::mutex > lock{mutex_};
+        finished_.wait(lock, [this]{ return done_; });
+    }
+private:
+    ::std::mutex                mutex_{};
+    ::std::condition_variable   finished_{};
+    bool                        done_{false};
+};
+
+class task_promise_base {
+public:
+    struct final_awaiter {
+        bool
+        await_ready() const noexcept
+        { return false; }
+        template < typename Promise >
+        ::std::coroutine_handle<>
+        await_suspend(::std::coroutine_handle<Promise> h) noexcept
+        {
+            auto& promise = h.promise();
+            if (promise.continuation_)
+                return promise.continuation_;
+            promise.waiter_->signal();
+            return ::std::noop_coroutine();
+        }
+        void
+        await_resume() const noexcept {}
+    };
+
+    ::std::suspend_always
+    initial_suspend() const noexcept
+    { return {}; }
+    final_awaiter
+    final_suspend() const noexcept
+    { return {}; }
+    void
+    unhandled_exception() noexcept
+    { exception_ = ::std::current_exception(); }
+
+    ::std::coroutine_handle<> continuation_ = nullptr;
+    task_waiter*              waiter_       = nullptr;
+protected:
+    void
+    rethrow() const
+    {
+        if (exception_)
+            ::std::rethrow_exception(exception_);
+    }
+private:
+    ::std::exception_ptr      exception_    = nullptr;
+};
+
+template < typename T >
+class task_promise : public task_promise_base {
+public:
+    task<T>
+    get_return_object() noexcept;
+
+    template < typename U >
+    void
+    return_value(U&& value)
+    { value_.emplace(::std::forward<U>(value)); }
+
+    T
+    result()
+    {
+        rethrow();
+        return ::std::move(*value_);
+    }
+private:
+    ::std::optional<T>  value_ = ::std::nullopt;
+};
+
+template <>
+class task_promise<void> : public task_promise_base {
+public:
+    task<void>
+    get_return_object() noexcept;
+
+    void
+    return_void() const noexcept {}
+
+    void
+    result()
+    { rethrow(); }
+};
+
+}  /* namespace detail */
+
+/**
+ * Coroutine type for actions and guards.
+ *
+ * An action or a guard returning a task is a coroutine, it is started
+ * when the transition invokes it and the transition waits for it to
+ * finish before going on, so anything the coroutine awaits completes
+ * before the state changes. The event, the machine and the states passed
+ * to the coroutine stay valid until it finishes. Exceptions are
+ * rethrown to the code processing the event. A guard coroutine returns
+ * task<bool>, it cannot be wrapped in not_.
+ *
+ * A task can also be co_awaited from another task.
+ */
+template < typename T >
+class task {
+public:
+    using promise_type  = detail::task_promise<T>;
+    using handle_type   = ::std::coroutine_handle<promise_type>;
+public:
+    task(task&& rhs) noexcept
+        : handle_{ ::std::exchange(rhs.handle_, nullptr) } {}
+    task(task const&) = delete;
+    task&
+    operator = (task const&) = delete;
+    task&
+    operator = (task&&) = delete;
+    ~task()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    /**
+     * Run the coroutine and wait for it to finish. If the coroutine
+     * suspends, the calling thread waits until it is resumed and
+     * finishes in another thread.
+     */
+    T
+    get()
+    {
+        detail::task_waiter waiter;
+        handle_.promise().waiter_ = &waiter;
+        handle_.resume();
+        waiter.wait();
+        return handle_.promise().result();
+    }
+
+    auto
+    operator co_await() noexcept
+    {
+        struct awaiter {
+            bool
+            await_ready() const noexcept
+            { return false; }
+            ::std::coroutine_handle<>
+            await_suspend(::std::coroutine_handle<> continuation) noexcept
+            {
+                handle.promise().continuation_ = continuation;
+                return handle;
+            }
+            T
+            await_resume()
+            { return handle.promise().result(); }
+
+            handle_type handle;
+        };
+        return awaiter{handle_};
+    }
+private:
+    friend class detail::task_promise<T>;
+    explicit
+    task(handle_type handle) noexcept
+        : handle_{handle} {}
+private:
+    handle_type handle_;
+};
+
+namespace detail {
+
+template < typename T >
+task<T>
+task_promise<T>::get_return_object() noexcept
+{
+    return task<T>{ task<T>::handle_type::from_promise(*this) };
+}
+
+inline task<void>
+task_promise<void>::get_return_object() noexcept
+{
+    return task<void>{ task<void>::handle_type::from_promise(*this) };
+}
+
+/**
+ * Awaitable submitting an event to a state machine.
+ *
+ * The event is passed to process_event with a completion handler. If
+ * the machine is idle the event is dispatched in the awaiting thread and
+ * the coroutine is not suspended. Otherwise the event is queued and the
+ * coroutine is resumed by the thread dispatching it.
+ */
+template < typename FSM, typename Event >
+class event_awaitable {
+public:
+    using event_type = typename ::std::decay<Event>::type;
+public:
+    event_awaitable(FSM& fsm, Event&& event)
+        : fsm_{&fsm}, event_{ ::std::forward<Event>(event) } {}
+
+    bool
+    await_ready() const noexcept
+    { return false; }
+
+    bool
+    await_suspend(::std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        fsm_->process_event(::std::move(event_),
+            [this](actions::event_process_result res)
+            {
+                result_ = res;
+                // The handler runs either inside process_event or later
+                // in another thread, resume the coroutine only if it has
+                // been suspended already.
+                if (state_.exchange(completed) == suspended)
+                    handle_.resume();
+            });
+        return state_.exchange(suspended) != completed;
+    }
+
+    actions::event_process_result
+    await_resume() const noexcept
+    { return result_; }
+private:
+    enum status {
+        pending,
+        completed,
+        suspended
+    };
+    FSM*                            fsm_;
+    event_type                      event_;
+    ::std::coroutine_handle<>       handle_ = nullptr;
+    actions::event_process_result   result_ = actions::event_process_result::refuse;
+    ::std::atomic<status>           state_{pending};
+};
+
+}  /* namespace detail */
+
+namespace actions {
+namespace detail {
+
+template < typename T >
+struct is_awaited_result< task<T> > : ::std::true_type {};
+
+}  /* namespace detail */
+}  /* namespace actions */
+
+/**
+ * Submit an event to the state machine and resume the awaiting coroutine
+ * with the result when the event is dispatched.
+ *
+ * @code
+ * auto res = co_await afsm::co_process_event(fsm, events::start{});
+ * @endcode
+ *
+ * The coroutine is resumed in the thread that dispatches the event. It is
+ * never resumed if processing the event throws in another thread.
+ * An event rejected by a full bounded queue completes the coroutine with
+ * event_process_result::overflow without suspending it. An event dropped
+ * from the queue later, or still queued when the machine is destroyed,
+ * resumes the coroutine with event_process_result::overflow in the thread
+ * that drops the event or destroys the machine.
+ */
+template < typename FSM, typename Event >
+detail::event_awaitable< FSM, Event >
+co_process_event(FSM& fsm, Event&& event)
+{
+    return { fsm, ::std::forward<Event>(event) };
+}
+
+}  /* namespace afsm */
+
+#endif /* __cpp_impl_coroutine */
+
+#endif /* AFSM_COROUTINE_HPP_ */
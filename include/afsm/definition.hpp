@@ -378,6 +378,65 @@ struct recursive_handled_events< ::psst::meta::type_tuple<> > {
     using type = ::psst::meta::type_tuple<>;
 };
 
+/**
+ * Events that can be deferred by a state or by any state nested in
+ * a state machine.
+ */
+template < typename T >
+struct recursive_deferred_events
+    : ::std::conditional<
+        traits::is_state_machine<T>::value,
+        recursive_deferred_events< state_machine<T> >,
+        recursive_deferred_events< state<T> >
+    >::type {};
+
+template < typename ... T >
+struct recursive_deferred_events< transition_table<T...> >
+    : recursive_deferred_events< typename transition_table<T...>::inner_states > {};
+
+template <>
+struct recursive_deferred_events<void> {
+    using type = ::psst::meta::type_tuple<>;
+};
+
+template < typename T >
+struct recursive_deferred_events< state<T> > {
+    using type = typename ::std::conditional<
+            ::std::is_same< typename T::deferred_events, void >::value,
+            ::psst::meta::type_tuple<>,
+            typename T::deferred_events
+        >::type;
+};
+
+template < typename T >
+struct recursive_deferred_events< state_machine<T> > {
+    using type =
+            typename ::psst::meta::unique<
+                typename ::psst::meta::unique<
+                    typename recursive_deferred_events< state<T> >::type,
+                    typename recursive_deferred_events< typename T::transitions >::type
+                >::type,
+                typename recursive_deferred_events< typename T::orthogonal_regions >::type
+            >::type;
+};
+
+template < typename T, typename ... Y >
+struct recursive_deferred_events< ::psst::meta::type_tuple<T, Y...> > {
+    using type = typename ::psst::meta::unique<
+                typename recursive_deferred_events<T>::type,
+                typename recursive_deferred_events< ::psst::meta::type_tuple<Y...>>::type
+            >::type;
+};
+
+template < typename T >
+struct recursive_deferred_events< ::psst::meta::type_tuple<T> >
+    : recursive_deferred_events<T> {};
+
+template <>
+struct recursive_deferred_events< ::psst::meta::type_tuple<> > {
+    using type = ::psst::meta::type_tuple<>;
+};
+
 template < typename T >
 struct has_default_transitions;
 
@@ -9,6 +9,7 @@
 #define AFSM_DETAIL_ACTIONS_HPP_
 
 #include <afsm/definition.hpp>
+#include <afsm/detail/state_storage.hpp>
 #include <functional>
 #include <array>
 
@@ -50,6 +51,7 @@ enum class event_process_result {
     defer,
     process_in_state,    /**< Process with in-state transition */
     process,
+    overflow,            /**< The event queue is full or destroyed, the event is discarded */
 };
 
 /**
@@ -60,7 +62,8 @@ enum class event_process_result {
 inline bool
 ok(event_process_result res)
 {
-    return res != event_process_result::refuse;
+    return res != event_process_result::refuse &&
+            res != event_process_result::overflow;
 }
 
 /**
@@ -139,6 +142,60 @@ struct handles_event
         ::std::false_type
     >::type {};
 
+/**
+ * Result of an action or a guard that completes asynchronously, the
+ * transition waits for it by calling get(). Specialized for afsm::task
+ * in afsm/coroutine.hpp.
+ */
+template < typename T >
+struct is_awaited_result : ::std::false_type {};
+
+template < typename T >
+T
+complete_result(T&& res, ::std::false_type const&)
+{ return ::std::forward<T>(res); }
+
+template < typename T >
+decltype(auto)
+complete_result(T&& res, ::std::true_type const&)
+{ return ::std::forward<T>(res).get(); }
+
+template < typename T >
+decltype(auto)
+complete_result(T&& res)
+{
+    return complete_result(::std::forward<T>(res),
+            is_awaited_result< typename ::std::decay<T>::type >{});
+}
+
+template < typename Action, typename ... Args >
+using awaited_action = is_awaited_result< typename ::std::decay<
+        decltype(::std::declval<Action>()(::std::declval<Args>()...)) >::type >;
+
+template < typename Action, typename ... Args >
+void
+call_action(::std::false_type const&, Args&& ... args)
+    noexcept(noexcept(Action{}(::std::forward<Args>(args)...)))
+{
+    Action{}(::std::forward<Args>(args)...);
+}
+
+template < typename Action, typename ... Args >
+void
+call_action(::std::true_type const&, Args&& ... args)
+{
+    Action{}(::std::forward<Args>(args)...).get();
+}
+
+template < typename Action, typename ... Args >
+void
+invoke_action(Args&& ... args)
+    noexcept(noexcept(call_action<Action>(awaited_action<Action, Args...>{},
+            ::std::forward<Args>(args)...)))
+{
+    call_action<Action>(awaited_action<Action, Args...>{}, ::std::forward<Args>(args)...);
+}
+
 template < typename Guard, typename FSM, typename State, typename Event >
 struct guard_wants_event
     : ::std::integral_constant<bool,
@@ -153,14 +210,14 @@ template < bool WantEvent, typename FSM, typename State, typename Event, typenam
 struct guard_event_check {
     bool
     operator()(FSM const& fsm, State const& state, Event const&) const
-    { return Guard{}(fsm, state); }
+    { return complete_result(Guard{}(fsm, state)); }
 };
 
 template < typename FSM, typename State, typename Event, typename Guard >
 struct guard_event_check< true, FSM, State, Event, Guard > {
     bool
     operator()(FSM const& fsm, State const& state, Event const& event) const
-    { return Guard{}(fsm, state, event); }
+    { return complete_result(Guard{}(fsm, state, event)); }
 };
 
 template < typename FSM, typename State, typename Event, typename Guard >
@@ -206,11 +263,12 @@ template < typename Action, typename Event, typename FSM,
 struct action_invocation_impl {
     void
     operator()(Event&& event, FSM& fsm, SourceState& source, TargetState& target) const
+        noexcept(noexcept(invoke_action<Action>(::std::forward<Event>(event), fsm, source, target)))
     {
         static_assert(action_long_signature< Action, Event,
                     FSM, SourceState, TargetState >::value,
                 "Action is not callable for this transition");
-        Action{}(::std::forward<Event>(event), fsm, source, target);
+        invoke_action<Action>(::std::forward<Event>(event), fsm, source, target);
     }
 };
 
@@ -219,11 +277,12 @@ template < typename Action, typename Event, typename FSM,
 struct action_invocation_impl<Action, Event, FSM, SourceState, TargetState, false> {
     void
     operator()(Event&& event, FSM& fsm, SourceState&, TargetState&) const
+        noexcept(noexcept(invoke_action<Action>(::std::forward<Event>(event), fsm)))
     {
         static_assert(action_short_signature< Action, Event,
                     FSM >::value,
                 "Action is not callable for this transition");
-        Action{}(::std::forward<Event>(event), fsm);
+        invoke_action<Action>(::std::forward<Event>(event), fsm);
     }
 };
 
@@ -231,16 +290,20 @@ struct action_invocation_impl<Action, Event, FSM, SourceState, TargetState, fals
 template < typename Action, typename FSM,
     typename SourceState, typename TargetState >
 struct action_invocation {
+    template < typename Event >
+    using invocation_type = action_invocation_impl<
+                                Action, Event, FSM,
+                                SourceState, TargetState,
+                                action_long_signature<Action, Event, FSM,
+                                        SourceState, TargetState>::value>;
+
     template < typename Event >
     void
     operator()(Event&& event, FSM& fsm, SourceState& source, TargetState& target) const
+        noexcept(noexcept(invocation_type<Event>{}(
+                ::std::forward<Event>(event), fsm, source, target)))
     {
-        using invocation_type = action_invocation_impl<
-                                    Action, Event, FSM,
-                                    SourceState, TargetState,
-                                    action_long_signature<Action, Event, FSM,
-                                            SourceState, TargetState>::value>;
-        invocation_type{}(::std::forward<Event>(event), fsm, source, target);
+        invocation_type<Event>{}(::std::forward<Event>(event), fsm, source, target);
     }
 };
 
@@ -249,7 +312,7 @@ template < typename FSM,
 struct action_invocation< none, FSM, SourceState, TargetState > {
     template < typename Event >
     void
-    operator()(Event&&, FSM&, SourceState&, TargetState&) const
+    operator()(Event&&, FSM&, SourceState&, TargetState&) const noexcept
     {}
 };
 
@@ -441,11 +504,23 @@ namespace detail {
 template < ::std::size_t StateIndex >
 struct process_event_handler {
     static constexpr ::std::size_t state_index = StateIndex;
-    template < typename StateTuple, typename Event >
+    template < typename StateTuple, typename FSM, typename Event >
     event_process_result
-    operator()(StateTuple& states, Event&& event) const
+    operator()(StateTuple& states, FSM& fsm, Event&& event) const
     {
-        return ::std::get<state_index>(states).process_event(::std::forward<Event>(event));
+        return invoke(states, fsm, ::std::forward<Event>(event));
+    }
+    /**
+     * Static form of the handler, suitable for taking an address
+     * to place into a dispatch table. The enclosing machine is passed
+     * along with the event, states may not keep a pointer to it.
+     */
+    template < typename StateTuple, typename FSM, typename Event >
+    static event_process_result
+    invoke(StateTuple& states, FSM& fsm, Event&& event)
+    {
+        return ::afsm::detail::inner_state<state_index>(states).process_event(
+                fsm, ::std::forward<Event>(event));
     }
 };
 
@@ -458,39 +533,39 @@ struct handlers_tuple < ::psst::meta::indexes_tuple<Indexes...> > {
     static constexpr ::std::size_t size = sizeof ... (Indexes);
 };
 
-template < typename T >
-class inner_dispatch_table;
-
-template < typename ... T >
-class inner_dispatch_table< ::std::tuple<T...> > {
+template < typename States >
+class inner_dispatch_table {
 public:
-    static constexpr ::std::size_t size = sizeof ... (T);
-    using states_tuple      = ::std::tuple<T...>;
+    static constexpr ::std::size_t size = ::std::tuple_size<States>::value;
+    using states_tuple      = States;
     using indexes_tuple     = typename ::psst::meta::index_builder< size >::type;
     using dispatch_tuple    = typename handlers_tuple<indexes_tuple>::type;
-    template < typename Event >
-    using invocation_table  = ::std::array<
-            ::std::function< event_process_result(states_tuple&, Event&&) >, size >;
+    template < typename FSM, typename Event >
+    using invocation_function = event_process_result(*)(states_tuple&, FSM&, Event&&);
+    template < typename FSM, typename Event >
+    using invocation_table  = ::std::array< invocation_function<FSM, Event>, size >;
 public:
     explicit
     inner_dispatch_table() {}
 
-    template < typename Event >
+    template < typename FSM, typename Event >
     static event_process_result
-    process_event(states_tuple& states, ::std::size_t current_state, Event&& event)
+    process_event(states_tuple& states, FSM& fsm, ::std::size_t current_state, Event&& event)
     {
         //using event_type = typename ::std::decay<Event>::type;
         if (current_state >= size)
             throw ::std::logic_error{ "Invalid current state index" };
-        auto inv_table = state_table< Event >(indexes_tuple{});
-        return inv_table[current_state](states, ::std::forward<Event>(event));
+        auto const& inv_table = state_table< FSM, Event >(indexes_tuple{});
+        return inv_table[current_state](states, fsm, ::std::forward<Event>(event));
     }
 private:
-    template < typename Event, ::std::size_t ... Indexes >
-    static invocation_table<Event> const&
+    template < typename FSM, typename Event, ::std::size_t ... Indexes >
+    static invocation_table<FSM, Event> const&
     state_table( ::psst::meta::indexes_tuple< Indexes... > const& )
     {
-        static invocation_table<Event> _table {{ process_event_handler<Indexes>{}... }};
+        static constexpr invocation_table<FSM, Event> _table {{
+            &process_event_handler<Indexes>::template invoke<states_tuple, FSM, Event>...
+        }};
         return _table;
     }
 };
@@ -0,0 +1,357 @@
+/*
+ * activity.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_DETAIL_ACTIVITY_HPP_
+#define AFSM_DETAIL_ACTIVITY_HPP_
+
+#include <afsm/detail/def_traits.hpp>
+#include <afsm/detail/helpers.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace afsm {
+namespace detail {
+
+/**
+ * Thread pool running state activities when the state machine doesn't
+ * provide an executor. Activities are long-running, so a new thread is
+ * started if there is no idle one, up to max_threads. When all of the
+ * threads are busy, an activity waits until one of the running
+ * activities finishes. Threads are kept for later activities.
+ *
+ * Machines that run more activities at once than the limit, or whose
+ * activities wait for each other, should use
+ * def::tags::custom_activity_executor.
+ */
+class activity_thread_pool {
+public:
+    static constexpr ::std::size_t default_max_threads = 64;
+
+    static activity_thread_pool&
+    instance()
+    {
+        static activity_thread_pool pool;
+        return pool;
+    }
+
+    activity_thread_pool(activity_thread_pool const&) = delete;
+    activity_thread_pool&
+    operator = (activity_thread_pool const&) = delete;
+    ~activity_thread_pool()
+    {
+        {
+            ::std::lock_guard< ::std::mutex > lock{mutex_};
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    ::std::size_t
+    max_threads() const
+    {
+        ::std::lock_guard< ::std::mutex > lock{mutex_};
+        return max_threads_;
+    }
+    /**
+     * Limit the number of threads. Threads already started are kept.
+     */
+    void
+    max_threads(::std::size_t n)
+    {
+        ::std::lock_guard< ::std::mutex > lock{mutex_};
+        max_threads_ = n > 0 ? n : 1;
+    }
+    ::std::size_t
+    thread_count() const
+    {
+        ::std::lock_guard< ::std::mutex > lock{mutex_};
+        return threads_.size();
+    }
+
+    template < typename Task >
+    void
+    post(Task&& task)
+    {
+        {
+            ::std::lock_guard< ::std::mutex > lock{mutex_};
+            tasks_.emplace_back(::std::forward<Task>(task));
+            if (tasks_.size() > available_ && threads_.size() < max_threads_) {
+                threads_.emplace_back([this]{ run(); });
+                ++available_;
+            }
+        }
+        wake_.notify_one();
+    }
+private:
+    activity_thread_pool() = default;
+
+    void
+    run()
+    {
+        ::std::unique_lock< ::std::mutex > lock{mutex_};
+        while (true) {
+            wake_.wait(lock, [this]{ return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty())
+                return;
+            auto task = ::std::move(tasks_.front());
+            tasks_.pop_front();
+            --available_;
+            lock.unlock();
+            task();
+            lock.lock();
+            ++available_;
+        }
+    }
+private:
+    mutable ::std::mutex                    mutex_{};
+    ::std::condition_variable               wake_{};
+    ::std::deque< ::std::function<void()> > tasks_{};
+    ::std::vector< ::std::thread >          threads_{};
+    /** Number of threads that are idle or about to take a task */
+    ::std::size_t                           available_{0};
+    ::std::size_t                           max_threads_{default_max_threads};
+    bool                                    stopping_{false};
+};
+
+template < typename FSM >
+decltype(auto)
+activity_executor(FSM& fsm, ::std::true_type const&)
+{
+    return root_machine(fsm).activity_executor();
+}
+
+template < typename FSM >
+activity_thread_pool&
+activity_executor(FSM&, ::std::false_type const&)
+{
+    return activity_thread_pool::instance();
+}
+
+/**
+ * Executor for the activities of the state machine's states
+ */
+template < typename FSM >
+decltype(auto)
+activity_executor(FSM& fsm)
+{
+    using root_definition = typename root_machine_definition<FSM, void>::type;
+    return activity_executor(fsm, def::traits::has_activity_executor<root_definition>{});
+}
+
+/**
+ * Activity instance shared by the state and the task running it
+ */
+template < typename Activity >
+class activity_control {
+public:
+    using activity_type = Activity;
+public:
+    /**
+     * Called by the task before starting the activity.
+     * @return false if the activity was cancelled
+     */
+    bool
+    begin()
+    {
+        ::std::lock_guard< ::std::mutex > lock{mutex_};
+        if (status_ == status::cancelled)
+            return false;
+        status_ = status::running;
+        thread_ = ::std::this_thread::get_id();
+        return true;
+    }
+    void
+    finish()
+    {
+        {
+            ::std::lock_guard< ::std::mutex > lock{mutex_};
+            status_ = status::done;
+        }
+        finished_.notify_all();
+    }
+    /**
+     * Prevent a pending activity from starting.
+     * @return false if the activity has already started
+     */
+    bool
+    cancel()
+    {
+        ::std::lock_guard< ::std::mutex > lock{mutex_};
+        if (status_ == status::pending) {
+            status_ = status::cancelled;
+            return true;
+        }
+        return false;
+    }
+    /**
+     * Wait for the activity to finish. The activity's own thread doesn't
+     * wait, the activity has left its state by processing an event and
+     * returns when the call stack unwinds.
+     */
+    void
+    wait()
+    {
+        ::std::unique_lock< ::std::mutex > lock{mutex_};
+        if (thread_ == ::std::this_thread::get_id())
+            return;
+        finished_.wait(lock, [this]{ return status_ == status::done; });
+    }
+
+    activity_type               activity{};
+private:
+    enum class status {
+        pending,
+        running,
+        done,
+        cancelled
+    };
+    ::std::mutex                mutex_{};
+    ::std::condition_variable   finished_{};
+    status                      status_{status::pending};
+    ::std::thread::id           thread_{};
+};
+
+/**
+ * Starts and stops the activity of a state.
+ *
+ * The activity's start(fsm, state) is posted to the executor when the
+ * state is entered. When the state is exited the activity is cancelled
+ * if it hasn't started yet, otherwise its stop(fsm, state) is called in
+ * the exiting thread and the exit waits for start to return. So start
+ * must return soon after stop is called, and no activity code runs after
+ * the state is left. The exit doesn't wait if the activity itself leaves
+ * the state by processing an event, start returns after the event.
+ * Each entry to the state runs a new instance of the activity. A state
+ * must not be moved while its activity runs.
+ * An exception thrown by start is caught in the executor thread and
+ * reported to the observer of the root machine with activity_error.
+ */
+template < typename Activity >
+class activity_runner {
+public:
+    using activity_type = Activity;
+    using control_type  = activity_control<activity_type>;
+public:
+    activity_runner() noexcept
+        : control_{}, stop_{} {}
+    // A copy of a state doesn't inherit the running activity
+    activity_runner(activity_runner const&) noexcept
+        : activity_runner{} {}
+    activity_runner(activity_runner&&) noexcept
+        : activity_runner{} {}
+    activity_runner&
+    operator = (activity_runner const&) = delete;
+    activity_runner&
+    operator = (activity_runner&&) = delete;
+    ~activity_runner()
+    {
+        stop();
+    }
+
+    void
+    swap(activity_runner& rhs) noexcept
+    {
+        using ::std::swap;
+        swap(control_, rhs.control_);
+        swap(stop_, rhs.stop_);
+    }
+
+    bool
+    active() const noexcept
+    { return static_cast<bool>(control_); }
+
+    template < typename FSM, typename State >
+    void
+    start(FSM& fsm, State& state)
+    {
+        stop();
+        auto control = ::std::make_shared<control_type>();
+        auto&& executor = activity_executor(fsm);
+        stop_ = [control, &fsm, &state]{ control->activity.stop(fsm, state); };
+        control_ = control;
+        executor.post([control, &fsm, &state]{
+            if (control->begin()) {
+                finish_guard guard{*control};
+                try {
+                    control->activity.start(fsm, state);
+                } catch (...) {
+                    root_machine(fsm).activity_error(fsm, state, ::std::current_exception());
+                }
+            }
+        });
+    }
+    void
+    stop()
+    {
+        if (!control_)
+            return;
+        auto control = ::std::move(control_);
+        auto stop_activity = ::std::move(stop_);
+        control_.reset();
+        stop_ = nullptr;
+        if (!control->cancel()) {
+            stop_activity();
+            control->wait();
+        }
+    }
+private:
+    struct finish_guard {
+        ~finish_guard()
+        { control.finish(); }
+        control_type& control;
+    };
+private:
+    ::std::shared_ptr<control_type> control_;
+    ::std::function<void()>         stop_;
+};
+
+template <>
+class activity_runner<void> {
+public:
+    void
+    swap(activity_runner&) noexcept {}
+    bool
+    active() const noexcept
+    { return false; }
+    template < typename FSM, typename State >
+    void
+    start(FSM&, State&) noexcept {}
+    void
+    stop() noexcept {}
+};
+
+/**
+ * Keeps the activity runner of a state as a base, so a state without
+ * an activity takes no space for it. The runner is reachable only with
+ * state_activity(), its members don't mix with the state's.
+ */
+template < typename Activity >
+class activity_holder : private activity_runner<Activity> {
+public:
+    using activity_runner_type = activity_runner<Activity>;
+
+    activity_runner_type&
+    state_activity() noexcept
+    { return *this; }
+    activity_runner_type const&
+    state_activity() const noexcept
+    { return *this; }
+};
+
+}  /* namespace detail */
+}  /* namespace afsm */
+
+#endif /* AFSM_DETAIL_ACTIVITY_HPP_ */
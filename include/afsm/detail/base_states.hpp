@@ -10,6 +10,7 @@
 
 #include <afsm/definition.hpp>
 #include <afsm/detail/helpers.hpp>
+#include <afsm/detail/activity.hpp>
 #include <afsm/detail/transitions.hpp>
 #include <afsm/detail/orthogonal_regions.hpp>
 #include <afsm/detail/event_identity.hpp>
@@ -68,7 +69,7 @@ struct state_containment_type :
         >::type {};
 
 template < typename T, bool isTerminal >
-struct state_base_impl : T {
+struct state_base_impl : T, activity_holder< typename T::activity > {
     using state_definition_type = T;
     using state_type            = state_base_impl<T, isTerminal>;
     using internal_transitions = typename state_definition_type::internal_transitions;
@@ -80,7 +81,7 @@ struct state_base_impl : T {
     using handled_events =
             typename def::detail::handled_events<state_definition_type>::type;
     using internal_events =
-            typename def::detail::handled_events<state_definition_type>::type;
+            typename def::detail::handled_events<internal_transitions>::type;
     static_assert(def::traits::is_state_machine<state_definition_type>::value
                 || !def::detail::has_default_transitions< handled_events >::value,
             "Internal transition cannot be a default transition");
@@ -91,7 +92,10 @@ struct state_base_impl : T {
                 typename ::psst::meta::unique< typename T::deferred_events >::type
             >::type;
 
-    state_base_impl() : state_definition_type{} {}
+    using activity_holder_type = activity_holder< typename state_definition_type::activity >;
+    using activity_runner_type = typename activity_holder_type::activity_runner_type;
+
+    state_base_impl() : state_definition_type{}, activity_holder_type{} {}
     state_base_impl(state_base_impl const&) = default;
     state_base_impl(state_base_impl&&) = default;
 
@@ -105,44 +109,20 @@ struct state_base_impl : T {
     {
         using ::std::swap;
         swap(static_cast<T&>(*this), static_cast<T&>(rhs));
+        this->state_activity().swap(rhs.state_activity());
     }
     template < typename Event, typename FSM >
     void
-    state_enter(Event&&, FSM&) {}
+    state_enter(Event&&, FSM&) noexcept {}
     template < typename Event, typename FSM >
     void
-    state_exit(Event&&, FSM&) {}
-
-    event_set const&
-    current_handled_events() const
-    { return static_handled_events(); }
-    event_set const&
-    current_deferrable_events() const
-    { return static_deferrable_events(); }
-
-    static event_set const&
-    static_handled_events()
-    {
-        static event_set evts_ = make_event_set(handled_events{});
-        return evts_;
-    }
-    static event_set const&
-    internal_handled_events()
-    {
-        static event_set evts_ = make_event_set(typename def::detail::handled_events< internal_transitions >::type{});
-        return evts_;
-    }
+    state_exit(Event&&, FSM&) noexcept {}
 
-    static event_set const&
-    static_deferrable_events()
-    {
-        static event_set evts_ = make_event_set(deferred_events{});
-        return evts_;
-    }
+    using activity_holder_type::state_activity;
 protected:
     template< typename ... Args >
     state_base_impl(Args&& ... args)
-        : state_definition_type(::std::forward<Args>(args)...) {}
+        : state_definition_type(::std::forward<Args>(args)...), activity_holder_type{} {}
 };
 
 template < typename T >
@@ -159,6 +139,8 @@ struct state_base_impl<T, true> : T {
     static_assert(::std::is_same<
             typename state_definition_type::deferred_events, void >::value,
             "Terminal state must not define deferred events");
+    static_assert(!def::traits::has_activity<state_definition_type>::value,
+            "Terminal state must not define an activity");
 
     using handled_events  = ::psst::meta::type_tuple<>;
     using internal_events = ::psst::meta::type_tuple<>;
@@ -182,36 +164,11 @@ struct state_base_impl<T, true> : T {
 
     template < typename Event, typename FSM >
     void
-    state_enter(Event&&, FSM&) {}
+    state_enter(Event&&, FSM&) noexcept {}
     template < typename Event, typename FSM >
     void
-    state_exit(Event&&, FSM&) {}
+    state_exit(Event&&, FSM&) noexcept {}
 
-    event_set const&
-    current_handled_events() const
-    { return static_handled_events(); }
-    event_set const&
-    current_deferrable_events() const
-    { return static_deferrable_events(); }
-
-    static event_set const&
-    static_handled_events()
-    {
-        static event_set evts_{};
-        return evts_;
-    }
-    static event_set const&
-    internal_handled_events()
-    {
-        static event_set evts_{};
-        return evts_;
-    }
-    static event_set const&
-    static_deferrable_events()
-    {
-        static event_set evts_{};
-        return evts_;
-    }
 protected:
     template< typename ... Args >
     state_base_impl(Args&& ... args)
@@ -242,6 +199,58 @@ struct popup_state : state_base_impl<T, true> { // TODO Check if the state is te
     }
 };
 
+/**
+ * Pointer to the enclosing state machine of a state.
+ */
+template < typename FSM, bool KeepPointer >
+class enclosing_fsm_holder {
+public:
+    enclosing_fsm_holder(FSM& fsm) : fsm_{&fsm} {}
+
+    FSM&
+    enclosing_fsm()
+    { return *fsm_; }
+    FSM const&
+    enclosing_fsm() const
+    { return *fsm_; }
+    void
+    enclosing_fsm(FSM& fsm)
+    { fsm_ = &fsm; }
+private:
+    FSM*    fsm_;
+};
+
+/**
+ * States tagged with def::tags::no_enclosing_fsm_pointer don't keep the
+ * pointer, the machine passes itself when dispatching an event to the
+ * state.
+ */
+template < typename FSM >
+class enclosing_fsm_holder<FSM, false> {
+public:
+    enclosing_fsm_holder(FSM&) {}
+
+    template < typename F = FSM >
+    F&
+    enclosing_fsm()
+    {
+        static_assert(!::std::is_same<F, F>::value,
+            "A state tagged with def::tags::no_enclosing_fsm_pointer cannot access the enclosing state machine");
+        return *static_cast<F*>(nullptr);
+    }
+    template < typename F = FSM >
+    F const&
+    enclosing_fsm() const
+    {
+        static_assert(!::std::is_same<F, F>::value,
+            "A state tagged with def::tags::no_enclosing_fsm_pointer cannot access the enclosing state machine");
+        return *static_cast<F const*>(nullptr);
+    }
+    void
+    enclosing_fsm(FSM&) noexcept
+    {}
+};
+
 template < typename T >
 class state_base : public ::std::conditional<
         def::traits::is_pushdown<T>::value,
@@ -296,6 +305,7 @@ protected:
 
 template < typename T, typename Mutex, typename FrontMachine >
 class state_machine_base_impl : public state_base<T>,
+        private allocator_base< machine_allocator_type<FrontMachine, T> >,
         public transitions::transition_container<FrontMachine, T,
                 typename detail::size_type<Mutex>::type> {
 public:
@@ -303,6 +313,7 @@ public:
     using state_type                    = state_base<T>;
     using machine_type                  = state_machine_base_impl<T, Mutex, FrontMachine>;
     using front_machine_type            = FrontMachine;
+    using event_set                     = typename detail::machine_event_set<FrontMachine, T>::type;
     static_assert(def::traits::is_state_machine<T>::value,
             "Front state machine can be created only with a descendant of afsm::def::state_machine");
     using transitions = typename state_machine_definition_type::transitions;
@@ -332,6 +343,8 @@ public:
     using container_base  =
             afsm::transitions::transition_container<
                     front_machine_type, state_machine_definition_type, size_type>;
+    using allocator_type    = machine_allocator_type<front_machine_type, state_machine_definition_type>;
+    using allocator_holder  = allocator_base<allocator_type>;
 
     template < typename State >
     using substate_type     = typename detail::substate_type<front_machine_type, State>::type;
@@ -339,16 +352,18 @@ public:
     using contains_substate = def::contains_substate<front_machine_type, State>;
 public:
     state_machine_base_impl(front_machine_type* fsm)
-        : state_type{},
-          container_base{fsm}
+        : state_machine_base_impl{fsm, ::std::allocator_arg, allocator_type{}}
     {}
 
     state_machine_base_impl(front_machine_type* fsm, state_machine_base_impl const& rhs)
         : state_type{static_cast<state_type const&>(rhs)},
+          allocator_holder{ allocator_holder::allocator_traits::
+                select_on_container_copy_construction(rhs.get_allocator()) },
           container_base{fsm, rhs}
     {}
     state_machine_base_impl(front_machine_type* fsm, state_machine_base_impl&& rhs)
         : state_type{static_cast<state_type&&>(rhs)},
+          allocator_holder{ rhs.get_allocator() },
           container_base{fsm, ::std::move(rhs)}
     {}
 
@@ -360,9 +375,18 @@ public:
     {
         using ::std::swap;
         static_cast<state_type&>(*this).swap(rhs);
+        this->swap_allocator(rhs);
         transitions_.swap(rhs.transitions_);
     }
 
+    /**
+     * Allocator of the outermost state machine, the pushdown stacks of
+     * this machine and of the inner machines use it.
+     */
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_holder::allocator(); }
+
     state_machine_base_impl&
     operator = (state_machine_base_impl const& rhs) = delete;
     state_machine_base_impl&
@@ -435,26 +459,42 @@ public:
     event_set
     current_handled_events() const
     {
-        auto const& intl = state_type::internal_handled_events();
         auto res = transitions_.current_handled_events();
-        res.insert(intl.begin(), intl.end());
+        res |= internal_handled_events();
         return res;
     }
 
     event_set
     current_deferrable_events() const
     {
-        auto const& own = state_type::current_deferrable_events();
         auto res = transitions_.current_deferrable_events();
-        res.insert(own.begin(), own.end());
+        res |= static_deferrable_events();
         return res;
     }
+
+    static event_set const&
+    static_handled_events()
+    { return detail::event_mask<event_set, typename state_type::handled_events>::value; }
+    static event_set const&
+    internal_handled_events()
+    { return detail::event_mask<event_set, typename state_type::internal_events>::value; }
+    static event_set const&
+    static_deferrable_events()
+    { return detail::event_mask<event_set, typename state_type::deferred_events>::value; }
 protected:
-    template<typename ... Args>
+    template<typename ... Args, typename = typename ::std::enable_if<
+            !starts_with_allocator_arg<Args...>::value >::type>
     explicit
     state_machine_base_impl(front_machine_type* fsm, Args&& ... args)
+        : state_machine_base_impl{fsm, ::std::allocator_arg, allocator_type{},
+                ::std::forward<Args>(args)...}
+    {}
+    template<typename ... Args>
+    state_machine_base_impl(front_machine_type* fsm, ::std::allocator_arg_t const&,
+            allocator_type const& alloc, Args&& ... args)
         : state_type(::std::forward<Args>(args)...),
-          container_base{fsm}
+          allocator_holder{alloc},
+          container_base{fsm, alloc}
     {}
 
     template < typename FSM, typename Event >
@@ -621,11 +661,11 @@ struct state_machine_base_with_base : state_machine_base_impl<T, Mutex, FrontMac
     {
     }
     state_machine_base_with_base(FrontMachine* fsm, state_machine_base_with_base const& rhs)
-        : base_type{fsm, rhs}
+        : base_type{fsm, static_cast<base_type const&>(rhs)}
     {
     }
     state_machine_base_with_base(FrontMachine* fsm, state_machine_base_with_base&& rhs)
-        : base_type{fsm, ::std::move(rhs)}
+        : base_type{fsm, static_cast<base_type&&>(rhs)}
     {
     }
 
@@ -656,6 +696,7 @@ protected:
 
 template < typename T, typename Mutex, typename FrontMachine >
 class orthogonal_state_machine : public state_base<T>,
+        private allocator_base< machine_allocator_type<FrontMachine, T> >,
         public orthogonal::region_container<FrontMachine, T,
                 typename detail::size_type<Mutex>::type> {
 public:
@@ -663,6 +704,7 @@ public:
     using state_type                    = state_base<T>;
     using machine_type                  = orthogonal_state_machine<T, Mutex, FrontMachine>;
     using front_machine_type            = FrontMachine;
+    using event_set                     = typename detail::machine_event_set<FrontMachine, T>::type;
     static_assert(def::traits::is_state_machine<T>::value,
             "Front state machine can be created only with a descendant of afsm::def::state_machine");
     using orthogonal_regions            = typename state_machine_definition_type::orthogonal_regions;
@@ -677,6 +719,8 @@ public:
     using container_base    =
             orthogonal::region_container<front_machine_type, state_machine_definition_type, size_type>;
     using region_tuple                  = typename container_base::region_tuple;
+    using allocator_type                = machine_allocator_type<front_machine_type, state_machine_definition_type>;
+    using allocator_holder              = allocator_base<allocator_type>;
 
     template < typename State >
     using substate_type     = typename detail::substate_type<front_machine_type, State>::type;
@@ -684,15 +728,17 @@ public:
     using contains_substate = def::contains_substate<front_machine_type, State>;
 public:
     orthogonal_state_machine(front_machine_type* fsm)
-        : state_type{},
-          container_base{fsm}
+        : orthogonal_state_machine{fsm, ::std::allocator_arg, allocator_type{}}
     {}
     orthogonal_state_machine(front_machine_type* fsm, orthogonal_state_machine const& rhs)
         : state_type{static_cast<state_type const&>(rhs)},
+          allocator_holder{ allocator_holder::allocator_traits::
+                select_on_container_copy_construction(rhs.get_allocator()) },
           container_base{fsm, rhs}
     {}
     orthogonal_state_machine(front_machine_type* fsm, orthogonal_state_machine&& rhs)
         : state_type{static_cast<state_type&&>(rhs)},
+          allocator_holder{ rhs.get_allocator() },
           container_base{fsm, ::std::move(rhs)}
     {}
 
@@ -704,9 +750,18 @@ public:
     {
         using ::std::swap;
         static_cast<state_type&>(*this).swap(rhs);
+        this->swap_allocator(rhs);
         regions_.swap(rhs.regions_);
     }
 
+    /**
+     * Allocator of the outermost state machine, the pushdown stacks of
+     * this machine and of the regions use it.
+     */
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_holder::allocator(); }
+
     orthogonal_state_machine&
     operator = (orthogonal_state_machine const& rhs) = delete;
     orthogonal_state_machine&
@@ -774,25 +829,41 @@ public:
     event_set
     current_handled_events() const
     {
-        auto const& intl = state_type::internal_handled_events();
-        event_set res = regions_.current_handled_events();
-        res.insert(intl.begin(), intl.end());
+        auto res = regions_.current_handled_events();
+        res |= internal_handled_events();
         return res;
     }
     event_set
     current_deferrable_events() const
     {
-        auto const& own = state_type::current_deferrable_events();
         auto res = regions_.current_deferrable_events();
-        res.insert(own.begin(), own.end());
+        res |= static_deferrable_events();
         return res;
     }
+
+    static event_set const&
+    static_handled_events()
+    { return detail::event_mask<event_set, typename state_type::handled_events>::value; }
+    static event_set const&
+    internal_handled_events()
+    { return detail::event_mask<event_set, typename state_type::internal_events>::value; }
+    static event_set const&
+    static_deferrable_events()
+    { return detail::event_mask<event_set, typename state_type::deferred_events>::value; }
 protected:
-    template < typename ... Args >
+    template < typename ... Args, typename = typename ::std::enable_if<
+            !starts_with_allocator_arg<Args...>::value >::type >
     explicit
     orthogonal_state_machine(front_machine_type* fsm, Args&& ... args)
+        : orthogonal_state_machine{fsm, ::std::allocator_arg, allocator_type{},
+                ::std::forward<Args>(args)...}
+    {}
+    template < typename ... Args >
+    orthogonal_state_machine(front_machine_type* fsm, ::std::allocator_arg_t const&,
+            allocator_type const& alloc, Args&& ... args)
         : state_type(::std::forward<Args>(args)...),
-          container_base{fsm}
+          allocator_holder{alloc},
+          container_base{fsm, alloc}
     {}
 
     template < typename FSM, typename Event >
@@ -966,9 +1037,11 @@ public:
     state_machine_base(FrontMachine* fsm)
         : state_machine_impl_type{fsm} {}
     state_machine_base(FrontMachine* fsm, state_machine_base const& rhs)
-        : state_machine_impl_type{fsm, rhs} {}
+        : state_machine_impl_type{fsm,
+                static_cast<state_machine_impl_type const&>(rhs)} {}
     state_machine_base(FrontMachine* fsm, state_machine_base&& rhs)
-        : state_machine_impl_type{fsm, ::std::move(rhs)} {}
+        : state_machine_impl_type{fsm,
+                static_cast<state_machine_impl_type&&>(rhs)} {}
 
     state_machine_base(state_machine_base const&) = delete;
     state_machine_base(state_machine_base&&) = delete;
@@ -32,6 +32,9 @@ operator << (::std::ostream& os, event_process_result const& val)
             case event_process_result::defer:
                 os << "defer";
                 break;
+            case event_process_result::overflow:
+                os << "overflow";
+                break;
             default:
                 break;
         }
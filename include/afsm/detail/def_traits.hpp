@@ -11,6 +11,7 @@
 #include <afsm/definition_fwd.hpp>
 #include <afsm/detail/tags.hpp>
 #include <afsm/detail/exception_safety_guarantees.hpp>
+#include <memory>
 
 namespace afsm {
 namespace def {
@@ -86,6 +87,19 @@ template < typename T >
 struct has_history
     : ::std::is_base_of< tags::has_history, T > {};
 
+template < typename T >
+struct no_state_reset
+    : ::std::is_base_of< tags::no_state_reset, T > {};
+
+template < typename T >
+struct has_enclosing_fsm_pointer
+    : ::std::integral_constant< bool,
+        !::std::is_base_of< tags::no_enclosing_fsm_pointer, T >::value > {};
+
+template < typename T >
+struct compact_state_storage
+    : ::std::is_base_of< tags::compact_state_storage, T > {};
+
 template < typename T >
 struct allow_empty_transition_functions
     : ::std::is_base_of< tags::allow_empty_enter_exit, T > {};
@@ -94,6 +108,18 @@ template < typename T >
 struct has_orthogonal_regions
     : ::std::integral_constant<bool, !::std::is_same< typename T::orthogonal_regions, void >::value> {};
 
+template < typename T >
+struct has_parallel_regions
+    : ::std::is_base_of< tags::parallel_regions, T > {};
+
+template < typename T >
+struct has_activity_executor
+    : ::std::is_base_of< tags::custom_activity_executor, T > {};
+
+template < typename T >
+struct has_activity
+    : ::std::integral_constant<bool, !::std::is_same< typename T::activity, void >::value> {};
+
 template < typename T >
 struct exception_safety {
     using type = typename ::std::conditional<
@@ -107,6 +133,99 @@ struct exception_safety {
     >::type;
 };
 
+template < typename T >
+struct event_queue_policy {
+    using type = typename ::std::conditional<
+        ::std::is_base_of<tags::lock_free_event_queue, T>::value,
+        tags::lock_free_event_queue,
+        tags::mutex_event_queue
+    >::type;
+};
+
+namespace detail {
+
+template < typename T, bool HasEventStorage >
+struct event_storage_size
+    : ::std::integral_constant< ::std::size_t, tags::default_event_storage_size > {};
+
+template < typename T >
+struct event_storage_size< T, true >
+    : ::std::integral_constant< ::std::size_t, T::queued_event_storage_size > {};
+
+}  /* namespace detail */
+
+template < typename T >
+struct event_storage_size
+    : detail::event_storage_size< T,
+        ::std::is_base_of< tags::has_event_storage_size, T >::value > {};
+
+namespace detail {
+
+template < typename T, bool HasQueueCapacity >
+struct event_queue_capacity
+    : ::std::integral_constant< ::std::size_t, 0 > {
+    using overflow_policy = tags::reject_on_full_queue;
+};
+
+template < typename T >
+struct event_queue_capacity< T, true >
+    : ::std::integral_constant< ::std::size_t, T::queued_event_capacity > {
+    using overflow_policy = typename T::queue_overflow_policy;
+};
+
+}  /* namespace detail */
+
+/**
+ * Maximum number of events in the state machine queue, zero for an
+ * unbounded queue.
+ */
+template < typename T >
+struct event_queue_capacity
+    : detail::event_queue_capacity< T,
+        ::std::is_base_of< tags::has_event_queue_capacity, T >::value > {};
+
+namespace detail {
+
+template < typename T, bool HasDepth >
+struct pushdown_depth
+    : ::std::integral_constant< ::std::size_t, 0 > {};
+
+template < typename T >
+struct pushdown_depth< T, true >
+    : ::std::integral_constant< ::std::size_t, T::max_pushdown_depth > {};
+
+}  /* namespace detail */
+
+/**
+ * Maximum depth of a pushdown machine stack, zero for an unlimited stack.
+ */
+template < typename T >
+struct pushdown_depth
+    : detail::pushdown_depth< T,
+        ::std::is_base_of< tags::has_pushdown_depth, T >::value > {};
+
+namespace detail {
+
+template < typename T, bool HasAllocator >
+struct allocator_type {
+    using type = ::std::allocator<char>;
+};
+
+template < typename T >
+struct allocator_type< T, true > {
+    using type = typename T::machine_allocator_type;
+};
+
+}  /* namespace detail */
+
+/**
+ * Allocator of the state machine containers
+ */
+template < typename T >
+struct allocator_type
+    : detail::allocator_type< T,
+        ::std::is_base_of< tags::has_allocator, T >::value > {};
+
 namespace detail {
 template < typename T, bool HasCommonBase >
 struct inner_states_def {
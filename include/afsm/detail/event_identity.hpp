@@ -9,7 +9,8 @@
 #define AFSM_DETAIL_EVENT_IDENTITY_HPP_
 
 #include <type_traits>
-#include <set>
+#include <cstdint>
+#include <cstddef>
 #include <pushkin/meta/type_tuple.hpp>
 
 namespace afsm {
@@ -33,16 +34,263 @@ struct event_identity {
     using type          = event<event_type>;
 };
 
-using event_set         = ::std::set< event_base::id_type const* >;
+/**
+ * Fixed-size set of event types.
+ *
+ * Each event type in the Events tuple gets a dense compile-time index,
+ * which is the position of the event in the tuple. Membership tests,
+ * unions and intersections are word-wide bit operations and never
+ * allocate. Event types that are not in the Events tuple are silently
+ * ignored when a set is built.
+ */
+template < typename Events >
+class event_set;
+
+template < typename ... Events >
+class event_set< ::psst::meta::type_tuple<Events...> > {
+public:
+    using events_tuple  = ::psst::meta::type_tuple<Events...>;
+    using word_type     = ::std::uint64_t;
+    using size_type     = ::std::size_t;
+
+    static constexpr size_type npos         = static_cast<size_type>(-1);
+    static constexpr size_type capacity     = sizeof ... (Events);
+    static constexpr size_type word_bits    = sizeof(word_type) * 8;
+    static constexpr size_type word_count   =
+            capacity == 0 ? 1 : (capacity + word_bits - 1) / word_bits;
+public:
+    constexpr event_set() : words_{} {}
+
+    /**
+     * Make a set of event types listed in the tuple.
+     */
+    template < typename ... T >
+    static constexpr event_set
+    make(::psst::meta::type_tuple<T...> const&)
+    {
+        event_set res{};
+        size_type const indexes[] = { npos, index<T>()... };
+        for (auto idx : indexes) {
+            res.set(idx);
+        }
+        return res;
+    }
+
+    /**
+     * Dense index of the event type in the set, npos if the type is not
+     * in the set's events tuple.
+     */
+    template < typename Event >
+    static constexpr size_type
+    index()
+    {
+        using search = ::psst::meta::index_of<
+                typename ::std::decay<Event>::type, events_tuple >;
+        return search::found ? search::value : npos;
+    }
+
+    constexpr bool
+    test(size_type idx) const
+    {
+        return idx < capacity &&
+                (words_[idx / word_bits] & bit(idx)) != 0;
+    }
+    template < typename Event >
+    constexpr bool
+    contains() const
+    {
+        return test(index<Event>());
+    }
+    /**
+     * Compatibility lookup by event identity. Linear in the size of the
+     * events tuple, use contains or test on hot paths.
+     */
+    size_type
+    count(event_base::id_type const* id) const
+    {
+        for (size_type i = 0; i < capacity; ++i) {
+            if (ids_[i] == id)
+                return test(i) ? 1 : 0;
+        }
+        return 0;
+    }
+
+    constexpr void
+    set(size_type idx)
+    {
+        if (idx < capacity)
+            words_[idx / word_bits] |= bit(idx);
+    }
+    constexpr void
+    reset(size_type idx)
+    {
+        if (idx < capacity)
+            words_[idx / word_bits] &= ~bit(idx);
+    }
+    template < typename Event >
+    void
+    insert()
+    {
+        set(index<Event>());
+    }
+    constexpr void
+    clear()
+    {
+        for (auto& w : words_)
+            w = 0;
+    }
+
+    /**
+     * Number of event types in the set
+     */
+    constexpr size_type
+    size() const
+    {
+        size_type res{0};
+        for (auto w : words_) {
+            for (; w; w &= w - 1)
+                ++res;
+        }
+        return res;
+    }
+    constexpr bool
+    empty() const
+    {
+        for (auto w : words_) {
+            if (w) return false;
+        }
+        return true;
+    }
+    /**
+     * Index of the first event type in the set at or after idx, npos if
+     * there is none.
+     */
+    constexpr size_type
+    next(size_type idx = 0) const
+    {
+        while (idx < capacity) {
+            auto w = words_[idx / word_bits] >> (idx % word_bits);
+            if (!w) {
+                idx = (idx / word_bits + 1) * word_bits;
+                continue;
+            }
+            for (; !(w & 1); w >>= 1)
+                ++idx;
+            return idx;
+        }
+        return npos;
+    }
+    constexpr bool
+    intersects(event_set const& rhs) const
+    {
+        for (size_type i = 0; i < word_count; ++i) {
+            if (words_[i] & rhs.words_[i])
+                return true;
+        }
+        return false;
+    }
+
+    void
+    swap(event_set& rhs) noexcept
+    {
+        for (size_type i = 0; i < word_count; ++i) {
+            auto tmp = words_[i];
+            words_[i] = rhs.words_[i];
+            rhs.words_[i] = tmp;
+        }
+    }
+
+    constexpr event_set&
+    operator |= (event_set const& rhs)
+    {
+        for (size_type i = 0; i < word_count; ++i)
+            words_[i] |= rhs.words_[i];
+        return *this;
+    }
+    constexpr event_set&
+    operator &= (event_set const& rhs)
+    {
+        for (size_type i = 0; i < word_count; ++i)
+            words_[i] &= rhs.words_[i];
+        return *this;
+    }
+    /**
+     * Remove event types contained in rhs
+     */
+    constexpr event_set&
+    operator -= (event_set const& rhs)
+    {
+        for (size_type i = 0; i < word_count; ++i)
+            words_[i] &= ~rhs.words_[i];
+        return *this;
+    }
+    friend constexpr event_set
+    operator | (event_set lhs, event_set const& rhs)
+    {
+        return lhs |= rhs;
+    }
+    friend constexpr event_set
+    operator & (event_set lhs, event_set const& rhs)
+    {
+        return lhs &= rhs;
+    }
+    friend constexpr event_set
+    operator - (event_set lhs, event_set const& rhs)
+    {
+        return lhs -= rhs;
+    }
+    friend constexpr bool
+    operator == (event_set const& lhs, event_set const& rhs)
+    {
+        for (size_type i = 0; i < word_count; ++i) {
+            if (lhs.words_[i] != rhs.words_[i])
+                return false;
+        }
+        return true;
+    }
+    friend constexpr bool
+    operator != (event_set const& lhs, event_set const& rhs)
+    {
+        return !(lhs == rhs);
+    }
+private:
+    static constexpr word_type
+    bit(size_type idx)
+    {
+        return word_type{1} << (idx % word_bits);
+    }
+    static constexpr event_base::id_type const* ids_[capacity + 1] = {
+            &event_identity<Events>::type::id..., nullptr };
+private:
+    word_type words_[word_count];
+};
+
+template < typename ... Events >
+constexpr typename event_set< ::psst::meta::type_tuple<Events...> >::size_type
+    event_set< ::psst::meta::type_tuple<Events...> >::npos;
+template < typename ... Events >
+constexpr typename event_set< ::psst::meta::type_tuple<Events...> >::size_type
+    event_set< ::psst::meta::type_tuple<Events...> >::capacity;
+template < typename ... Events >
+constexpr typename event_set< ::psst::meta::type_tuple<Events...> >::size_type
+    event_set< ::psst::meta::type_tuple<Events...> >::word_bits;
+template < typename ... Events >
+constexpr typename event_set< ::psst::meta::type_tuple<Events...> >::size_type
+    event_set< ::psst::meta::type_tuple<Events...> >::word_count;
+template < typename ... Events >
+constexpr event_base::id_type const*
+    event_set< ::psst::meta::type_tuple<Events...> >::ids_[];
+
+/**
+ * Compile-time set of events
+ */
+template < typename EventSet, typename Events >
+struct event_mask {
+    static constexpr EventSet value = EventSet::make(Events{});
+};
 
-template < typename ... T >
-event_set
-make_event_set( ::psst::meta::type_tuple<T...> const& )
-{
-    return event_set{
-        &event_identity<T>::type::id...
-    };
-}
+template < typename EventSet, typename Events >
+constexpr EventSet event_mask<EventSet, Events>::value;
 
 }  /* namespace detail */
 }  /* namespace afsm */
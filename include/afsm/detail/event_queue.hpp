@@ -0,0 +1,1312 @@
+/*
+ * event_queue.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_DETAIL_EVENT_QUEUE_HPP_
+#define AFSM_DETAIL_EVENT_QUEUE_HPP_
+
+#include <afsm/detail/actions.hpp>
+#include <afsm/detail/helpers.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+namespace afsm {
+namespace detail {
+
+/**
+ * Queued event with a handler for the result of processing it.
+ */
+template < typename Event, typename Handler >
+struct completion_event {
+    Event   event;
+    Handler handler;
+};
+
+/**
+ * Event to pass to the observer for a queued event.
+ */
+template < typename Event >
+Event const&
+observed_event(Event const& event)
+{
+    return event;
+}
+
+template < typename Event, typename Handler >
+Event const&
+observed_event(completion_event<Event, Handler> const& event)
+{
+    return event.event;
+}
+
+/**
+ * Called for a queued event that is discarded without processing.
+ */
+template < typename Event >
+void
+discard_event(Event&, actions::event_process_result)
+{}
+
+/**
+ * The handler of a discarded completion event gets the result.
+ */
+template < typename Event, typename Handler >
+void
+discard_event(completion_event<Event, Handler>& event, actions::event_process_result res)
+{
+    event.handler(res);
+}
+
+/**
+ * What to do with an event posted to a full queue.
+ */
+enum class queue_overflow_action {
+    push,       /**< Room was made, push the event */
+    discard,    /**< Discard the event */
+    wait,       /**< Wait for room in the queue */
+};
+
+/**
+ * Type-erased event waiting in a state machine queue.
+ *
+ * Events that fit into StorageSize bytes and are nothrow move
+ * constructible are stored in place, others are allocated on the heap.
+ * The item holds the dense event index used for deferred event
+ * bookkeeping.
+ */
+template < typename FSM, ::std::size_t StorageSize >
+class queued_event {
+public:
+    using fsm_type      = FSM;
+    using result_type   = actions::event_process_result;
+    using size_type     = ::std::size_t;
+
+    template < typename Event >
+    using invoke_function = result_type(*)(fsm_type&, Event&&);
+
+    static constexpr size_type storage_size =
+            StorageSize < sizeof(void*) ? sizeof(void*) : StorageSize;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    template < typename Event >
+    struct is_inline : ::std::integral_constant<bool,
+            sizeof(Event) <= storage_size &&
+            alignof(Event) <= alignof(::std::max_align_t) &&
+            ::std::is_nothrow_move_constructible<Event>::value> {};
+public:
+    queued_event() noexcept
+        : storage_{}, vtbl_{nullptr}, index_{npos} {}
+
+    queued_event(queued_event const&) = delete;
+    queued_event(queued_event&& rhs) noexcept
+        : storage_{}, vtbl_{rhs.vtbl_}, index_{rhs.index_}
+    {
+        if (vtbl_) {
+            vtbl_->move(&storage_, &rhs.storage_);
+            rhs.vtbl_ = nullptr;
+        }
+    }
+    ~queued_event()
+    {
+        reset();
+    }
+
+    queued_event&
+    operator = (queued_event const&) = delete;
+    queued_event&
+    operator = (queued_event&& rhs) noexcept
+    {
+        if (this != &rhs) {
+            reset();
+            vtbl_ = rhs.vtbl_;
+            index_ = rhs.index_;
+            if (vtbl_) {
+                vtbl_->move(&storage_, &rhs.storage_);
+                rhs.vtbl_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    /**
+     * Make a queued event. Invoke is called with the stored event when
+     * the item is processed.
+     */
+    template < typename Event, invoke_function<Event> Invoke, typename T >
+    static queued_event
+    create(T&& event, size_type index)
+    {
+        queued_event res;
+        res.template emplace<Event, Invoke>(::std::forward<T>(event));
+        res.index_ = index;
+        return res;
+    }
+
+    /**
+     * Pass the stored event to the state machine.
+     * The event is moved from the storage.
+     */
+    result_type
+    operator()(fsm_type& fsm)
+    {
+        return vtbl_->invoke(fsm, &storage_);
+    }
+
+    /**
+     * Destroy the stored event without processing it, the handler of a
+     * completion event is called with the result.
+     */
+    void
+    discard(result_type res)
+    {
+        if (vtbl_) {
+            vtbl_->discard(&storage_, res);
+            reset();
+        }
+    }
+
+    size_type
+    index() const noexcept
+    { return index_; }
+
+    bool
+    empty() const noexcept
+    { return vtbl_ == nullptr; }
+
+    void
+    reset() noexcept
+    {
+        if (vtbl_) {
+            vtbl_->destroy(&storage_);
+            vtbl_ = nullptr;
+        }
+    }
+private:
+    using storage_type = typename ::std::aligned_storage<
+            storage_size, alignof(::std::max_align_t)>::type;
+
+    struct vtable {
+        result_type (*invoke)(fsm_type&, void*);
+        void        (*discard)(void*, result_type);
+        void        (*move)(void*, void*) noexcept;
+        void        (*destroy)(void*) noexcept;
+    };
+
+    template < typename Event, invoke_function<Event> Invoke,
+            bool Inline = is_inline<Event>::value >
+    struct event_ops {
+        static result_type
+        invoke(fsm_type& fsm, void* p)
+        {
+            return Invoke(fsm, ::std::move(*static_cast<Event*>(p)));
+        }
+        static void
+        discard(void* p, result_type res)
+        {
+            discard_event(*static_cast<Event*>(p), res);
+        }
+        static void
+        move(void* dst, void* src) noexcept
+        {
+            Event* evt = static_cast<Event*>(src);
+            new (dst) Event(::std::move(*evt));
+            evt->~Event();
+        }
+        static void
+        destroy(void* p) noexcept
+        {
+            static_cast<Event*>(p)->~Event();
+        }
+        static vtable const*
+        table() noexcept
+        {
+            static constexpr vtable _table{ &invoke, &discard, &move, &destroy };
+            return &_table;
+        }
+    };
+
+    template < typename Event, invoke_function<Event> Invoke >
+    struct event_ops< Event, Invoke, false > {
+        static Event*&
+        get(void* p)
+        {
+            return *static_cast<Event**>(p);
+        }
+        static result_type
+        invoke(fsm_type& fsm, void* p)
+        {
+            return Invoke(fsm, ::std::move(*get(p)));
+        }
+        static void
+        discard(void* p, result_type res)
+        {
+            discard_event(*get(p), res);
+        }
+        static void
+        move(void* dst, void* src) noexcept
+        {
+            new (dst) Event*(get(src));
+        }
+        static void
+        destroy(void* p) noexcept
+        {
+            delete get(p);
+        }
+        static vtable const*
+        table() noexcept
+        {
+            static constexpr vtable _table{ &invoke, &discard, &move, &destroy };
+            return &_table;
+        }
+    };
+
+    template < typename Event, invoke_function<Event> Invoke, typename T >
+    typename ::std::enable_if< is_inline<Event>::value >::type
+    emplace(T&& event)
+    {
+        new (&storage_) Event(::std::forward<T>(event));
+        vtbl_ = event_ops<Event, Invoke>::table();
+    }
+    template < typename Event, invoke_function<Event> Invoke, typename T >
+    typename ::std::enable_if< !is_inline<Event>::value >::type
+    emplace(T&& event)
+    {
+        new (&storage_) Event*(new Event(::std::forward<T>(event)));
+        vtbl_ = event_ops<Event, Invoke>::table();
+    }
+private:
+    storage_type    storage_;
+    vtable const*   vtbl_;
+    size_type       index_;
+};
+
+template < typename FSM, ::std::size_t StorageSize >
+constexpr ::std::size_t queued_event<FSM, StorageSize>::storage_size;
+template < typename FSM, ::std::size_t StorageSize >
+constexpr ::std::size_t queued_event<FSM, StorageSize>::npos;
+
+
+/**
+ * FIFO ring buffer of movable items.
+ *
+ * Capacity is a power of two, the buffer grows when full and never
+ * shrinks, so a steady push/pop cycle doesn't allocate.
+ */
+template < typename T, typename Allocator = ::std::allocator<T> >
+class ring_buffer : private allocator_base< rebind_alloc< Allocator,
+        typename ::std::aligned_storage< sizeof(T), alignof(T) >::type > > {
+public:
+    using value_type        = T;
+    using size_type         = ::std::size_t;
+    using allocator_type    = Allocator;
+
+    static constexpr size_type initial_capacity = 8;
+public:
+    ring_buffer() noexcept
+        : ring_buffer{ allocator_type{} } {}
+    explicit
+    ring_buffer(allocator_type const& alloc) noexcept
+        : base_type{ storage_allocator{alloc} },
+          buffer_{nullptr}, capacity_{0}, head_{0}, size_{0} {}
+    ring_buffer(ring_buffer const&) = delete;
+    ring_buffer(ring_buffer&& rhs) noexcept
+        : ring_buffer{ rhs.get_allocator() }
+    {
+        swap(rhs);
+    }
+    ~ring_buffer()
+    {
+        clear();
+        deallocate();
+    }
+
+    ring_buffer&
+    operator = (ring_buffer const&) = delete;
+    ring_buffer&
+    operator = (ring_buffer&& rhs) noexcept
+    {
+        ring_buffer tmp{::std::move(rhs)};
+        swap(tmp);
+        return *this;
+    }
+
+    void
+    swap(ring_buffer& rhs) noexcept
+    {
+        using ::std::swap;
+        this->swap_allocator(rhs);
+        swap(buffer_, rhs.buffer_);
+        swap(capacity_, rhs.capacity_);
+        swap(head_, rhs.head_);
+        swap(size_, rhs.size_);
+    }
+
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_type{ this->allocator() }; }
+
+    bool
+    empty() const noexcept
+    { return size_ == 0; }
+    size_type
+    size() const noexcept
+    { return size_; }
+    size_type
+    capacity() const noexcept
+    { return capacity_; }
+
+    value_type&
+    front()
+    { return *slot(head_); }
+    value_type const&
+    front() const
+    { return *slot(head_); }
+
+    void
+    push_back(value_type&& value)
+    {
+        if (size_ == capacity_)
+            grow(capacity_ ? capacity_ * 2 : initial_capacity);
+        new (slot(head_ + size_)) value_type(::std::move(value));
+        ++size_;
+    }
+    template < typename ... Args >
+    void
+    emplace_back(Args&& ... args)
+    {
+        push_back(value_type(::std::forward<Args>(args)...));
+    }
+    void
+    pop_front() noexcept
+    {
+        slot(head_)->~value_type();
+        head_ = (head_ + 1) & (capacity_ - 1);
+        --size_;
+    }
+    void
+    clear() noexcept
+    {
+        while (!empty())
+            pop_front();
+        head_ = 0;
+    }
+    /**
+     * Make sure the buffer can hold at least n items without allocation.
+     */
+    void
+    reserve(size_type n)
+    {
+        if (n > capacity_) {
+            size_type cap = capacity_ ? capacity_ : initial_capacity;
+            while (cap < n)
+                cap *= 2;
+            grow(cap);
+        }
+    }
+private:
+    using storage_type = typename ::std::aligned_storage<
+            sizeof(value_type), alignof(value_type)>::type;
+    using storage_allocator = rebind_alloc< allocator_type, storage_type >;
+    using base_type         = allocator_base< storage_allocator >;
+    using storage_traits    = typename base_type::allocator_traits;
+
+    value_type*
+    slot(size_type pos) noexcept
+    {
+        return reinterpret_cast<value_type*>(&buffer_[pos & (capacity_ - 1)]);
+    }
+    value_type const*
+    slot(size_type pos) const noexcept
+    {
+        return reinterpret_cast<value_type const*>(&buffer_[pos & (capacity_ - 1)]);
+    }
+    void
+    grow(size_type cap)
+    {
+        static_assert(::std::is_nothrow_move_constructible<value_type>::value,
+                "Ring buffer items must be nothrow move constructible");
+        storage_type* buffer = storage_traits::allocate(this->allocator(), cap);
+        for (size_type i = 0; i < size_; ++i) {
+            value_type* item = slot(head_ + i);
+            new (&buffer[i]) value_type(::std::move(*item));
+            item->~value_type();
+        }
+        deallocate();
+        buffer_ = buffer;
+        capacity_ = cap;
+        head_ = 0;
+    }
+    void
+    deallocate() noexcept
+    {
+        if (buffer_)
+            storage_traits::deallocate(this->allocator(), buffer_, capacity_);
+    }
+private:
+    storage_type*   buffer_;
+    size_type       capacity_;
+    size_type       head_;
+    size_type       size_;
+};
+
+template < typename T, typename Allocator >
+constexpr ::std::size_t ring_buffer<T, Allocator>::initial_capacity;
+
+/**
+ * Maps the dense indexes of an event set to dense indexes of the events
+ * of the set that are also in the Subset tuple, npos for the rest.
+ */
+template < typename EventSet, typename Subset >
+struct event_subset_index;
+
+template < ::std::size_t N >
+struct event_slot_table {
+    ::std::size_t slots[N + 1];
+    ::std::size_t size;
+};
+
+template < ::std::size_t N >
+constexpr event_slot_table<N>
+make_event_slot_table(bool const (&member)[N + 1])
+{
+    event_slot_table<N> res{ {}, 0 };
+    for (::std::size_t i = 0; i < N; ++i) {
+        res.slots[i] = member[i] ? res.size++ : static_cast<::std::size_t>(-1);
+    }
+    return res;
+}
+
+template < typename ... Events, typename Subset >
+struct event_subset_index< event_set< ::psst::meta::type_tuple<Events...> >, Subset > {
+    using size_type     = ::std::size_t;
+    using table_type    = event_slot_table< sizeof ... (Events) >;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+    static constexpr table_type table = make_event_slot_table< sizeof ... (Events) >(
+            { ::psst::meta::contains<Events, Subset>::value..., false });
+    static constexpr size_type size = table.size;
+
+    static constexpr size_type
+    get(size_type idx)
+    {
+        return idx < sizeof ... (Events) ? table.slots[idx] : npos;
+    }
+};
+
+template < typename ... Events, typename Subset >
+constexpr ::std::size_t
+    event_subset_index< event_set< ::psst::meta::type_tuple<Events...> >, Subset >::npos;
+template < typename ... Events, typename Subset >
+constexpr event_slot_table< sizeof ... (Events) >
+    event_subset_index< event_set< ::psst::meta::type_tuple<Events...> >, Subset >::table;
+template < typename ... Events, typename Subset >
+constexpr ::std::size_t
+    event_subset_index< event_set< ::psst::meta::type_tuple<Events...> >, Subset >::size;
+
+/**
+ * Deferred events stored in a FIFO bucket per event type.
+ *
+ * Each event gets a sequence number on push, so the oldest event of a set
+ * of event types can be found by looking at the bucket fronts only.
+ * Buckets are ring buffers, they keep their storage when drained.
+ *
+ * Only the event types in the Deferrable tuple get a bucket, a machine
+ * that never defers events has no buckets at all.
+ */
+template < typename Item, typename EventSet,
+        typename Deferrable = typename EventSet::events_tuple,
+        typename Allocator = ::std::allocator<Item> >
+class deferred_event_buckets {
+public:
+    using value_type        = Item;
+    using event_set         = EventSet;
+    using allocator_type    = Allocator;
+    using size_type         = ::std::size_t;
+    using sequence_type     = ::std::uint64_t;
+
+    static constexpr size_type npos = event_set::npos;
+public:
+    deferred_event_buckets() noexcept
+        : deferred_event_buckets{ allocator_type{} } {}
+    explicit
+    deferred_event_buckets(allocator_type const& alloc) noexcept
+        : buckets_{ make_buckets(alloc, bucket_indexes{}) },
+          event_ids_{}, next_sequence_{0}, size_{0} {}
+
+    /**
+     * Event types that have deferred events.
+     */
+    event_set const&
+    event_ids() const noexcept
+    { return event_ids_; }
+    bool
+    empty() const noexcept
+    { return size_ == 0; }
+    size_type
+    size() const noexcept
+    { return size_; }
+    /**
+     * Sequence number the next pushed event will get.
+     */
+    sequence_type
+    next_sequence() const noexcept
+    { return next_sequence_; }
+
+    /**
+     * Add an event to the back of its bucket.
+     * @return false if the event type doesn't belong to the event set,
+     *         such event is not stored.
+     */
+    bool
+    push(value_type&& item)
+    {
+        auto idx = item.index();
+        auto slot = slot_index::get(idx);
+        if (slot == npos)
+            return false;
+        buckets_[slot].push_back(entry{ next_sequence_++, ::std::move(item) });
+        event_ids_.set(idx);
+        ++size_;
+        return true;
+    }
+    /**
+     * Find the event type in mask with the oldest deferred event.
+     * Only events pushed before the sequence number are considered.
+     * @return Event type index or npos
+     */
+    size_type
+    oldest(event_set const& mask, sequence_type before) const
+    {
+        auto candidates = event_ids_ & mask;
+        size_type res = npos;
+        for (auto idx = candidates.next(); idx != npos; idx = candidates.next(idx + 1)) {
+            auto seq = buckets_[slot_index::get(idx)].front().sequence;
+            if (seq < before) {
+                before = seq;
+                res = idx;
+            }
+        }
+        return res;
+    }
+    /**
+     * Remove the front event of a non-empty bucket
+     */
+    value_type
+    pop(size_type idx)
+    {
+        auto& bucket = buckets_[slot_index::get(idx)];
+        value_type res{ ::std::move(bucket.front().item) };
+        bucket.pop_front();
+        if (bucket.empty())
+            event_ids_.reset(idx);
+        --size_;
+        return res;
+    }
+    /**
+     * Drop all events of event types in mask
+     * @return Number of dropped events
+     */
+    size_type
+    drop(event_set const& mask) noexcept
+    {
+        auto types = event_ids_ & mask;
+        size_type res{0};
+        for (auto idx = types.next(); idx != npos; idx = types.next(idx + 1)) {
+            auto& bucket = buckets_[slot_index::get(idx)];
+            res += bucket.size();
+            bucket.clear();
+        }
+        event_ids_ -= types;
+        size_ -= res;
+        return res;
+    }
+    void
+    clear() noexcept
+    {
+        drop(event_ids_);
+    }
+private:
+    struct entry {
+        sequence_type   sequence;
+        value_type      item;
+    };
+    using bucket_type = ring_buffer< entry, rebind_alloc< allocator_type, entry > >;
+    using slot_index = event_subset_index< event_set, Deferrable >;
+    using buckets_type = ::std::array< bucket_type, slot_index::size >;
+    using bucket_indexes = ::std::make_index_sequence< slot_index::size >;
+
+    template < ::std::size_t ... Indexes >
+    static buckets_type
+    make_buckets(allocator_type const& alloc, ::std::index_sequence< Indexes... > const&)
+    {
+        return buckets_type{{
+            (static_cast<void>(Indexes), bucket_type{ alloc })...
+        }};
+    }
+private:
+    buckets_type    buckets_;
+    event_set       event_ids_;
+    sequence_type   next_sequence_;
+    size_type       size_;
+};
+
+template < typename Item, typename EventSet, typename Deferrable, typename Allocator >
+constexpr ::std::size_t deferred_event_buckets<Item, EventSet, Deferrable, Allocator>::npos;
+
+/**
+ * Priority queue with a FIFO bucket per priority value.
+ *
+ * Buckets are created on the first push with a priority and are kept
+ * sorted by priority, a bitmap of non-empty buckets finds the highest
+ * priority bucket without looking at the others. Items of equal priority
+ * are popped in the order they were pushed. Items are never reordered,
+ * they are moved only when a bucket grows.
+ *
+ * Empty buckets are kept for reuse. When a new priority comes and there
+ * are max_empty_buckets empty buckets already, they are removed, so a
+ * queue fed many distinct priority values doesn't grow without bound.
+ */
+template < typename T, typename Priority,
+        typename Allocator = ::std::allocator<T> >
+class priority_buckets {
+public:
+    using value_type        = T;
+    using priority_type     = Priority;
+    using allocator_type    = Allocator;
+    using size_type         = ::std::size_t;
+
+    static constexpr size_type max_empty_buckets = 64;
+public:
+    priority_buckets() noexcept
+        : priority_buckets{ allocator_type{} } {}
+    explicit
+    priority_buckets(allocator_type const& alloc) noexcept
+        : buckets_{ bucket_allocator{alloc} }, non_empty_{ bitmap_allocator{alloc} },
+          last_{0}, used_{0}, size_{0} {}
+    priority_buckets(priority_buckets const&) = delete;
+    priority_buckets(priority_buckets&&) = default;
+    priority_buckets&
+    operator = (priority_buckets const&) = delete;
+    priority_buckets&
+    operator = (priority_buckets&&) = default;
+
+    void
+    swap(priority_buckets& rhs) noexcept
+    {
+        using ::std::swap;
+        swap(buckets_, rhs.buckets_);
+        swap(non_empty_, rhs.non_empty_);
+        swap(last_, rhs.last_);
+        swap(used_, rhs.used_);
+        swap(size_, rhs.size_);
+    }
+
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_type{ buckets_.get_allocator() }; }
+
+    bool
+    empty() const noexcept
+    { return size_ == 0; }
+    size_type
+    size() const noexcept
+    { return size_; }
+    /**
+     * Number of buckets, including the empty ones kept for reuse
+     */
+    size_type
+    bucket_count() const noexcept
+    { return buckets_.size(); }
+
+    /**
+     * Add an item to the back of the priority's bucket
+     */
+    void
+    push(priority_type priority, value_type&& item)
+    {
+        auto idx = bucket_index(priority);
+        auto& items = buckets_[idx].items;
+        items.push_back(::std::move(item));
+        if (items.size() == 1) {
+            non_empty_[idx / word_bits] |= bit(idx);
+            ++used_;
+        }
+        ++size_;
+    }
+    /**
+     * The oldest item of the highest priority. The queue must not be empty.
+     */
+    value_type&
+    top()
+    { return buckets_[top_index()].items.front(); }
+    value_type const&
+    top() const
+    { return buckets_[top_index()].items.front(); }
+    priority_type
+    top_priority() const
+    { return buckets_[top_index()].priority; }
+    void
+    pop()
+    {
+        auto idx = top_index();
+        auto& items = buckets_[idx].items;
+        items.pop_front();
+        if (items.empty()) {
+            non_empty_[idx / word_bits] &= ~bit(idx);
+            --used_;
+        }
+        --size_;
+    }
+    void
+    clear() noexcept
+    {
+        for (auto& b : buckets_)
+            b.items.clear();
+        for (auto& w : non_empty_)
+            w = 0;
+        used_ = 0;
+        size_ = 0;
+    }
+    /**
+     * Make sure the priority's bucket can hold at least n items without
+     * allocation.
+     */
+    void
+    reserve(priority_type priority, size_type n)
+    {
+        buckets_[bucket_index(priority)].items.reserve(n);
+    }
+private:
+    using word_type     = ::std::uint64_t;
+    static constexpr size_type word_bits = sizeof(word_type) * 8;
+
+    using items_type    = ring_buffer< value_type, allocator_type >;
+    struct bucket {
+        priority_type   priority;
+        items_type      items;
+    };
+    using bucket_allocator  = rebind_alloc< allocator_type, bucket >;
+    using bitmap_allocator  = rebind_alloc< allocator_type, word_type >;
+    using buckets_type      = ::std::vector< bucket, bucket_allocator >;
+    using bitmap_type       = ::std::vector< word_type, bitmap_allocator >;
+
+    static constexpr word_type
+    bit(size_type idx) noexcept
+    { return word_type{1} << (idx % word_bits); }
+    static size_type
+    highest_bit(word_type w) noexcept
+    {
+        size_type res = 0;
+        for (size_type shift = word_bits / 2; shift > 0; shift /= 2) {
+            if (w >> shift) {
+                w >>= shift;
+                res += shift;
+            }
+        }
+        return res;
+    }
+
+    size_type
+    bucket_index(priority_type priority)
+    {
+        if (last_ < buckets_.size() && buckets_[last_].priority == priority)
+            return last_;
+        auto pos = find_bucket(priority);
+        if (pos == buckets_.end() || pos->priority != priority) {
+            if (buckets_.size() - used_ >= max_empty_buckets) {
+                remove_empty_buckets();
+                pos = find_bucket(priority);
+            }
+            // New priority shifts the indexes of the higher buckets
+            pos = buckets_.insert(pos, bucket{ priority, items_type{ get_allocator() } });
+            rebuild_bitmap();
+        }
+        last_ = pos - buckets_.begin();
+        return last_;
+    }
+    typename buckets_type::iterator
+    find_bucket(priority_type priority)
+    {
+        return ::std::lower_bound(buckets_.begin(), buckets_.end(), priority,
+            [](bucket const& b, priority_type p){ return b.priority < p; });
+    }
+    void
+    remove_empty_buckets()
+    {
+        buckets_.erase(::std::remove_if(buckets_.begin(), buckets_.end(),
+            [](bucket const& b){ return b.items.empty(); }), buckets_.end());
+    }
+    void
+    rebuild_bitmap()
+    {
+        non_empty_.assign((buckets_.size() + word_bits - 1) / word_bits, 0);
+        for (size_type i = 0; i < buckets_.size(); ++i) {
+            if (!buckets_[i].items.empty())
+                non_empty_[i / word_bits] |= bit(i);
+        }
+    }
+    size_type
+    top_index() const noexcept
+    {
+        for (auto w = non_empty_.size(); w > 0; --w) {
+            if (non_empty_[w - 1])
+                return (w - 1) * word_bits + highest_bit(non_empty_[w - 1]);
+        }
+        return 0;
+    }
+private:
+    buckets_type    buckets_;
+    bitmap_type     non_empty_;
+    size_type       last_;
+    size_type       used_;
+    size_type       size_;
+};
+
+template < typename T, typename Priority, typename Allocator >
+constexpr ::std::size_t priority_buckets<T, Priority, Allocator>::max_empty_buckets;
+template < typename T, typename Priority, typename Allocator >
+constexpr ::std::size_t priority_buckets<T, Priority, Allocator>::word_bits;
+
+/**
+ * Deferred events of a priority state machine stored per event type, each
+ * event type has a priority queue of its events.
+ *
+ * The next event to process for a set of event types is the one with the
+ * highest priority among the queue tops, the oldest of them if the
+ * priorities are equal.
+ *
+ * As with deferred_event_buckets, only the event types in the Deferrable
+ * tuple get a queue.
+ */
+template < typename Item, typename EventSet, typename Priority,
+        typename Deferrable = typename EventSet::events_tuple,
+        typename Allocator = ::std::allocator<Item> >
+class deferred_priority_buckets {
+public:
+    using value_type        = Item;
+    using event_set         = EventSet;
+    using priority_type     = Priority;
+    using allocator_type    = Allocator;
+    using size_type         = ::std::size_t;
+    using sequence_type     = ::std::uint64_t;
+
+    static constexpr size_type npos = event_set::npos;
+public:
+    deferred_priority_buckets() noexcept
+        : deferred_priority_buckets{ allocator_type{} } {}
+    explicit
+    deferred_priority_buckets(allocator_type const& alloc) noexcept
+        : buckets_{ make_buckets(alloc, bucket_indexes{}) },
+          event_ids_{}, next_sequence_{0}, size_{0} {}
+
+    /**
+     * Event types that have deferred events.
+     */
+    event_set const&
+    event_ids() const noexcept
+    { return event_ids_; }
+    bool
+    empty() const noexcept
+    { return size_ == 0; }
+    size_type
+    size() const noexcept
+    { return size_; }
+    /**
+     * Sequence number the next pushed event will get.
+     */
+    sequence_type
+    next_sequence() const noexcept
+    { return next_sequence_; }
+
+    /**
+     * Add an event to the queue of its event type.
+     * @return false if the event type doesn't belong to the event set,
+     *         such event is not stored.
+     */
+    bool
+    push(size_type idx, priority_type priority, value_type&& item)
+    {
+        auto slot = slot_index::get(idx);
+        if (slot == npos)
+            return false;
+        buckets_[slot].push(priority, entry{ next_sequence_++, ::std::move(item) });
+        event_ids_.set(idx);
+        ++size_;
+        return true;
+    }
+    /**
+     * Find the event type in mask with the next event to process.
+     * Only the queue tops pushed before the sequence number are considered.
+     * @return Event type index or npos
+     */
+    size_type
+    top(event_set const& mask, sequence_type before) const
+    {
+        auto candidates = event_ids_ & mask;
+        size_type res = npos;
+        priority_type priority{};
+        sequence_type sequence{};
+        for (auto idx = candidates.next(); idx != npos; idx = candidates.next(idx + 1)) {
+            auto const& bucket = buckets_[slot_index::get(idx)];
+            auto seq = bucket.top().sequence;
+            if (seq >= before)
+                continue;
+            auto p = bucket.top_priority();
+            if (res == npos || priority < p || (!(p < priority) && seq < sequence)) {
+                priority = p;
+                sequence = seq;
+                res = idx;
+            }
+        }
+        return res;
+    }
+    /**
+     * Remove the top event of a non-empty event type queue
+     */
+    value_type
+    pop(size_type idx)
+    {
+        auto& bucket = buckets_[slot_index::get(idx)];
+        value_type res{ ::std::move(bucket.top().item) };
+        bucket.pop();
+        if (bucket.empty())
+            event_ids_.reset(idx);
+        --size_;
+        return res;
+    }
+    /**
+     * Drop all events of event types in mask
+     * @return Number of dropped events
+     */
+    size_type
+    drop(event_set const& mask) noexcept
+    {
+        auto types = event_ids_ & mask;
+        size_type res{0};
+        for (auto idx = types.next(); idx != npos; idx = types.next(idx + 1)) {
+            auto& bucket = buckets_[slot_index::get(idx)];
+            res += bucket.size();
+            bucket.clear();
+        }
+        event_ids_ -= types;
+        size_ -= res;
+        return res;
+    }
+    void
+    clear() noexcept
+    {
+        drop(event_ids_);
+    }
+private:
+    struct entry {
+        sequence_type   sequence;
+        value_type      item;
+    };
+    using bucket_type = priority_buckets< entry, priority_type,
+            rebind_alloc< allocator_type, entry > >;
+    using slot_index = event_subset_index< event_set, Deferrable >;
+    using buckets_type = ::std::array< bucket_type, slot_index::size >;
+    using bucket_indexes = ::std::make_index_sequence< slot_index::size >;
+
+    template < ::std::size_t ... Indexes >
+    static buckets_type
+    make_buckets(allocator_type const& alloc, ::std::index_sequence< Indexes... > const&)
+    {
+        return buckets_type{{
+            (static_cast<void>(Indexes), bucket_type{ alloc })...
+        }};
+    }
+private:
+    buckets_type    buckets_;
+    event_set       event_ids_;
+    sequence_type   next_sequence_;
+    size_type       size_;
+};
+
+template < typename Item, typename EventSet, typename Priority,
+        typename Deferrable, typename Allocator >
+constexpr ::std::size_t
+    deferred_priority_buckets<Item, EventSet, Priority, Deferrable, Allocator>::npos;
+
+template < typename T >
+struct mpsc_queue_node {
+    struct node_base {
+        ::std::atomic<node_base*> next{nullptr};
+    };
+    struct node : node_base {
+        explicit
+        node(T&& v) : node_base{}, value{::std::move(v)} {}
+        T value;
+    };
+};
+
+/**
+ * Lock-free multiple producer single consumer FIFO queue.
+ *
+ * Push is a single atomic exchange, so producers never block each other.
+ * Only one thread at a time may pop. try_pop can fail while the queue is
+ * not empty if a producer has claimed its place but hasn't yet linked the
+ * node, the item becomes available as soon as the producer finishes the
+ * push.
+ *
+ * The nodes are allocated with the Allocator by the producer threads,
+ * so it must be safe to use from several threads at once.
+ */
+template < typename T, typename Allocator = ::std::allocator<T> >
+class mpsc_queue : private allocator_base< rebind_alloc< Allocator,
+        typename mpsc_queue_node<T>::node > > {
+public:
+    using value_type        = T;
+    using allocator_type    = Allocator;
+public:
+    mpsc_queue() noexcept
+        : mpsc_queue{ allocator_type{} } {}
+    explicit
+    mpsc_queue(allocator_type const& alloc) noexcept
+        : base_type{ node_allocator{alloc} },
+          stub_{}, head_{&stub_}, tail_{&stub_} {}
+    mpsc_queue(mpsc_queue const&) = delete;
+    mpsc_queue(mpsc_queue&&) = delete;
+    ~mpsc_queue()
+    {
+        clear();
+    }
+
+    mpsc_queue&
+    operator = (mpsc_queue const&) = delete;
+    mpsc_queue&
+    operator = (mpsc_queue&&) = delete;
+
+    /**
+     * Safe to call from any number of threads.
+     */
+    void
+    push(value_type&& value)
+    {
+        node* n = node_traits::allocate(this->allocator(), 1);
+        new (n) node{ ::std::move(value) };
+        push_node(n);
+    }
+
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_type{ this->allocator() }; }
+    /**
+     * Consumer side. Moves the oldest item to value.
+     * @return false if no item is available.
+     */
+    bool
+    try_pop(value_type& value)
+    {
+        node_base* tail = tail_;
+        node_base* next = tail->next.load(::std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next)
+                return false;
+            tail_ = tail = next;
+            next = next->next.load(::std::memory_order_acquire);
+        }
+        if (!next) {
+            if (tail != head_.load(::std::memory_order_acquire))
+                return false;
+            push_node(&stub_);
+            next = tail->next.load(::std::memory_order_acquire);
+            if (!next)
+                return false;
+        }
+        tail_ = next;
+        node* item = static_cast<node*>(tail);
+        value = ::std::move(item->value);
+        destroy_node(item);
+        return true;
+    }
+    /**
+     * Consumer side. Drop all items that can be popped.
+     */
+    void
+    clear() noexcept
+    {
+        node_base* tail = tail_;
+        while (tail) {
+            node_base* next = tail->next.load(::std::memory_order_acquire);
+            if (tail != &stub_)
+                destroy_node(static_cast<node*>(tail));
+            tail = next;
+        }
+        stub_.next.store(nullptr, ::std::memory_order_relaxed);
+        head_.store(&stub_, ::std::memory_order_release);
+        tail_ = &stub_;
+    }
+private:
+    using node_base         = typename mpsc_queue_node<T>::node_base;
+    using node              = typename mpsc_queue_node<T>::node;
+    using node_allocator    = rebind_alloc< allocator_type, node >;
+    using base_type         = allocator_base< node_allocator >;
+    using node_traits       = typename base_type::allocator_traits;
+
+    void
+    destroy_node(node* n) noexcept
+    {
+        n->~node();
+        node_traits::deallocate(this->allocator(), n, 1);
+    }
+    void
+    push_node(node_base* n) noexcept
+    {
+        n->next.store(nullptr, ::std::memory_order_relaxed);
+        node_base* prev = head_.exchange(n, ::std::memory_order_acq_rel);
+        prev->next.store(n, ::std::memory_order_release);
+    }
+private:
+    node_base                   stub_;
+    ::std::atomic<node_base*>   head_;
+    node_base*                  tail_;
+};
+
+template < typename T >
+struct bounded_mpsc_queue_cell {
+    using storage_type = typename ::std::aligned_storage<
+            sizeof(T), alignof(T)>::type;
+    struct type {
+        ::std::atomic<::std::size_t>    sequence{0};
+        storage_type                    storage{};
+    };
+};
+
+/**
+ * Lock-free bounded multiple producer single consumer FIFO queue.
+ *
+ * The storage for Capacity items is allocated on construction and never
+ * grows. Capacity must be a power of two, slots are found by masking
+ * the position. Producers claim a slot
+ * with a compare and swap on the enqueue position, each slot has a
+ * sequence number telling if it is free or holds an item.
+ */
+template < typename T, ::std::size_t Capacity,
+        typename Allocator = ::std::allocator<T> >
+class bounded_mpsc_queue : private allocator_base< rebind_alloc< Allocator,
+        typename bounded_mpsc_queue_cell<T>::type > > {
+public:
+    using value_type        = T;
+    using allocator_type    = Allocator;
+    using size_type         = ::std::size_t;
+
+    static constexpr size_type capacity = Capacity;
+    static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0,
+            "Bounded queue capacity must be a power of two");
+public:
+    bounded_mpsc_queue()
+        : bounded_mpsc_queue{ allocator_type{} } {}
+    explicit
+    bounded_mpsc_queue(allocator_type const& alloc)
+        : base_type{ cell_allocator{alloc} },
+          cells_{ cell_traits::allocate(this->allocator(), capacity) },
+          enqueue_pos_{0}, dequeue_pos_{0}
+    {
+        for (size_type i = 0; i < capacity; ++i) {
+            new (&cells_[i]) cell{};
+            cells_[i].sequence.store(i, ::std::memory_order_relaxed);
+        }
+    }
+    bounded_mpsc_queue(bounded_mpsc_queue const&) = delete;
+    bounded_mpsc_queue(bounded_mpsc_queue&&) = delete;
+    ~bounded_mpsc_queue()
+    {
+        clear();
+        for (size_type i = 0; i < capacity; ++i)
+            cells_[i].~cell();
+        cell_traits::deallocate(this->allocator(), cells_, capacity);
+    }
+
+    allocator_type
+    get_allocator() const noexcept
+    { return allocator_type{ this->allocator() }; }
+
+    bounded_mpsc_queue&
+    operator = (bounded_mpsc_queue const&) = delete;
+    bounded_mpsc_queue&
+    operator = (bounded_mpsc_queue&&) = delete;
+
+    /**
+     * Safe to call from any number of threads. The value is moved from
+     * only if the push succeeds.
+     * @return false if the queue is full.
+     */
+    bool
+    try_push(value_type& value)
+    {
+        size_type pos = enqueue_pos_.load(::std::memory_order_relaxed);
+        cell* c;
+        while (true) {
+            c = &cells_[pos & (capacity - 1)];
+            auto seq = c->sequence.load(::std::memory_order_acquire);
+            auto diff = static_cast<::std::ptrdiff_t>(seq) - static_cast<::std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                        ::std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(::std::memory_order_relaxed);
+            }
+        }
+        new (&c->storage) value_type(::std::move(value));
+        c->sequence.store(pos + 1, ::std::memory_order_release);
+        return true;
+    }
+    /**
+     * Consumer side. Moves the oldest item to value.
+     * @return false if no item is available.
+     */
+    bool
+    try_pop(value_type& value)
+    {
+        cell& c = cells_[dequeue_pos_ & (capacity - 1)];
+        if (c.sequence.load(::std::memory_order_acquire) != dequeue_pos_ + 1)
+            return false;
+        value_type* item = reinterpret_cast<value_type*>(&c.storage);
+        value = ::std::move(*item);
+        item->~value_type();
+        c.sequence.store(dequeue_pos_ + capacity, ::std::memory_order_release);
+        ++dequeue_pos_;
+        return true;
+    }
+    /**
+     * Consumer side. Drop all items that can be popped.
+     */
+    void
+    clear()
+    {
+        value_type tmp;
+        while (try_pop(tmp));
+    }
+private:
+    using cell              = typename bounded_mpsc_queue_cell<T>::type;
+    using cell_allocator    = rebind_alloc< allocator_type, cell >;
+    using base_type         = allocator_base< cell_allocator >;
+    using cell_traits       = typename base_type::allocator_traits;
+private:
+    cell*                       cells_;
+    ::std::atomic<size_type>    enqueue_pos_;
+    size_type                   dequeue_pos_;
+};
+
+template < typename T, ::std::size_t Capacity, typename Allocator >
+constexpr ::std::size_t bounded_mpsc_queue<T, Capacity, Allocator>::capacity;
+
+}  /* namespace detail */
+}  /* namespace afsm */
+
+#endif /* AFSM_DETAIL_EVENT_QUEUE_HPP_ */
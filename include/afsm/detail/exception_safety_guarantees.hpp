@@ -29,6 +29,11 @@ struct basic_exception_safety {};
  *
  * Requires non-throwing swap operations
  * The exception will be thrown.
+ *
+ * Source and target states are backed up after the guard check passes.
+ * A state can provide snapshot() and restore(snapshot) member functions
+ * instead of being copied. If exit, transition action, enter and state
+ * reset are all noexcept, no backup is made.
  */
 struct strong_exception_safety {};
 /**
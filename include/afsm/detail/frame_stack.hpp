@@ -0,0 +1,270 @@
+/*
+ * frame_stack.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_DETAIL_FRAME_STACK_HPP_
+#define AFSM_DETAIL_FRAME_STACK_HPP_
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace afsm {
+namespace detail {
+
+/**
+ * Common part of the pushdown frame stacks. Frames are the state tables
+ * of a pushdown machine, the bottom frame is always active. The pop
+ * happens while the popped frame is still in the middle of a transition,
+ * so the frame cannot be touched there. The owner calls reset_popped
+ * when the transition completes, the popped frames are reset in place
+ * to the initial state and wait for the next push.
+ */
+template < typename Frame, typename Storage >
+class frame_stack_base {
+public:
+    using frame_type    = Frame;
+    using storage_type  = Storage;
+public:
+    frame_type&
+    top()
+    { return frames_[depth_ - 1]; }
+    frame_type const&
+    top() const
+    { return frames_[depth_ - 1]; }
+
+    /**
+     * The machine owning the stack
+     */
+    typename frame_type::fsm_type&
+    fsm() const
+    { return frames_.front().fsm(); }
+
+    ::std::size_t
+    size() const
+    { return depth_; }
+
+    /**
+     * Pops the top frame. The bottom frame is never popped.
+     */
+    void
+    pop()
+    {
+        if (depth_ > 1)
+            --depth_;
+    }
+    /**
+     * Reset the frames popped since the last call.
+     */
+    void
+    reset_popped()
+    {
+        while (used_ > depth_) {
+            frames_[used_ - 1].reset();
+            --used_;
+        }
+    }
+
+    /**
+     * All the frames including the pooled ones
+     */
+    typename storage_type::iterator
+    begin()
+    { return frames_.begin(); }
+    typename storage_type::iterator
+    end()
+    { return frames_.end(); }
+protected:
+    frame_stack_base(storage_type&& frames, ::std::size_t depth, ::std::size_t used)
+        : frames_{ ::std::move(frames) }, depth_{depth}, used_{used} {}
+
+    /**
+     * Make the next constructed frame the top one, reset it if it was
+     * popped in the same transition.
+     */
+    frame_type&
+    activate()
+    {
+        auto& frame = frames_[depth_];
+        if (depth_ < used_) {
+            frame.reset();
+        } else {
+            used_ = depth_ + 1;
+        }
+        ++depth_;
+        return frame;
+    }
+    void
+    swap_base(frame_stack_base& rhs) noexcept
+    {
+        using ::std::swap;
+        swap(depth_, rhs.depth_);
+        swap(used_, rhs.used_);
+    }
+
+    storage_type    frames_;
+    /** Number of the active frames */
+    ::std::size_t   depth_;
+    /** Number of the active frames and the popped ones not reset yet */
+    ::std::size_t   used_;
+};
+
+/**
+ * Frame stack with inline storage for MaxDepth frames. All frames are
+ * constructed with the stack, a push beyond MaxDepth throws
+ * std::length_error. The allocator is not used.
+ */
+template < typename FSM, typename Frame, ::std::size_t MaxDepth,
+        typename Allocator = ::std::allocator<Frame> >
+class frame_stack
+    : public frame_stack_base< Frame, ::std::array< Frame, MaxDepth > > {
+public:
+    using base_type         = frame_stack_base< Frame, ::std::array< Frame, MaxDepth > >;
+    using frame_type        = Frame;
+    using storage_type      = typename base_type::storage_type;
+    using allocator_type    = Allocator;
+    using indexes_type      = ::std::make_index_sequence< MaxDepth >;
+    static constexpr ::std::size_t max_depth = MaxDepth;
+public:
+    explicit
+    frame_stack(FSM& fsm, allocator_type const& = allocator_type{})
+        : base_type{ construct(fsm, indexes_type{}), 1, 1 } {}
+    frame_stack(FSM& fsm, frame_stack const& rhs)
+        : base_type{ copy_construct(fsm, rhs.frames_, indexes_type{}),
+            rhs.depth_, rhs.used_ } {}
+    frame_stack(FSM& fsm, frame_stack&& rhs)
+        : base_type{ move_construct(fsm, ::std::move(rhs.frames_), indexes_type{}),
+            rhs.depth_, rhs.used_ } {}
+
+    frame_type&
+    push()
+    {
+        if (this->depth_ == max_depth)
+            throw ::std::length_error{ "Pushdown stack depth exceeded" };
+        return this->activate();
+    }
+
+    void
+    swap(frame_stack& rhs)
+    {
+        for (::std::size_t i = 0; i < max_depth; ++i) {
+            this->frames_[i].swap(rhs.frames_[i]);
+        }
+        this->swap_base(rhs);
+    }
+private:
+    template < ::std::size_t ... Indexes >
+    static storage_type
+    construct(FSM& fsm, ::std::index_sequence< Indexes... > const&)
+    {
+        return storage_type{{ (static_cast<void>(Indexes), frame_type{fsm})... }};
+    }
+    template < ::std::size_t ... Indexes >
+    static storage_type
+    copy_construct(FSM& fsm, storage_type const& rhs,
+            ::std::index_sequence< Indexes... > const&)
+    {
+        return storage_type{{ frame_type{ fsm, rhs[Indexes] }... }};
+    }
+    template < ::std::size_t ... Indexes >
+    static storage_type
+    move_construct(FSM& fsm, storage_type&& rhs,
+            ::std::index_sequence< Indexes... > const&)
+    {
+        return storage_type{{ frame_type{ fsm, ::std::move(rhs[Indexes]) }... }};
+    }
+};
+
+/**
+ * Frame stack without a depth limit. The frames are kept in a deque
+ * that grows to the deepest push seen, so a push allocates only when
+ * the stack is deeper than ever before.
+ */
+template < typename FSM, typename Frame, typename Allocator >
+class frame_stack< FSM, Frame, 0, Allocator >
+    : public frame_stack_base< Frame, ::std::deque< Frame,
+            typename ::std::allocator_traits<Allocator>::template rebind_alloc<Frame> > > {
+public:
+    using allocator_type    = typename ::std::allocator_traits<Allocator>
+                                    ::template rebind_alloc<Frame>;
+    using base_type         = frame_stack_base< Frame, ::std::deque< Frame, allocator_type > >;
+    using frame_type        = Frame;
+    using storage_type      = typename base_type::storage_type;
+    static constexpr ::std::size_t max_depth = 0;
+public:
+    explicit
+    frame_stack(FSM& fsm, allocator_type const& alloc = allocator_type{})
+        : base_type{ construct(fsm, alloc), 1, 1 } {}
+    frame_stack(FSM& fsm, frame_stack const& rhs)
+        : base_type{ copy_construct(fsm, rhs.frames_), rhs.depth_, rhs.used_ } {}
+    frame_stack(FSM& fsm, frame_stack&& rhs)
+        : base_type{ move_construct(fsm, ::std::move(rhs.frames_)),
+            rhs.depth_, rhs.used_ } {}
+
+    allocator_type
+    get_allocator() const noexcept
+    { return this->frames_.get_allocator(); }
+
+    frame_type&
+    push()
+    {
+        if (this->depth_ == this->frames_.size()) {
+            // Frames don't move when the deque grows
+            this->frames_.emplace_back( this->fsm() );
+        }
+        return this->activate();
+    }
+
+    void
+    swap(frame_stack& rhs)
+    {
+        using ::std::swap;
+        swap(this->frames_, rhs.frames_);
+        this->swap_base(rhs);
+    }
+private:
+    using allocator_traits = ::std::allocator_traits<allocator_type>;
+
+    static storage_type
+    construct(FSM& fsm, allocator_type const& alloc)
+    {
+        storage_type res{ alloc };
+        res.emplace_back(fsm);
+        return res;
+    }
+    static storage_type
+    copy_construct(FSM& fsm, storage_type const& rhs)
+    {
+        storage_type res{ allocator_traits::select_on_container_copy_construction(
+                rhs.get_allocator()) };
+        for (auto const& item : rhs) {
+            res.emplace_back(fsm, item);
+        }
+        return res;
+    }
+    static storage_type
+    move_construct(FSM& fsm, storage_type&& rhs)
+    {
+        storage_type res{ rhs.get_allocator() };
+        for (auto& item : rhs) {
+            res.emplace_back(fsm, ::std::move(item));
+        }
+        return res;
+    }
+};
+
+template < typename FSM, typename Frame, ::std::size_t MaxDepth, typename Allocator >
+constexpr ::std::size_t frame_stack< FSM, Frame, MaxDepth, Allocator >::max_depth;
+
+template < typename FSM, typename Frame, typename Allocator >
+constexpr ::std::size_t frame_stack< FSM, Frame, 0, Allocator >::max_depth;
+
+}  /* namespace detail */
+}  /* namespace afsm */
+
+#endif /* AFSM_DETAIL_FRAME_STACK_HPP_ */
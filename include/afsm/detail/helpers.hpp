@@ -9,11 +9,14 @@
 #define AFSM_DETAIL_HELPERS_HPP_
 
 #include <afsm/definition.hpp>
+#include <afsm/detail/event_identity.hpp>
 #include <type_traits>
 #include <mutex>
 #include <atomic>
+#include <cstdint>
 #include <deque>
 #include <algorithm>
+#include <memory>
 
 namespace afsm {
 namespace detail {
@@ -119,48 +122,180 @@ template < typename FSM, typename State >
 struct substate_type
     : substate_type_impl<FSM, State, def::contains_substate<FSM, State>::value>{};
 
-template < typename FSM, typename StateTable >
-struct stack_constructor {
-    using state_table_type  = StateTable;
-    using stack_item        = state_table_type;
-    using type              = ::std::deque<stack_item>;
-    static constexpr ::std::size_t size = state_table_type::size;
+/**
+ * Definition of the outermost state machine that contains the FSM.
+ * If the FSM is not a machine front type, Default is used.
+ */
+template < typename FSM, typename Default >
+struct root_machine_definition {
+    using type = Default;
+};
 
-    static type
-    construct(FSM& fsm)
-    {
-        type res;
-        res.emplace_back(state_table_type{fsm});
-        return res;
-    }
-    static type
-    copy_construct(FSM& fsm, type const& rhs)
+template < typename T, typename Mutex, typename Observer,
+        template<typename> class ObserverWrapper, typename Default >
+struct root_machine_definition<
+        state_machine<T, Mutex, Observer, ObserverWrapper>, Default > {
+    using type = T;
+};
+
+template < typename T, typename Mutex, typename Observer,
+        template<typename> class ObserverWrapper, typename Default >
+struct root_machine_definition<
+        priority_state_machine<T, Mutex, Observer, ObserverWrapper>, Default > {
+    using type = T;
+};
+
+template < typename T, typename FSM, typename Default >
+struct root_machine_definition< inner_state_machine<T, FSM>, Default >
+    : root_machine_definition<FSM, T> {};
+
+/**
+ * Whether events can be posted to the outermost state machine that
+ * contains the FSM from several threads at once. The machine needs a
+ * mutex, state_machine can use the lock-free event queue instead.
+ */
+template < typename FSM >
+struct concurrent_event_posting : ::std::false_type {};
+
+template < typename T, typename Mutex, typename Observer,
+        template<typename> class ObserverWrapper >
+struct concurrent_event_posting< state_machine<T, Mutex, Observer, ObserverWrapper> >
+    : ::std::integral_constant<bool,
+        !::std::is_same<Mutex, none>::value ||
+        ::std::is_same< typename def::traits::event_queue_policy<T>::type,
+            def::tags::lock_free_event_queue >::value > {};
+
+template < typename T, typename Mutex, typename Observer,
+        template<typename> class ObserverWrapper >
+struct concurrent_event_posting< priority_state_machine<T, Mutex, Observer, ObserverWrapper> >
+    : ::std::integral_constant<bool, !::std::is_same<Mutex, none>::value> {};
+
+template < typename T, typename FSM >
+struct concurrent_event_posting< inner_state_machine<T, FSM> >
+    : concurrent_event_posting<FSM> {};
+
+/**
+ * Event set type shared by all states of a state machine hierarchy.
+ * Event indexes are assigned over all events handled by the root machine.
+ */
+template < typename FSM, typename Default >
+struct machine_event_set {
+    using root_definition   = typename root_machine_definition<FSM, Default>::type;
+    using type              = event_set<
+            typename def::detail::recursive_handled_events<root_definition>::type >;
+};
+
+/**
+ * Keeps an allocator as a base of the container, so that an allocator
+ * without state takes no space.
+ */
+template < typename Allocator >
+class allocator_base : private Allocator {
+public:
+    using allocator_traits = ::std::allocator_traits<Allocator>;
+protected:
+    explicit
+    allocator_base(Allocator const& alloc) noexcept
+        : Allocator(alloc) {}
+
+    Allocator&
+    allocator() noexcept
+    { return *this; }
+    Allocator const&
+    allocator() const noexcept
+    { return *this; }
+
+    /**
+     * Swap the allocators if they propagate on swap, otherwise they
+     * are expected to be equal as with the standard containers.
+     */
+    void
+    swap_allocator(allocator_base& rhs) noexcept
     {
-        type res;
-        ::std::transform(rhs.begin(), rhs.end(), ::std::back_inserter(res),
-            [fsm](stack_item const& item)
-            {
-                return stack_item{ fsm, item };
-            });
-        return res;
+        swap_allocator(rhs, typename allocator_traits::propagate_on_container_swap{});
     }
-    static type
-    move_construct(FSM& fsm, type&& rhs)
+private:
+    void
+    swap_allocator(allocator_base& rhs, ::std::true_type const&) noexcept
     {
-        type res;
-        ::std::transform(rhs.begin(), rhs.end(), ::std::back_inserter(res),
-            [fsm](stack_item&& item)
-            {
-                return stack_item{fsm, ::std::move(item) };
-            });
-        return res;
+        using ::std::swap;
+        swap(allocator(), rhs.allocator());
     }
+    void
+    swap_allocator(allocator_base&, ::std::false_type const&) noexcept
+    {}
 };
 
+template < typename Allocator, typename T >
+using rebind_alloc = typename ::std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+/**
+ * Allocator of the outermost state machine containing the FSM
+ */
+template < typename FSM, typename Default >
+using machine_allocator_type = typename def::traits::allocator_type<
+        typename root_machine_definition< FSM, Default >::type >::type;
+
+template < typename Allocator, typename FSM >
+auto
+enclosing_allocator(FSM const& fsm, int)
+    -> decltype(Allocator{ fsm.get_allocator() })
+{
+    return Allocator{ fsm.get_allocator() };
+}
+
+template < typename Allocator, typename FSM >
+Allocator
+enclosing_allocator(FSM const&, long)
+{
+    return Allocator{};
+}
+
+/**
+ * Allocator of the enclosing state machine, a default constructed one
+ * if the machine doesn't provide it.
+ */
+template < typename Allocator, typename FSM >
+Allocator
+enclosing_allocator(FSM const& fsm)
+{
+    return enclosing_allocator<Allocator>(fsm, 0);
+}
+
+/**
+ * Constructor arguments starting with std::allocator_arg
+ */
+template < typename ... Args >
+struct starts_with_allocator_arg : ::std::false_type {};
+
+template < typename T, typename ... Args >
+struct starts_with_allocator_arg< T, Args... >
+    : ::std::is_same< typename ::std::decay<T>::type, ::std::allocator_arg_t > {};
+
 struct no_lock {
     no_lock(none&) {}
 };
 
+/**
+ * Clears an atomic flag when leaving the scope, so that an exception
+ * doesn't leave the flag set.
+ */
+class flag_guard {
+public:
+    explicit
+    flag_guard(::std::atomic_flag& flag) noexcept
+        : flag_{flag} {}
+    flag_guard(flag_guard const&) = delete;
+    flag_guard&
+    operator = (flag_guard const&) = delete;
+    ~flag_guard()
+    {
+        flag_.clear();
+    }
+private:
+    ::std::atomic_flag& flag_;
+};
+
 template < typename Mutex >
 struct lock_guard_type {
     using type = ::std::lock_guard<Mutex>;
@@ -189,6 +324,38 @@ struct size_type<none&> {
     using type = ::std::size_t;
 };
 
+/**
+ * Smallest unsigned type holding an index of N states
+ */
+template < ::std::size_t N >
+struct state_index_value {
+    using type = typename ::std::conditional<
+            (N <= 0xff), ::std::uint8_t,
+            typename ::std::conditional<
+                (N <= 0xffff), ::std::uint16_t,
+                typename ::std::conditional<
+                    (N <= 0xffffffff), ::std::uint32_t,
+                    ::std::size_t
+                >::type
+            >::type
+        >::type;
+};
+
+/**
+ * Type of the current state index of a machine with N states. Size is
+ * the type selected by size_type for the machine's mutex, the index is
+ * atomic if Size is.
+ */
+template < typename Size, ::std::size_t N >
+struct state_index_type {
+    using type = typename state_index_value<N>::type;
+};
+
+template < ::std::size_t N >
+struct state_index_type< ::std::atomic<::std::size_t>, N > {
+    using type = ::std::atomic< typename state_index_value<N>::type >;
+};
+
 }  /* namespace detail */
 }  /* namespace afsm */
 
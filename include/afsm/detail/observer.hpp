@@ -11,6 +11,7 @@
 #include <afsm/fsm_fwd.hpp>
 #include <afsm/detail/actions.hpp>
 #include <afsm/detail/transitions.hpp>
+#include <exception>
 #include <memory>
 
 namespace afsm {
@@ -71,9 +72,17 @@ struct null_observer {
     void
     drop_deferred_event(FSM const&) const noexcept{}
 
+    template < typename FSM >
+    void
+    drop_queued_event(FSM const&) const noexcept{}
+
     template < typename FSM, typename Event >
     void
     reject_event(FSM const&, Event const&) const noexcept {}
+
+    template < typename FSM, typename State >
+    void
+    activity_error(FSM const&, State const&, ::std::exception_ptr const&) const noexcept {}
 };
 
 template < typename T >
@@ -98,6 +107,8 @@ public:
 protected:
     template < typename FSM, typename FSM_DEF, typename Size >
     friend class transitions::state_transition_table;
+    template < typename Activity >
+    friend class activity_runner;
 
     template < typename FSM, typename Event >
     void
@@ -214,6 +225,13 @@ protected:
         if (observer_)
             observer_->drop_deferred_event(fsm);
     }
+    template < typename FSM >
+    void
+    drop_queued_event(FSM const& fsm) const noexcept
+    {
+        if (observer_)
+            observer_->drop_queued_event(fsm);
+    }
 
     template < typename FSM, typename Event >
     void
@@ -222,6 +240,15 @@ protected:
         if (observer_)
             observer_->reject_event(fsm, event);
     }
+
+    template < typename FSM, typename State >
+    void
+    activity_error(FSM const& fsm, State const& state,
+            ::std::exception_ptr const& error) const noexcept
+    {
+        if (observer_)
+            observer_->activity_error(fsm, state, error);
+    }
 private:
     observer_ptr    observer_;
 };
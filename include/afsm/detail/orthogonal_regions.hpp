@@ -10,18 +10,91 @@
 
 #include <afsm/detail/actions.hpp>
 #include <afsm/detail/transitions.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <utility>
 
 namespace afsm {
 namespace orthogonal {
 
 namespace detail {
 
+/**
+ * Region can either process or defer the event. The same check is done by
+ * the region's own process_event, evaluating it in the dispatcher skips the
+ * calls to regions that would refuse the event anyway.
+ */
+template < typename Region, typename Event >
+struct region_accepts_event : ::std::integral_constant<bool,
+        ::psst::meta::contains<
+            typename ::std::decay<Event>::type, typename Region::handled_events >::value ||
+        ::psst::meta::contains<
+            typename ::std::decay<Event>::type, typename Region::deferred_events >::value > {};
+
+template < ::std::size_t N, typename Regions, typename Event >
+using nth_region_accepts_event = region_accepts_event<
+        typename ::std::tuple_element<N, Regions>::type, Event >;
+
+template < ::std::size_t N, typename Regions, typename FSM, typename Event >
+actions::event_process_result
+process_region(Regions& regions, FSM& fsm, Event&& event, ::std::true_type const&)
+{
+    return actions::detail::process_event_handler<N>{}(regions, fsm, ::std::forward<Event>(event));
+}
+
+template < ::std::size_t N, typename Regions, typename FSM, typename Event >
+constexpr actions::event_process_result
+process_region(Regions&, FSM&, Event&&, ::std::false_type const&)
+{
+    return actions::event_process_result::refuse;
+}
+
+constexpr ::std::size_t
+count_accepting()
+{ return 0; }
+
+template < typename ... T >
+constexpr ::std::size_t
+count_accepting(bool accepts, T ... rest)
+{ return (accepts ? 1 : 0) + count_accepting(rest...); }
+
+constexpr ::std::size_t
+first_accepting(::std::size_t index)
+{ return index; }
+
+template < typename ... T >
+constexpr ::std::size_t
+first_accepting(::std::size_t index, bool accepts, T ... rest)
+{ return accepts ? index : first_accepting(index + 1, rest...); }
+
+/**
+ * Number of regions accepting the event and the index of the first one
+ */
+template < typename Regions, typename Event, typename Indexes >
+struct accepting_regions;
+
+template < typename Regions, typename Event, ::std::size_t ... Indexes >
+struct accepting_regions< Regions, Event, ::std::index_sequence<Indexes...> > {
+    static constexpr ::std::size_t count = count_accepting(
+            nth_region_accepts_event<Indexes, Regions, Event>::value...);
+    static constexpr ::std::size_t first = first_accepting(0,
+            nth_region_accepts_event<Indexes, Regions, Event>::value...);
+};
+
+template < typename Regions, typename Event, ::std::size_t ... Indexes >
+constexpr ::std::size_t
+accepting_regions< Regions, Event, ::std::index_sequence<Indexes...> >::count;
+template < typename Regions, typename Event, ::std::size_t ... Indexes >
+constexpr ::std::size_t
+accepting_regions< Regions, Event, ::std::index_sequence<Indexes...> >::first;
+
 template < ::std::size_t N >
 struct invoke_nth {
     using previous = invoke_nth<N - 1>;
     static constexpr ::std::size_t index = N;
-    using event_handler_type = actions::detail::process_event_handler<index>;
-    using event_set          = ::afsm::detail::event_set;
 
     template < typename Regions, typename Event, typename FSM >
     static void
@@ -46,39 +119,36 @@ struct invoke_nth {
         previous::exit(regions, ::std::forward<Event>(event), fsm);
     }
 
-    template < typename Regions, typename Event >
+    template < typename Regions, typename FSM, typename Event >
     static actions::event_process_result
-    process_event(Regions& regions, Event&& event)
+    process_event(Regions& regions, FSM& fsm, Event&& event)
     {
-        auto res = previous::process_event(regions, ::std::forward<Event>(event));
-        return ::std::max(res, event_handler_type{}(regions, ::std::forward<Event>(event)));
+        auto res = previous::process_event(regions, fsm, ::std::forward<Event>(event));
+        return ::std::max(res, process_region<index>(regions, fsm, ::std::forward<Event>(event),
+                nth_region_accepts_event<index, Regions, Event>{}));
     }
 
-    template < typename Regions >
+    template < typename Regions, typename EventSet >
     static void
-    collect_events( Regions const& regions, event_set& events )
+    collect_events( Regions const& regions, EventSet& events )
     {
         previous::collect_events(regions, events);
         auto const& region = ::std::get<index>(regions);
-        event_set evts = region.current_handled_events();
-        events.insert(evts.begin(), evts.end());
+        events |= region.current_handled_events();
     }
-    template < typename Regions >
+    template < typename Regions, typename EventSet >
     static void
-    collect_deferred_events( Regions const& regions, event_set& events )
+    collect_deferred_events( Regions const& regions, EventSet& events )
     {
         previous::collect_deferred_events(regions, events);
         auto const& region = ::std::get<index>(regions);
-        event_set evts = region.current_deferrable_events();
-        events.insert(evts.begin(), evts.end());
+        events |= region.current_deferrable_events();
     }
 };
 
 template <>
 struct invoke_nth< 0 > {
     static constexpr ::std::size_t index = 0;
-    using event_handler_type = actions::detail::process_event_handler<index>;
-    using event_set          = ::afsm::detail::event_set;
 
     template < typename Regions, typename Event, typename FSM >
     static void
@@ -98,29 +168,73 @@ struct invoke_nth< 0 > {
         state_exit{}(::std::get<index>(regions), ::std::forward<Event>(event), fsm);
     }
 
-    template < typename Regions, typename Event >
+    template < typename Regions, typename FSM, typename Event >
     static actions::event_process_result
-    process_event(Regions& regions, Event&& event)
+    process_event(Regions& regions, FSM& fsm, Event&& event)
     {
-        return event_handler_type{}(regions, ::std::forward<Event>(event));
+        return process_region<index>(regions, fsm, ::std::forward<Event>(event),
+                nth_region_accepts_event<index, Regions, Event>{});
     }
 
-    template < typename Regions >
+    template < typename Regions, typename EventSet >
     static void
-    collect_events( Regions const& regions, event_set& events )
+    collect_events( Regions const& regions, EventSet& events )
     {
         auto const& region = ::std::get<index>(regions);
-        region.current_handled_events().swap(events);
+        events = region.current_handled_events();
     }
-    template < typename Regions >
+    template < typename Regions, typename EventSet >
     static void
-    collect_deferred_events( Regions const& regions, event_set& events )
+    collect_deferred_events( Regions const& regions, EventSet& events )
     {
         auto const& region = ::std::get<index>(regions);
-        region.current_deferrable_events().swap(events);
+        events = region.current_deferrable_events();
     }
 };
 
+/**
+ * Counts regions processing an event in parallel
+ */
+class region_join {
+public:
+    region_join() noexcept
+        : remaining_{0} {}
+    region_join(region_join const&) = delete;
+    region_join&
+    operator = (region_join const&) = delete;
+
+    /**
+     * Post a task to the executor, the task must call done when it
+     * finishes. A task the executor fails to accept is not waited for.
+     */
+    template < typename Executor, typename Task >
+    void
+    post(Executor& executor, Task&& task)
+    {
+        remaining_.fetch_add(1, ::std::memory_order_relaxed);
+        try {
+            executor.post(::std::forward<Task>(task));
+        } catch (...) {
+            remaining_.fetch_sub(1, ::std::memory_order_relaxed);
+            throw;
+        }
+    }
+
+    void
+    done() noexcept
+    {
+        remaining_.fetch_sub(1, ::std::memory_order_release);
+    }
+    void
+    wait() const noexcept
+    {
+        while (remaining_.load(::std::memory_order_acquire) > 0)
+            ::std::this_thread::yield();
+    }
+private:
+    ::std::atomic< ::std::size_t > remaining_;
+};
+
 }  /* namespace detail */
 
 template < typename FSM, typename FSM_DEF, typename Size >
@@ -144,7 +258,20 @@ public:
 
     using region_indexes                = typename ::psst::meta::index_builder<size>::type;
     using all_regions                   = detail::invoke_nth<size - 1>;
-    using event_set                     = ::afsm::detail::event_set;
+    using event_set                     =
+            typename ::afsm::detail::machine_event_set<fsm_type, state_machine_definition_type>::type;
+    using parallel_dispatch             = def::traits::has_parallel_regions<state_machine_definition_type>;
+
+    template < typename Event >
+    using accepting_regions             =
+            detail::accepting_regions< regions_tuple, Event, ::std::make_index_sequence<size> >;
+    /**
+     * Regions are processed in parallel only if more than one of them
+     * accepts the event.
+     */
+    template < typename Event >
+    using parallel_dispatch_for         = ::std::integral_constant<bool,
+            parallel_dispatch::value && (accepting_regions<Event>::count > 1) >;
 public:
     regions_table(fsm_type& fsm)
         : fsm_{&fsm},
@@ -186,6 +313,20 @@ public:
         ::afsm::detail::set_enclosing_fsm<size - 1>::set(fsm, regions_);
     }
 
+    fsm_type&
+    fsm() const
+    { return *fsm_; }
+
+    /**
+     * Return the regions to the initial state, the regions are reset in
+     * place.
+     */
+    void
+    reset()
+    {
+        reset_regions(::std::make_index_sequence<size>{});
+    }
+
     regions_tuple&
     regions()
     { return regions_; }
@@ -206,8 +347,8 @@ public:
     actions::event_process_result
     process_event(Event&& event)
     {
-        // Pass event to all regions
-        return all_regions::process_event(regions_, ::std::forward<Event>(event));
+        // Pass event to the regions that can handle it
+        return process_event(::std::forward<Event>(event), parallel_dispatch_for<Event>{});
     }
     event_set
     current_handled_events() const
@@ -238,6 +379,78 @@ public:
         // Call exit for all regions
         all_regions::exit(regions_, ::std::forward<Event>(event), *fsm_);
     }
+private:
+    template < typename Event >
+    actions::event_process_result
+    process_event(Event&& event, ::std::false_type const&)
+    {
+        return all_regions::process_event(regions_, *fsm_, ::std::forward<Event>(event));
+    }
+    template < typename Event >
+    actions::event_process_result
+    process_event(Event&& event, ::std::true_type const&)
+    {
+        return process_parallel(::std::forward<Event>(event),
+                ::std::make_index_sequence<size>{});
+    }
+
+    template < typename Event, ::std::size_t ... Indexes >
+    actions::event_process_result
+    process_parallel(Event&& event, ::std::index_sequence<Indexes...> const&)
+    {
+        static_assert(::afsm::detail::concurrent_event_posting<fsm_type>::value,
+                "Region actions can post events to the root machine concurrently, "
+                "parallel regions require a mutex or the lock-free event queue");
+        using result_type = actions::event_process_result;
+        static constexpr ::std::size_t local = accepting_regions<Event>::first;
+
+        ::std::array< result_type, size > results{};
+        results.fill(result_type::refuse);
+        ::std::array< ::std::exception_ptr, size > errors{};
+        detail::region_join join;
+        auto&& executor = fsm_->region_executor();
+        auto process_region = [&](auto index) {
+            constexpr ::std::size_t region = decltype(index)::value;
+            try {
+                results[region] = detail::process_region<region>(
+                        regions_, *fsm_, ::std::forward<Event>(event),
+                        detail::nth_region_accepts_event<region, regions_tuple, Event>{});
+            } catch (...) {
+                errors[region] = ::std::current_exception();
+            }
+        };
+        // The other accepting regions are posted to the executor, the
+        // first one is processed in this thread
+        try {
+            using expand = int[];
+            (void)expand{ 0, (Indexes == local ||
+                !detail::nth_region_accepts_event<Indexes, regions_tuple, Event>::value ? 0 : (join.post(
+                executor, [&process_region, &join]{
+                    process_region(::std::integral_constant< ::std::size_t, Indexes >{});
+                    join.done();
+                }), 0))... };
+        } catch (...) {
+            // The posted tasks refer to the locals of this function
+            join.wait();
+            throw;
+        }
+        process_region(::std::integral_constant< ::std::size_t, local >{});
+        join.wait();
+        for (auto const& e : errors) {
+            if (e)
+                ::std::rethrow_exception(e);
+        }
+        return *::std::max_element(results.begin(), results.end());
+    }
+
+    template < ::std::size_t ... Indexes >
+    void
+    reset_regions(::std::index_sequence<Indexes...> const&)
+    {
+        using expand = int[];
+        (void)expand{ 0, (::afsm::transitions::detail::state_frame_reset{}(
+                *fsm_, ::std::get<Indexes>(regions_)), 0)... };
+    }
 private:
     fsm_type*           fsm_;
     regions_tuple       regions_;
@@ -254,20 +467,26 @@ public:
     using size_type                     = typename region_table_type::size_type;
     using regions_tuple                 = typename region_table_type::regions_tuple;
 
-    using stack_constructor_type        = afsm::detail::stack_constructor<FSM, region_table_type>;
-    using event_set                     = ::afsm::detail::event_set;
+    using allocator_type                = afsm::detail::machine_allocator_type<
+            FSM, state_machine_definition_type >;
+    /**
+     * Frames popped from the stack are reset in place when the
+     * transition that popped them completes and are reused, the depth
+     * can be limited with def::tags::pushdown_depth for inline storage.
+     */
+    using stack_type                    = afsm::detail::frame_stack< FSM, region_table_type,
+            def::traits::pushdown_depth< state_machine_definition_type >::value,
+            allocator_type >;
+    using event_set                     = typename region_table_type::event_set;
 public:
-    regions_stack(fsm_type& fsm)
-        : fsm_{&fsm},
-          state_stack_{ stack_constructor_type::construct(fsm) }
+    regions_stack(fsm_type& fsm, allocator_type const& alloc)
+        : state_stack_{ fsm, typename stack_type::allocator_type{ alloc } }
     {}
     regions_stack(fsm_type& fsm, regions_stack const& rhs)
-        : fsm_{&fsm},
-          state_stack_{ stack_constructor_type::copy_construct(fsm, rhs.state_stack_) }
+        : state_stack_{ fsm, rhs.state_stack_ }
     {}
     regions_stack(fsm_type& fsm, regions_stack&& rhs)
-        : fsm_{&fsm},
-          state_stack_{ stack_constructor_type::move_construct(fsm, ::std::move(rhs.state_stack_)) }
+        : state_stack_{ fsm, ::std::move(rhs.state_stack_) }
     {}
 
     regions_stack(regions_stack const&) = delete;
@@ -280,16 +499,16 @@ public:
     void
     swap(regions_stack& rhs)
     {
-        using ::std::swap;
-        swap(state_stack_, rhs.state_stack_);
-        set_fsm(*fsm_);
-        rhs.set_fsm(*rhs.fsm_);
+        auto& fsm = state_stack_.fsm();
+        auto& rhs_fsm = rhs.state_stack_.fsm();
+        state_stack_.swap(rhs.state_stack_);
+        set_fsm(fsm);
+        rhs.set_fsm(rhs_fsm);
     }
 
     void
     set_fsm(fsm_type& fsm)
     {
-        fsm_ = &fsm;
         for (auto& item : state_stack_) {
             item.set_fsm(fsm);
         }
@@ -315,7 +534,9 @@ public:
     actions::event_process_result
     process_event(Event&& event)
     {
-        return top().process_event(::std::forward<Event>(event));
+        auto res = top().process_event(::std::forward<Event>(event));
+        state_stack_.reset_popped();
+        return res;
     }
     event_set
     current_handled_events() const
@@ -345,7 +566,7 @@ public:
     void
     push(Event&& event)
     {
-        state_stack_.emplace_back( *fsm_ );
+        state_stack_.push();
         enter(::std::forward<Event>(event));
     }
 
@@ -355,7 +576,7 @@ public:
     {
         if (state_stack_.size() > 1) {
             exit(::std::forward<Event>(event));
-            state_stack_.pop_back();
+            state_stack_.pop();
         }
     }
 
@@ -365,16 +586,13 @@ public:
         return state_stack_.size();
     }
 private:
-    using stack_type                    = typename stack_constructor_type::type;
-
     region_table_type&
     top()
-    { return state_stack_.back(); }
+    { return state_stack_.top(); }
     region_table_type const&
     top() const
-    { return state_stack_.back(); }
+    { return state_stack_.top(); }
 private:
-    fsm_type        *fsm_;
     stack_type      state_stack_;
 };
 
@@ -393,8 +611,9 @@ namespace detail {
 template < typename FSM, typename FSM_DEF, typename Size, bool HasPushdowns >
 struct region_container {
     using region_tuple = typename region_container_selector<FSM, FSM_DEF, Size, HasPushdowns>::type;
+    using allocator_type = afsm::detail::machine_allocator_type<FSM, FSM_DEF>;
 
-    region_container(FSM* fsm)
+    region_container(FSM* fsm, allocator_type const&)
         : regions_{*fsm}
     {}
     region_container(FSM* fsm, region_container const& rhs)
@@ -410,9 +629,10 @@ protected:
 template < typename FSM, typename FSM_DEF, typename Size >
 struct region_container<FSM, FSM_DEF, Size, true> {
     using region_tuple = typename region_container_selector<FSM, FSM_DEF, Size, true>::type;
+    using allocator_type = afsm::detail::machine_allocator_type<FSM, FSM_DEF>;
 
-    region_container(FSM* fsm)
-        : regions_{*fsm}
+    region_container(FSM* fsm, allocator_type const& alloc)
+        : regions_{*fsm, alloc}
     {}
     region_container(FSM* fsm, region_container const& rhs)
         : regions_{*fsm, rhs.regions_}
@@ -456,8 +676,10 @@ struct region_container
     using base_type = detail::region_container<FSM, FSM_DEF, Size,
             def::has_pushdown_stack<FSM_DEF>::value>;
     using region_tuple = typename base_type::region_tuple;
+    using allocator_type = typename base_type::allocator_type;
 
-    region_container(FSM* fsm) : base_type{fsm} {}
+    region_container(FSM* fsm, allocator_type const& alloc)
+        : base_type{fsm, alloc} {}
     region_container(FSM* fsm, region_container const& rhs)
         : base_type{fsm, rhs} {}
     region_container(FSM* fsm, region_container&& rhs)
@@ -0,0 +1,607 @@
+/*
+ * state_storage.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_DETAIL_STATE_STORAGE_HPP_
+#define AFSM_DETAIL_STATE_STORAGE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace afsm {
+namespace detail {
+
+template < ::std::size_t N, typename ... T >
+typename ::std::tuple_element< N, ::std::tuple<T...> >::type&
+inner_state(::std::tuple<T...>& states)
+{
+    return ::std::get<N>(states);
+}
+
+template < ::std::size_t N, typename ... T >
+typename ::std::tuple_element< N, ::std::tuple<T...> >::type const&
+inner_state(::std::tuple<T...> const& states)
+{
+    return ::std::get<N>(states);
+}
+
+/**
+ * Placeholder in the persistent states tuple for a state living
+ * in a slot of the compact storage.
+ */
+template < typename T >
+struct slot_state {};
+
+template < typename FSM, typename T, bool InSlot >
+struct compact_element {
+    using type = T;
+
+    static type
+    construct(FSM& fsm)
+    { return type{fsm}; }
+    static type
+    copy_construct(FSM& fsm, type const& rhs)
+    { return type{fsm, rhs}; }
+    static type
+    move_construct(FSM& fsm, type&& rhs)
+    { return type{fsm, ::std::move(rhs)}; }
+    static void
+    set_fsm(type& state, FSM& fsm)
+    { state.enclosing_fsm(fsm); }
+    template < typename Reset >
+    static void
+    reset(type& state, FSM& fsm, Reset const& reset)
+    { reset(fsm, state); }
+};
+
+template < typename FSM, typename T >
+struct compact_element< FSM, T, true > {
+    using type = slot_state<T>;
+
+    static type
+    construct(FSM&)
+    { return type{}; }
+    static type
+    copy_construct(FSM&, type const&)
+    { return type{}; }
+    static type
+    move_construct(FSM&, type&&)
+    { return type{}; }
+    static void
+    set_fsm(type&, FSM&) {}
+    template < typename Reset >
+    static void
+    reset(type&, FSM&, Reset const&) {}
+};
+
+/**
+ * Operations on a state in a slot of the compact storage, for the
+ * function tables indexed by the state index.
+ */
+template < typename FSM, typename T, bool InSlot >
+struct slot_ops {
+    static void
+    destroy(void* p) noexcept
+    { static_cast<T*>(p)->~T(); }
+    static void
+    copy(void* dst, void const* src, FSM& fsm)
+    { new (dst) T{fsm, *static_cast<T const*>(src)}; }
+    static void
+    move(void* dst, void* src, FSM& fsm)
+    { new (dst) T{fsm, ::std::move(*static_cast<T*>(src))}; }
+    static void
+    relocate(void* dst, void* src)
+    {
+        new (dst) T{::std::move(*static_cast<T*>(src))};
+        destroy(src);
+    }
+    static void
+    swap(void* lhs, void* rhs)
+    {
+        using ::std::swap;
+        swap(*static_cast<T*>(lhs), *static_cast<T*>(rhs));
+    }
+    static void
+    set_fsm(void* p, FSM& fsm)
+    { static_cast<T*>(p)->enclosing_fsm(fsm); }
+};
+
+template < typename FSM, typename T >
+struct slot_ops< FSM, T, false > {
+    static void
+    destroy(void*) noexcept {}
+    static void
+    copy(void*, void const*, FSM&) {}
+    static void
+    move(void*, void*, FSM&) {}
+    static void
+    relocate(void*, void*) {}
+    static void
+    swap(void*, void*) {}
+    static void
+    set_fsm(void*, FSM&) {}
+};
+
+template < typename FSM, ::std::size_t Initial, typename States, typename InSlot >
+class compact_states;
+
+/**
+ * Storage for the inner states of a state machine where only the active
+ * state is alive.
+ *
+ * States that are reset when left live in one of two slots sized to the
+ * largest of them. A state is constructed in the free slot when a
+ * transition enters it, so the source and the target of a transition
+ * are both alive until the transition completes, after that the source
+ * is destroyed. States keeping their data when left (with history or
+ * tagged no_state_reset) live in a tuple, as in the default storage.
+ *
+ * Only the current state and the states in the tuple can be accessed.
+ */
+template < typename FSM, ::std::size_t Initial, typename ... T, bool ... InSlot >
+class compact_states< FSM, Initial, ::std::tuple<T...>,
+        ::std::integer_sequence<bool, InSlot...> > {
+public:
+    using fsm_type          = FSM;
+    using states_tuple      = ::std::tuple<T...>;
+    static constexpr ::std::size_t size = sizeof ... (T);
+    static constexpr ::std::size_t initial_state_index = Initial;
+
+    template < ::std::size_t N >
+    using state_type = typename ::std::tuple_element< N, states_tuple >::type;
+    template < ::std::size_t N >
+    using in_slot = typename ::std::tuple_element< N,
+            ::std::tuple< ::std::integral_constant<bool, InSlot>... > >::type;
+public:
+    explicit
+    compact_states(fsm_type& fsm)
+        : states_{ compact_element<fsm_type, T, InSlot>::construct(fsm)... }
+    {
+        emplace_initial(fsm, in_slot<initial_state_index>{});
+    }
+    compact_states(fsm_type& fsm, compact_states const& rhs)
+        : compact_states{fsm, rhs, ::std::index_sequence_for<T...>{}}
+    {
+        if (rhs.live_ != none) {
+            copy_table()[rhs.live_](&slots_[0], &rhs.slots_[rhs.active_], fsm);
+            live_ = rhs.live_;
+        }
+    }
+    compact_states(fsm_type& fsm, compact_states&& rhs)
+        : compact_states{fsm, ::std::move(rhs), ::std::index_sequence_for<T...>{}}
+    {
+        if (rhs.live_ != none) {
+            move_table()[rhs.live_](&slots_[0], &rhs.slots_[rhs.active_], fsm);
+            live_ = rhs.live_;
+        }
+    }
+    compact_states(compact_states&& rhs)
+        : states_{ ::std::move(rhs.states_) }
+    {
+        if (rhs.live_ != none) {
+            relocate_table()[rhs.live_](&slots_[0], &rhs.slots_[rhs.active_]);
+            live_ = rhs.live_;
+            rhs.live_ = none;
+        }
+    }
+    compact_states(compact_states const&) = delete;
+    compact_states&
+    operator = (compact_states const&) = delete;
+    compact_states&
+    operator = (compact_states&&) = delete;
+
+    ~compact_states()
+    {
+        release();
+    }
+
+    void
+    swap(compact_states& rhs)
+    {
+        using ::std::swap;
+        swap(states_, rhs.states_);
+        if (live_ == rhs.live_) {
+            if (live_ != none)
+                swap_table()[live_](&slots_[active_], &rhs.slots_[rhs.active_]);
+            return;
+        }
+        slot_type tmp;
+        if (live_ != none)
+            relocate_table()[live_](&tmp, &slots_[active_]);
+        if (rhs.live_ != none)
+            relocate_table()[rhs.live_](&slots_[active_], &rhs.slots_[rhs.active_]);
+        if (live_ != none)
+            relocate_table()[live_](&rhs.slots_[rhs.active_], &tmp);
+        swap(live_, rhs.live_);
+    }
+
+    void
+    set_fsm(fsm_type& fsm)
+    {
+        set_fsm(fsm, ::std::index_sequence_for<T...>{});
+        if (live_ != none)
+            set_fsm_table()[live_](&slots_[active_], fsm);
+    }
+
+    /**
+     * A state in a slot must be the current one, accessing another state
+     * in a slot is checked with an assertion.
+     */
+    template < ::std::size_t N >
+    state_type<N>&
+    get()
+    {
+        return get<N>(in_slot<N>{});
+    }
+    template < ::std::size_t N >
+    state_type<N> const&
+    get() const
+    {
+        return get<N>(in_slot<N>{});
+    }
+
+    /**
+     * Construct a state in the free slot.
+     */
+    template < ::std::size_t N >
+    state_type<N>&
+    prepare(fsm_type& fsm)
+    {
+        static_assert(in_slot<N>::value, "The state is not stored in a slot");
+        return *new (&slots_[active_ ^ 1]) state_type<N>{fsm};
+    }
+    /**
+     * Destroy a state prepared in the free slot.
+     */
+    template < ::std::size_t N >
+    void
+    discard() noexcept
+    {
+        slot_ops<fsm_type, state_type<N>, true>::destroy(&slots_[active_ ^ 1]);
+    }
+    /**
+     * Make the prepared state live and destroy the previous one.
+     */
+    template < ::std::size_t N >
+    void
+    commit() noexcept
+    {
+        release();
+        active_ ^= 1;
+        live_ = N;
+    }
+    /**
+     * Return to the initial configuration. The state in the live slot
+     * is destroyed, the states in the tuple are reset with the Reset
+     * function object.
+     */
+    template < typename Reset >
+    void
+    reset(fsm_type& fsm, Reset const& reset)
+    {
+        release();
+        active_ = 0;
+        reset_states(fsm, reset, ::std::index_sequence_for<T...>{});
+        emplace_initial(fsm, in_slot<initial_state_index>{});
+    }
+    /**
+     * Destroy the state in the live slot.
+     */
+    void
+    release() noexcept
+    {
+        if (live_ != none) {
+            destroy_table()[live_](&slots_[active_]);
+            live_ = none;
+        }
+    }
+private:
+    static constexpr ::std::size_t none = size;
+    static constexpr ::std::size_t slot_size =
+            ::std::max({ ::std::size_t{1}, (InSlot ? sizeof(T) : 1)... });
+    static constexpr ::std::size_t slot_align =
+            ::std::max({ alignof(char), (InSlot ? alignof(T) : 1)... });
+    using slot_type = typename ::std::aligned_storage<slot_size, slot_align>::type;
+    using persistent_tuple = ::std::tuple<
+            typename compact_element<fsm_type, T, InSlot>::type... >;
+
+    template < ::std::size_t ... Indexes >
+    compact_states(fsm_type& fsm, compact_states const& rhs,
+            ::std::index_sequence<Indexes...> const&)
+        : states_{ compact_element<fsm_type, T, InSlot>::copy_construct(
+                fsm, ::std::get<Indexes>(rhs.states_))... }
+    {}
+    template < ::std::size_t ... Indexes >
+    compact_states(fsm_type& fsm, compact_states&& rhs,
+            ::std::index_sequence<Indexes...> const&)
+        : states_{ compact_element<fsm_type, T, InSlot>::move_construct(
+                fsm, ::std::move(::std::get<Indexes>(rhs.states_)))... }
+    {}
+
+    void
+    emplace_initial(fsm_type& fsm, ::std::true_type const&)
+    {
+        new (&slots_[0]) state_type<initial_state_index>{fsm};
+        live_ = initial_state_index;
+    }
+    void
+    emplace_initial(fsm_type&, ::std::false_type const&) {}
+
+    template < ::std::size_t N >
+    state_type<N>&
+    get(::std::false_type const&)
+    { return ::std::get<N>(states_); }
+    template < ::std::size_t N >
+    state_type<N> const&
+    get(::std::false_type const&) const
+    { return ::std::get<N>(states_); }
+    template < ::std::size_t N >
+    state_type<N>&
+    get(::std::true_type const&)
+    {
+        assert(live_ == N && "The state is not alive");
+        return *reinterpret_cast<state_type<N>*>(&slots_[active_]);
+    }
+    template < ::std::size_t N >
+    state_type<N> const&
+    get(::std::true_type const&) const
+    {
+        assert(live_ == N && "The state is not alive");
+        return *reinterpret_cast<state_type<N> const*>(&slots_[active_]);
+    }
+
+    template < ::std::size_t ... Indexes >
+    void
+    set_fsm(fsm_type& fsm, ::std::index_sequence<Indexes...> const&)
+    {
+        using expand = int[];
+        (void)expand{ 0, (compact_element<fsm_type, T, InSlot>::set_fsm(
+                ::std::get<Indexes>(states_), fsm), 0)... };
+    }
+    template < typename Reset, ::std::size_t ... Indexes >
+    void
+    reset_states(fsm_type& fsm, Reset const& reset,
+            ::std::index_sequence<Indexes...> const&)
+    {
+        using expand = int[];
+        (void)expand{ 0, (compact_element<fsm_type, T, InSlot>::reset(
+                ::std::get<Indexes>(states_), fsm, reset), 0)... };
+    }
+
+    using destroy_function  = void(*)(void*);
+    using copy_function     = void(*)(void*, void const*, fsm_type&);
+    using move_function     = void(*)(void*, void*, fsm_type&);
+    using relocate_function = void(*)(void*, void*);
+    using set_fsm_function  = void(*)(void*, fsm_type&);
+
+    static ::std::array< destroy_function, size > const&
+    destroy_table()
+    {
+        static constexpr ::std::array< destroy_function, size > _table{{
+            &slot_ops<fsm_type, T, InSlot>::destroy...
+        }};
+        return _table;
+    }
+    static ::std::array< copy_function, size > const&
+    copy_table()
+    {
+        static constexpr ::std::array< copy_function, size > _table{{
+            &slot_ops<fsm_type, T, InSlot>::copy...
+        }};
+        return _table;
+    }
+    static ::std::array< move_function, size > const&
+    move_table()
+    {
+        static constexpr ::std::array< move_function, size > _table{{
+            &slot_ops<fsm_type, T, InSlot>::move...
+        }};
+        return _table;
+    }
+    static ::std::array< relocate_function, size > const&
+    relocate_table()
+    {
+        static constexpr ::std::array< relocate_function, size > _table{{
+            &slot_ops<fsm_type, T, InSlot>::relocate...
+        }};
+        return _table;
+    }
+    static ::std::array< relocate_function, size > const&
+    swap_table()
+    {
+        static constexpr ::std::array< relocate_function, size > _table{{
+            &slot_ops<fsm_type, T, InSlot>::swap...
+        }};
+        return _table;
+    }
+    static ::std::array< set_fsm_function, size > const&
+    set_fsm_table()
+    {
+        static constexpr ::std::array< set_fsm_function, size > _table{{
+            &slot_ops<fsm_type, T, InSlot>::set_fsm...
+        }};
+        return _table;
+    }
+private:
+    persistent_tuple    states_;
+    slot_type           slots_[2]   {};
+    ::std::size_t       live_       = none;
+    unsigned char       active_     = 0;
+};
+
+template < typename FSM, ::std::size_t Initial, typename ... T, bool ... InSlot >
+constexpr ::std::size_t compact_states< FSM, Initial, ::std::tuple<T...>,
+        ::std::integer_sequence<bool, InSlot...> >::size;
+template < typename FSM, ::std::size_t Initial, typename ... T, bool ... InSlot >
+constexpr ::std::size_t compact_states< FSM, Initial, ::std::tuple<T...>,
+        ::std::integer_sequence<bool, InSlot...> >::initial_state_index;
+template < typename FSM, ::std::size_t Initial, typename ... T, bool ... InSlot >
+constexpr ::std::size_t compact_states< FSM, Initial, ::std::tuple<T...>,
+        ::std::integer_sequence<bool, InSlot...> >::none;
+
+template < typename FSM, ::std::size_t Initial, typename States, typename InSlot >
+void
+swap(compact_states<FSM, Initial, States, InSlot>& lhs,
+        compact_states<FSM, Initial, States, InSlot>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+template < ::std::size_t N, typename FSM, ::std::size_t Initial,
+        typename States, typename InSlot >
+typename ::std::tuple_element< N, States >::type&
+inner_state(compact_states<FSM, Initial, States, InSlot>& states)
+{
+    return states.template get<N>();
+}
+
+template < ::std::size_t N, typename FSM, ::std::size_t Initial,
+        typename States, typename InSlot >
+typename ::std::tuple_element< N, States >::type const&
+inner_state(compact_states<FSM, Initial, States, InSlot> const& states)
+{
+    return states.template get<N>();
+}
+
+/**
+ * Constructor of the compact storage with the interface of
+ * front_state_tuple.
+ */
+template < typename FSM, ::std::size_t Initial, typename States, typename InSlot >
+struct compact_state_tuple {
+    using type = compact_states< FSM, Initial, States, InSlot >;
+
+    static type
+    construct(FSM& fsm)
+    { return type{fsm}; }
+    static type
+    copy_construct(FSM& fsm, type const& rhs)
+    { return type{fsm, rhs}; }
+    static type
+    move_construct(FSM& fsm, type&& rhs)
+    { return type{fsm, ::std::move(rhs)}; }
+};
+
+/**
+ * Target state of a transition. In the default storage the target is
+ * always alive.
+ */
+template < ::std::size_t N, typename States, typename FSM >
+class state_slot {
+public:
+    using state_type = typename ::std::tuple_element< N, States >::type;
+public:
+    state_slot(States& states, FSM&)
+        : state_{ inner_state<N>(states) } {}
+    state_slot(state_slot const&) = delete;
+    state_slot&
+    operator = (state_slot const&) = delete;
+
+    state_type&
+    get() noexcept
+    { return state_; }
+    void
+    commit() noexcept {}
+private:
+    state_type& state_;
+};
+
+template < ::std::size_t N, typename Storage, typename FSM, bool InSlot >
+class compact_state_slot;
+
+/**
+ * Target state kept in the persistent tuple, the live state in the slot
+ * is destroyed when the transition completes.
+ */
+template < ::std::size_t N, typename Storage, typename FSM >
+class compact_state_slot< N, Storage, FSM, false > {
+public:
+    using state_type = typename Storage::template state_type<N>;
+public:
+    compact_state_slot(Storage& states, FSM&)
+        : states_{states} {}
+    compact_state_slot(compact_state_slot const&) = delete;
+    compact_state_slot&
+    operator = (compact_state_slot const&) = delete;
+
+    state_type&
+    get() noexcept
+    { return states_.template get<N>(); }
+    void
+    commit() noexcept
+    { states_.release(); }
+private:
+    Storage&    states_;
+};
+
+/**
+ * Target state constructed in the free slot. If the transition fails the
+ * target is destroyed, otherwise it replaces the live state.
+ */
+template < ::std::size_t N, typename Storage, typename FSM >
+class compact_state_slot< N, Storage, FSM, true > {
+public:
+    using state_type = typename Storage::template state_type<N>;
+public:
+    compact_state_slot(Storage& states, FSM& fsm)
+        : states_{states}, state_{ states.template prepare<N>(fsm) } {}
+    compact_state_slot(compact_state_slot const&) = delete;
+    compact_state_slot&
+    operator = (compact_state_slot const&) = delete;
+    ~compact_state_slot()
+    {
+        if (!committed_)
+            states_.template discard<N>();
+    }
+
+    state_type&
+    get() noexcept
+    { return state_; }
+    void
+    commit() noexcept
+    {
+        states_.template commit<N>();
+        committed_ = true;
+    }
+private:
+    Storage&    states_;
+    state_type& state_;
+    bool        committed_ = false;
+};
+
+template < ::std::size_t N, typename FSM, ::std::size_t Initial,
+        typename States, typename InSlot >
+class state_slot< N, compact_states<FSM, Initial, States, InSlot>, FSM >
+    : public compact_state_slot< N, compact_states<FSM, Initial, States, InSlot>, FSM,
+            compact_states<FSM, Initial, States, InSlot>::template in_slot<N>::value > {
+    using base_type = compact_state_slot< N, compact_states<FSM, Initial, States, InSlot>, FSM,
+            compact_states<FSM, Initial, States, InSlot>::template in_slot<N>::value >;
+public:
+    using base_type::base_type;
+};
+
+}  /* namespace detail */
+}  /* namespace afsm */
+
+namespace std {
+
+template < typename FSM, ::std::size_t Initial, typename ... T, typename InSlot >
+struct tuple_size< ::afsm::detail::compact_states<FSM, Initial, ::std::tuple<T...>, InSlot> >
+    : ::std::integral_constant< ::std::size_t, sizeof ... (T) > {};
+
+template < ::std::size_t N, typename FSM, ::std::size_t Initial, typename ... T, typename InSlot >
+struct tuple_element< N, ::afsm::detail::compact_states<FSM, Initial, ::std::tuple<T...>, InSlot> >
+    : tuple_element< N, ::std::tuple<T...> > {};
+
+}  /* namespace std */
+
+#endif /* AFSM_DETAIL_STATE_STORAGE_HPP_ */
@@ -8,6 +8,8 @@
 #ifndef AFSM_DETAIL_TAGS_HPP_
 #define AFSM_DETAIL_TAGS_HPP_
 
+#include <cstddef>
+
 namespace afsm {
 namespace def {
 namespace tags {
@@ -79,9 +81,182 @@ struct popup : popup_state {
 };
 //@}
 
+/**
+ * Tag for marking states that keep their data when they are left.
+ */
+struct no_state_reset {};
+
+/**
+ * Tag for marking states that don't keep a pointer to the enclosing
+ * state machine. Such states are smaller, but state::enclosing_fsm() and
+ * root_machine(state) don't compile for them, actions and guards still
+ * receive the machine as a parameter.
+ */
+struct no_enclosing_fsm_pointer {};
+
+/**
+ * Tag for marking state machines that keep only the active inner state
+ * alive. Inner states that are reset when left share storage sized to
+ * the largest of them, a state is constructed when a transition enters
+ * it and destroyed when the transition leaves it. States with history
+ * and states tagged no_state_reset are kept for the machine's lifetime.
+ * Only the current state and the kept states can be accessed with
+ * get_state, accessing another state fails an assertion.
+ * The storage has two slots for the states that are reset, so it takes
+ * less memory only when the largest of them is smaller than the others
+ * combined.
+ */
+struct compact_state_storage {};
+
+/**
+ * Tag for marking orthogonal state machines that pass an event to their
+ * regions in parallel. The state machine definition must provide a
+ * region_executor() member function returning an object with a
+ * post(task) function that runs the task asynchronously. The event is
+ * processed by the first region in the calling thread, the other
+ * regions are posted to the executor, and the results are combined
+ * when all of them finish. Region actions run concurrently, so they
+ * must not share unsynchronized data. Enter and exit of the regions
+ * are still sequential.
+ * Region actions can post events to the outermost state machine, so it
+ * must have a mutex or use lock_free_event_queue. The observer is called
+ * from the executor threads and must be thread-safe.
+ */
+struct parallel_regions {};
+
+/**
+ * Tag for marking state machines that run the activities of their states
+ * on a user-supplied executor. The outermost state machine definition
+ * must provide an activity_executor() member function returning an object
+ * with a post(task) function that runs the task asynchronously. Without
+ * the tag activities run on a built-in thread pool with a thread per
+ * running activity, up to 64 threads by default. When all of them are
+ * busy, a new activity waits for a running one to finish.
+ */
+struct custom_activity_executor {};
+
 struct allow_empty_enter_exit {};
 struct mandatory_empty_enter_exit {};
 
+/**
+ * Tag for marking state machines with custom queued event storage.
+ * For internal use.
+ */
+struct has_event_storage_size {};
+/**
+ * Size of inline storage for an event waiting in a state machine queue.
+ * Larger events are allocated on the heap.
+ */
+template < ::std::size_t Size >
+struct event_storage_size : has_event_storage_size {
+    static constexpr ::std::size_t queued_event_storage_size = Size;
+};
+
+template < ::std::size_t Size >
+constexpr ::std::size_t event_storage_size<Size>::queued_event_storage_size;
+
+/**
+ * Default size of inline storage for a queued event.
+ */
+constexpr ::std::size_t default_event_storage_size = sizeof(void*) * 4;
+
+//@{
+/** @name Event queue policies */
+/**
+ * Events posted while the state machine is busy are stored in a ring
+ * buffer guarded by the state machine's mutex. This is the default.
+ */
+struct mutex_event_queue {};
+/**
+ * Events posted while the state machine is busy are stored in a
+ * lock-free multiple producer single consumer queue, producer threads
+ * never block each other. The observer's enqueue_event hook is called
+ * without holding the mutex.
+ */
+struct lock_free_event_queue {};
+//@}
+
+//@{
+/** @name Event queue overflow policies */
+/**
+ * The producer waits until there is room in the queue. Events posted
+ * from the machine's own actions must not overflow a queue with this
+ * policy, as the machine cannot drain the queue while it waits.
+ */
+struct block_on_full_queue {};
+/**
+ * The event is discarded and process_event returns
+ * event_process_result::overflow.
+ */
+struct reject_on_full_queue {};
+/**
+ * The oldest queued event is discarded to make room for the new one.
+ * Not supported by the lock-free queue and the priority state machine.
+ */
+struct drop_oldest_on_full_queue {};
+/**
+ * The new event is discarded, process_event returns
+ * event_process_result::overflow.
+ */
+struct drop_newest_on_full_queue {};
+//@}
+
+/**
+ * Tag for marking state machines with a bounded event queue.
+ * For internal use.
+ */
+struct has_event_queue_capacity {};
+/**
+ * Limit the number of events waiting in the state machine queue.
+ * The queue storage is allocated for the capacity up front. With the
+ * lock_free_event_queue policy the capacity must be a power of two.
+ */
+template < ::std::size_t Capacity, typename Overflow = reject_on_full_queue >
+struct event_queue_capacity : has_event_queue_capacity {
+    static_assert(Capacity > 0, "Event queue capacity must be positive");
+    static constexpr ::std::size_t queued_event_capacity = Capacity;
+    using queue_overflow_policy = Overflow;
+};
+
+template < ::std::size_t Capacity, typename Overflow >
+constexpr ::std::size_t event_queue_capacity<Capacity, Overflow>::queued_event_capacity;
+
+/**
+ * Tag for marking pushdown state machines with a maximum stack depth.
+ * For internal use.
+ */
+struct has_pushdown_depth {};
+/**
+ * Limit the depth of a pushdown state machine stack. The frames are
+ * stored inline in the machine and constructed with it, pushing deeper
+ * throws std::length_error. Without the tag the frames are allocated
+ * when the stack gets deeper than before and reused after that.
+ */
+template < ::std::size_t Depth >
+struct pushdown_depth : has_pushdown_depth {
+    static_assert(Depth > 0, "Pushdown stack depth must be positive");
+    static constexpr ::std::size_t max_pushdown_depth = Depth;
+};
+
+template < ::std::size_t Depth >
+constexpr ::std::size_t pushdown_depth<Depth>::max_pushdown_depth;
+
+/**
+ * Tag for marking state machines with a custom allocator.
+ * For internal use.
+ */
+struct has_allocator {};
+/**
+ * Allocator for the event queues, the deferred events and the pushdown
+ * stacks of a state machine, rebound to the item types. An allocator
+ * instance is passed to the outer machine constructor after
+ * std::allocator_arg, the inner state machines use the same instance.
+ */
+template < typename Allocator >
+struct allocator : has_allocator {
+    using machine_allocator_type = Allocator;
+};
+
 }  /* namespace tags */
 }  /* namespace def */
 }  /* namespace afsm */
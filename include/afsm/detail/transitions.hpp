@@ -11,9 +11,12 @@
 #include <afsm/detail/actions.hpp>
 #include <afsm/detail/exception_safety_guarantees.hpp>
 #include <afsm/detail/event_identity.hpp>
+#include <afsm/detail/frame_stack.hpp>
+#include <afsm/detail/helpers.hpp>
 
 #include <deque>
 #include <memory>
+#include <new>
 #include <algorithm>
 
 #include <iostream>
@@ -138,11 +141,42 @@ struct is_valid_activity < void, FSM, State >{
     static constexpr bool value = true;
 };
 
+/**
+ * Start and stop of the state's activity
+ */
+template < typename FSM, typename State,
+        bool HasActivity = def::traits::has_activity<State>::value >
+struct state_activity {
+    static_assert(is_valid_activity<typename State::activity, FSM, State>::value,
+            "State activity must have start(fsm, state) and stop(fsm, state) member functions");
+    void
+    start(State& state, FSM& fsm) const
+    {
+        state.state_activity().start(fsm, state);
+    }
+    void
+    stop(State& state, FSM&) const
+    {
+        state.state_activity().stop();
+    }
+};
+
+template < typename FSM, typename State >
+struct state_activity< FSM, State, false > {
+    void
+    start(State&, FSM&) const noexcept {}
+    void
+    stop(State&, FSM&) const noexcept {}
+};
+
 template < typename FSM, typename State, typename Event, bool hasExit >
 struct state_exit_impl {
     void
     operator()(State& state, Event const& event, FSM& fsm) const
+        noexcept(noexcept(state_activity<FSM, State>{}.stop(state, fsm)) &&
+                noexcept(state.state_exit(event, fsm)) && noexcept(state.on_exit(event, fsm)))
     {
+        state_activity<FSM, State>{}.stop(state, fsm);
         state.state_exit(event, fsm);
         state.on_exit(event, fsm);
     }
@@ -152,7 +186,10 @@ template < typename FSM, typename State, typename Event >
 struct state_exit_impl< FSM, State, Event, false > {
     void
     operator()(State& state, Event const& event, FSM& fsm) const
+        noexcept(noexcept(state_activity<FSM, State>{}.stop(state, fsm)) &&
+                noexcept(state.state_exit(event, fsm)))
     {
+        state_activity<FSM, State>{}.stop(state, fsm);
         state.state_exit(event, fsm);
     }
 };
@@ -167,9 +204,13 @@ struct state_enter_impl {
     template < typename Event >
     void
     operator()(State& state, Event&& event, FSM& fsm) const
+        noexcept(noexcept(state.on_enter(::std::forward<Event>(event), fsm)) &&
+                noexcept(state.state_enter(::std::forward<Event>(event), fsm)) &&
+                noexcept(state_activity<FSM, State>{}.start(state, fsm)))
     {
         state.on_enter(::std::forward<Event>(event), fsm);
         state.state_enter(::std::forward<Event>(event), fsm);
+        state_activity<FSM, State>{}.start(state, fsm);
     }
 };
 
@@ -178,8 +219,11 @@ struct state_enter_impl< FSM, State, false > {
     template < typename Event >
     void
     operator()(State& state, Event&& event, FSM& fsm) const
+        noexcept(noexcept(state.state_enter(::std::forward<Event>(event), fsm)) &&
+                noexcept(state_activity<FSM, State>{}.start(state, fsm)))
     {
         state.state_enter(::std::forward<Event>(event), fsm);
+        state_activity<FSM, State>{}.start(state, fsm);
     }
 };
 
@@ -188,7 +232,69 @@ template < typename FSM, typename State, typename Event >
 struct state_enter : state_enter_impl<FSM, State,
         has_on_enter<State, FSM, Event>::value> {};
 
-template < typename FSM, typename State, bool HasHistory >
+template < typename State >
+struct has_reset {
+private:
+    template < typename U >
+    static ::std::true_type
+    test( decltype( ::std::declval<U&>().reset() ) const* );
+
+    template < typename U >
+    static ::std::false_type
+    test(...);
+public:
+    static constexpr bool value = decltype( test<State>(nullptr) )::value;
+};
+
+enum class state_reset_type {
+    none,
+    custom,
+    in_place,
+    assign,
+};
+
+template < state_reset_type V >
+using state_reset = ::std::integral_constant< state_reset_type, V >;
+
+/**
+ * Select the way to reset a state.
+ * A state definition can provide a reset() member function to clear
+ * itself. Otherwise a state with a nothrow default constructible
+ * definition is destroyed and constructed in place, other states and
+ * inner state machines are assigned a newly constructed instance.
+ */
+template < typename State >
+struct state_reset_strategy
+    : ::std::conditional<
+        def::traits::is_state_machine< State >::value,
+        state_reset< state_reset_type::assign >,
+        typename ::std::conditional<
+            has_reset< State >::value,
+            state_reset< state_reset_type::custom >,
+            typename ::std::conditional<
+                ::std::is_nothrow_default_constructible<
+                    typename State::state_definition_type >::value,
+                state_reset< state_reset_type::in_place >,
+                state_reset< state_reset_type::assign >
+            >::type
+        >::type
+    >::type {};
+
+/**
+ * Select the way to clear a state when it is left.
+ * States with history and states tagged with def::tags::no_state_reset
+ * are not cleared, other states are reset.
+ */
+template < typename State >
+struct state_reset_selector
+    : ::std::conditional<
+        def::traits::has_history< State >::value ||
+            def::traits::no_state_reset< State >::value,
+        state_reset< state_reset_type::none >,
+        state_reset_strategy< State >
+    >::type {};
+
+template < typename FSM, typename State, state_reset_type ResetType >
 struct state_clear_impl {
     bool
     operator()(FSM& fsm, State& state) const
@@ -199,15 +305,157 @@ struct state_clear_impl {
 };
 
 template < typename FSM, typename State >
-struct state_clear_impl< FSM, State, true > {
+struct state_clear_impl< FSM, State, state_reset_type::none > {
     bool
-    operator()(FSM&, State&) const
+    operator()(FSM&, State&) const noexcept
     { return false; }
 };
 
+template < typename FSM, typename State >
+struct state_clear_impl< FSM, State, state_reset_type::custom > {
+    bool
+    operator()(FSM&, State& state) const noexcept(noexcept(state.reset()))
+    {
+        state.reset();
+        return true;
+    }
+};
+
+template < typename FSM, typename State >
+struct state_clear_impl< FSM, State, state_reset_type::in_place > {
+    bool
+    operator()(FSM& fsm, State& state) const noexcept
+    {
+        state.~State();
+        new (&state) State{fsm};
+        return true;
+    }
+};
+
 template < typename FSM, typename State >
 struct state_clear : state_clear_impl< FSM, State,
-    def::traits::has_history< State >::value > {};
+    state_reset_selector< State >::value > {};
+
+/**
+ * Reset of a state in a frame popped from a pushdown stack. The frame
+ * is entered anew when pushed again, so history and
+ * def::tags::no_state_reset don't apply.
+ */
+struct state_frame_reset {
+    template < typename FSM, typename State >
+    void
+    operator()(FSM& fsm, State& state) const
+    {
+        state_clear_impl< FSM, State, state_reset_strategy< State >::value >{}(fsm, state);
+    }
+};
+
+/**
+ * Clear of a state in the compact storage, the state is destroyed
+ * when the transition completes.
+ */
+struct state_release {
+    template < typename FSM, typename State >
+    bool
+    operator()(FSM&, State&) const noexcept
+    { return true; }
+};
+
+/**
+ * States that are reset when left, the compact storage keeps them
+ * in a slot.
+ */
+template < typename States >
+struct slot_states;
+
+template < typename ... T >
+struct slot_states< ::std::tuple<T...> > {
+    using type = ::std::integer_sequence< bool,
+            (state_reset_selector<T>::value != state_reset_type::none)... >;
+};
+
+template < ::std::size_t N, typename SlotStates >
+struct in_slot;
+
+template < ::std::size_t N, bool ... InSlot >
+struct in_slot< N, ::std::integer_sequence<bool, InSlot...> >
+    : ::std::tuple_element< N,
+            ::std::tuple< ::std::integral_constant<bool, InSlot>... > >::type {};
+
+template < typename State >
+struct has_snapshot {
+private:
+    template < typename U >
+    static ::std::true_type
+    test( decltype( ::std::declval<U&>().restore(::std::declval<U&>().snapshot()) ) const* );
+
+    template < typename U >
+    static ::std::false_type
+    test(...);
+public:
+    static constexpr bool value = decltype( test<State>(nullptr) )::value;
+};
+
+enum class state_backup_type {
+    none,
+    snapshot,
+    copy,
+};
+
+template < state_backup_type V >
+using state_backup_selector = ::std::integral_constant< state_backup_type, V >;
+
+/**
+ * Data to roll back a state if a transition throws.
+ * Nothing is stored if the transition cannot throw. A state definition
+ * can provide a snapshot() function and a restore() function accepting
+ * the snapshot to avoid copying the whole state.
+ */
+template < typename State, bool Nothrow,
+        state_backup_type BackupType = (Nothrow ? state_backup_type::none :
+            has_snapshot<State>::value ? state_backup_type::snapshot :
+                    state_backup_type::copy) >
+struct state_backup {
+    explicit
+    state_backup(State& state)
+        : backup_{state} {}
+
+    void
+    restore(State& state)
+    {
+        using ::std::swap;
+        swap(state, backup_);
+    }
+private:
+    State backup_;
+};
+
+template < typename State, bool Nothrow >
+struct state_backup< State, Nothrow, state_backup_type::none > {
+    explicit
+    state_backup(State&) noexcept {}
+
+    void
+    restore(State&) noexcept {}
+};
+
+template < typename State, bool Nothrow >
+struct state_backup< State, Nothrow, state_backup_type::snapshot > {
+    using snapshot_type = typename ::std::decay<
+            decltype(::std::declval<State&>().snapshot()) >::type;
+
+    explicit
+    state_backup(State& state)
+        : snapshot_{state.snapshot()} {}
+
+    void
+    restore(State& state)
+    {
+        state.restore(::std::move(snapshot_));
+    }
+private:
+    snapshot_type snapshot_;
+};
 
 template < typename FSM, typename StateTable >
 struct no_transition {
@@ -324,22 +572,29 @@ struct transition_action_selector {
         >::type;
 };
 
+/**
+ * Adapter to place a transition handler into a table of function pointers.
+ */
+template < typename Handler >
+struct transition_invocation_func {
+    template < typename StateTable, typename Event >
+    static actions::event_process_result
+    invoke(StateTable& states, Event&& event)
+    {
+        return Handler{}(states, ::std::forward<Event>(event));
+    }
+};
+
 template < typename T, ::std::size_t StateIndex >
 struct common_base_cast_func {
     static constexpr ::std::size_t state_index = StateIndex;
-    using type  = typename ::std::decay<T>::type;
+    using type  = typename ::std::remove_reference<T>::type;
 
     template < typename StateTuple >
-    type&
-    operator()(StateTuple& states) const
+    static type&
+    cast(StateTuple& states)
     {
-        return static_cast< type& >(::std::get< state_index >(states));
-    }
-    template < typename StateTuple >
-    type const&
-    operator()(StateTuple const& states) const
-    {
-        return static_cast< type const& >(::std::get< state_index >(states));
+        return static_cast< type& >(::afsm::detail::inner_state< state_index >(states));
     }
 };
 
@@ -348,26 +603,42 @@ struct final_state_exit_func {
     static constexpr ::std::size_t state_index = StateIndex;
 
     template < typename StateTuple, typename Event, typename FSM >
-    void
-    operator()(StateTuple& states, Event&& event, FSM& fsm)
+    static void
+    invoke(StateTuple& states, Event&& event, FSM& fsm)
     {
         using final_state_type = typename ::std::tuple_element< state_index, StateTuple >::type;
         using final_exit = state_exit< FSM, final_state_type, Event >;
 
-        auto& final_state = ::std::get<state_index>(states);
+        auto& final_state = ::afsm::detail::inner_state<state_index>(states);
         final_exit{}(final_state, ::std::forward<Event>(event), fsm);
     }
 };
 
+template < ::std::size_t StateIndex >
+struct current_state_enter_func {
+    static constexpr ::std::size_t state_index = StateIndex;
+
+    template < typename StateTuple, typename Event, typename FSM >
+    static void
+    invoke(StateTuple& states, Event&& event, FSM& fsm)
+    {
+        using state_type = typename ::std::tuple_element< state_index, StateTuple >::type;
+        using enter_type = state_enter< FSM, state_type, Event >;
+
+        enter_type{}(::afsm::detail::inner_state<state_index>(states),
+                ::std::forward<Event>(event), fsm);
+    }
+};
+
 template < ::std::size_t StateIndex >
 struct get_current_events_func {
     static constexpr ::std::size_t state_index = StateIndex;
 
-    template < typename StateTuple >
-    ::afsm::detail::event_set
-    operator()(StateTuple const& states) const
+    template < typename EventSet, typename StateTuple >
+    static EventSet
+    invoke(StateTuple const& states)
     {
-        auto const& state = ::std::get<state_index>(states);
+        auto const& state = ::afsm::detail::inner_state<state_index>(states);
         return state.current_handled_events();
     }
 };
@@ -376,15 +647,41 @@ template < ::std::size_t StateIndex >
 struct get_current_deferred_events_func {
     static constexpr ::std::size_t state_index = StateIndex;
 
-    template < typename StateTuple >
-    ::afsm::detail::event_set
-    operator()(StateTuple const& states) const
+    template < typename EventSet, typename StateTuple >
+    static EventSet
+    invoke(StateTuple const& states)
     {
-        auto const& state = ::std::get<state_index>(states);
+        auto const& state = ::afsm::detail::inner_state<state_index>(states);
         return state.current_deferrable_events();
     }
 };
 
+/**
+ * Events handled and deferred by a state regardless of its inner
+ * configuration. For an inner state machine these depend on the active
+ * inner states and are collected at runtime.
+ */
+template < typename State,
+        bool IsMachine = def::traits::is_state_machine<
+                typename State::state_definition_type >::value >
+struct static_state_events {
+    static constexpr bool is_dynamic = false;
+    using handled_events    = typename State::handled_events;
+    using deferred_events   = typename State::deferred_events;
+};
+
+template < typename State >
+struct static_state_events< State, true > {
+    static constexpr bool is_dynamic = true;
+    using handled_events    = ::psst::meta::type_tuple<>;
+    using deferred_events   = ::psst::meta::type_tuple<>;
+};
+
+template < typename State, bool IsMachine >
+constexpr bool static_state_events<State, IsMachine>::is_dynamic;
+template < typename State >
+constexpr bool static_state_events<State, true>::is_dynamic;
+
 }  /* namespace detail */
 
 template < typename FSM, typename FSM_DEF, typename Size >
@@ -406,35 +703,76 @@ public:
             typename state_machine_definition_type::initial_state;
     using inner_states_def  =
             typename def::detail::inner_states< transitions >::type;
-    using inner_states_constructor =
+    static constexpr ::std::size_t initial_state_index =
+            ::psst::meta::index_of<initial_state, inner_states_def>::value;
+    static constexpr ::std::size_t size = inner_states_def::size;
+    /**
+     * The smallest type holding the index of the current state
+     */
+    using index_type        = typename afsm::detail::state_index_type< size_type, size >::type;
+    using index_value_type  = typename afsm::detail::state_index_value< size >::type;
+
+    using compact_storage   = def::traits::compact_state_storage< state_machine_definition_type >;
+    using front_states_tuple =
             afsm::detail::front_state_tuple< fsm_type, inner_states_def >;
+    using slot_states       =
+            typename detail::slot_states< typename front_states_tuple::type >::type;
+    using inner_states_constructor = typename ::std::conditional<
+            compact_storage::value,
+            afsm::detail::compact_state_tuple< fsm_type, initial_state_index,
+                    typename front_states_tuple::type, slot_states >,
+            front_states_tuple
+        >::type;
     using inner_states_tuple =
             typename inner_states_constructor::type;
     using dispatch_table    =
             actions::detail::inner_dispatch_table< inner_states_tuple >;
 
-    static constexpr ::std::size_t initial_state_index =
-            ::psst::meta::index_of<initial_state, inner_states_def>::value;
-    static constexpr ::std::size_t size = inner_states_def::size;
-
     using state_indexes     = typename ::psst::meta::index_builder<size>::type;
-    using event_set         = ::afsm::detail::event_set;
+    using event_set         =
+            typename ::afsm::detail::machine_event_set<fsm_type, state_machine_definition_type>::type;
 
     template < typename Event >
     using transition_table_type = ::std::array<
-            ::std::function< actions::event_process_result(this_type&, Event&&) >, size >;
+            actions::event_process_result(*)(this_type&, Event&&), size >;
 
     template < typename Event >
     using exit_table_type = ::std::array<
-            ::std::function< void(inner_states_tuple&, Event&&, fsm_type&) >, size >;
+            void(*)(inner_states_tuple&, Event&&, fsm_type&), size >;
+    template < typename Event >
+    using enter_table_type = exit_table_type<Event>;
+
+    /**
+     * Target of a transition, constructed by the transition in the
+     * compact storage.
+     */
+    template < ::std::size_t N >
+    using target_slot = afsm::detail::state_slot< N, inner_states_tuple, fsm_type >;
+    /**
+     * The state is destroyed when a transition leaves it
+     */
+    template < ::std::size_t N >
+    using released_on_exit = ::std::integral_constant< bool,
+            compact_storage::value && detail::in_slot< N, slot_states >::value >;
 
     using current_events_table = ::std::array<
-            ::std::function< event_set(inner_states_tuple const&) >, size >;
-    using available_transtions_table = ::std::array< event_set, size >;
+            event_set(*)(inner_states_tuple const&), size >;
+
+    /**
+     * Events handled and deferred in a state, including the events of
+     * transitions originating from it. If dynamic is set, the events
+     * of the active inner configuration must be added at runtime.
+     */
+    struct state_events_masks {
+        event_set   handled;
+        event_set   deferred;
+        bool        dynamic;
+    };
+    using state_masks_table = ::std::array< state_events_masks, size >;
 
     template < typename CommonBase, typename StatesTuple >
-    using cast_table_type = ::std::array< ::std::function<
-            CommonBase&( StatesTuple& ) >, size >;
+    using cast_table_type = ::std::array<
+            CommonBase&(*)( StatesTuple& ), size >;
 public:
     state_transition_table(fsm_type& fsm)
         : fsm_{&fsm},
@@ -444,19 +782,19 @@ public:
 
     state_transition_table(fsm_type& fsm, state_transition_table const& rhs)
         : fsm_{&fsm},
-          current_state_{ (::std::size_t)rhs.current_state_ },
+          current_state_{ (index_value_type)rhs.current_state_ },
           states_{ inner_states_constructor::copy_construct(fsm, rhs.states_) }
       {}
     state_transition_table(fsm_type& fsm, state_transition_table&& rhs)
         : fsm_{&fsm},
-          current_state_{ (::std::size_t)rhs.current_state_ },
+          current_state_{ (index_value_type)rhs.current_state_ },
           states_{ inner_states_constructor::move_construct(fsm, ::std::move(rhs.states_)) }
       {}
 
     state_transition_table(state_transition_table const&) = delete;
     state_transition_table(state_transition_table&& rhs)
         : fsm_{rhs.fsm_},
-          current_state_{ (::std::size_t)rhs.current_state_ },
+          current_state_{ (index_value_type)rhs.current_state_ },
           states_{ ::std::move(rhs.states_) }
     {}
     state_transition_table&
@@ -478,7 +816,22 @@ public:
     set_fsm(fsm_type& fsm)
     {
         fsm_ = &fsm;
-        ::afsm::detail::set_enclosing_fsm< size - 1 >::set(fsm, states_);
+        set_states_fsm(fsm, compact_storage{});
+    }
+
+    fsm_type&
+    fsm() const
+    { return *fsm_; }
+
+    /**
+     * Return the table to the initial state, the states are reset in
+     * place.
+     */
+    void
+    reset()
+    {
+        reset_states(compact_storage{});
+        current_state_ = static_cast<index_value_type>(initial_state_index);
     }
 
     inner_states_tuple&
@@ -491,11 +844,11 @@ public:
     template < ::std::size_t N>
     typename ::std::tuple_element< N, inner_states_tuple >::type&
     get_state()
-    { return ::std::get<N>(states_); }
+    { return ::afsm::detail::inner_state<N>(states_); }
     template < ::std::size_t N>
     typename ::std::tuple_element< N, inner_states_tuple >::type const&
     get_state() const
-    { return ::std::get<N>(states_); }
+    { return ::afsm::detail::inner_state<N>(states_); }
 
     ::std::size_t
     current_state() const
@@ -503,14 +856,14 @@ public:
 
     void
     set_current_state(::std::size_t val)
-    { current_state_ = val; }
+    { current_state_ = (index_value_type)val; }
 
     template < typename Event >
     actions::event_process_result
     process_event(Event&& event)
     {
         // Try dispatch to inner states
-        auto res = dispatch_table::process_event(states_, current_state(),
+        auto res = dispatch_table::process_event(states_, *fsm_, current_state(),
                 ::std::forward<Event>(event));
         if (res == actions::event_process_result::refuse) {
             // Check if the event can cause a transition and process it
@@ -533,11 +886,7 @@ public:
     void
     enter(Event&& event)
     {
-        using initial_state_type = typename ::std::tuple_element<initial_state_index, inner_states_tuple>::type;
-        using initial_enter = detail::state_enter< fsm_type, initial_state_type, Event >;
-
-        auto& initial = ::std::get< initial_state_index >(states_);
-        initial_enter{}(initial, ::std::forward<Event>(event), *fsm_);
+        enter(::std::forward<Event>(event), compact_storage{});
         check_default_transition();
     }
     template < typename Event >
@@ -561,7 +910,7 @@ public:
         typename SourceExit, typename TargetEnter, typename SourceClear >
     actions::event_process_result
     transit_state(Event&& event, Guard guard, Action action, SourceExit exit,
-            TargetEnter enter, SourceClear clear)
+            TargetEnter enter, SourceClear)
     {
         using source_index = ::psst::meta::index_of<SourceState, inner_states_def>;
         using target_index = ::psst::meta::index_of<TargetState, inner_states_def>;
@@ -569,104 +918,141 @@ public:
         static_assert(source_index::found, "Failed to find source state index");
         static_assert(target_index::found, "Failed to find target state index");
 
-        auto& source = ::std::get< source_index::value >(states_);
-        auto& target = ::std::get< target_index::value >(states_);
-        return transit_state_impl(
-                ::std::forward<Event>(event), source, target,
-                 guard, action, exit, enter, clear,
-                 target_index::value,
+        // In the compact storage the source is destroyed instead of clear
+        using clear_type = typename ::std::conditional<
+                released_on_exit< source_index::value >::value,
+                detail::state_release, SourceClear >::type;
+
+        auto& source = ::afsm::detail::inner_state< source_index::value >(states_);
+        return transit_state_impl< target_index::value >(
+                ::std::forward<Event>(event), source,
+                 guard, action, exit, enter, clear_type{},
                  typename def::traits::exception_safety<state_machine_definition_type>::type{});
     }
-    template < typename SourceState, typename TargetState,
+    template < ::std::size_t TargetIndex, typename SourceState,
         typename Event, typename Guard, typename Action,
         typename SourceExit, typename TargetEnter, typename SourceClear >
     actions::event_process_result
-    transit_state_impl(Event&& event, SourceState& source, TargetState& target,
+    transit_state_impl(Event&& event, SourceState& source,
             Guard guard, Action action, SourceExit exit,
             TargetEnter enter, SourceClear clear,
-            ::std::size_t target_index,
             def::tags::basic_exception_safety const&)
     {
         if (guard(*fsm_, source, event)) {
-            auto const& observer = root_machine(*fsm_);
-            exit(source, ::std::forward<Event>(event), *fsm_);
-            observer.state_exited(*fsm_, source, event);
-            action(::std::forward<Event>(event), *fsm_, source, target);
-            enter(target, ::std::forward<Event>(event), *fsm_);
-            observer.state_entered(*fsm_, target, event);
-            if (clear(*fsm_, source))
-                observer.state_cleared(*fsm_, source);
-            current_state_ = target_index;
-            observer.state_changed(*fsm_, source, target, event);
+            target_slot< TargetIndex > target{states_, *fsm_};
+            change_state(::std::forward<Event>(event), source, target.get(),
+                    action, exit, enter, clear, TargetIndex);
+            target.commit();
             return actions::event_process_result::process;
         }
         return actions::event_process_result::refuse;
     }
-    template < typename SourceState, typename TargetState,
+    template < ::std::size_t TargetIndex, typename SourceState,
         typename Event, typename Guard, typename Action,
         typename SourceExit, typename TargetEnter, typename SourceClear >
     actions::event_process_result
-    transit_state_impl(Event&& event, SourceState& source, TargetState& target,
+    transit_state_impl(Event&& event, SourceState& source,
             Guard guard, Action action, SourceExit exit,
             TargetEnter enter, SourceClear clear,
-            ::std::size_t target_index,
             def::tags::strong_exception_safety const&)
     {
-        SourceState source_backup{source};
-        TargetState target_backup{target};
-        try {
-            return transit_state_impl(
-                    ::std::forward<Event>(event), source, target,
-                     guard, action, exit, enter, clear,
-                     target_index,
-                     def::tags::basic_exception_safety{});
-        } catch (...) {
-            using ::std::swap;
-            swap(source, source_backup);
-            swap(target, target_backup);
-            throw;
+        // A guard cannot modify the states, so the backup is taken only
+        // when the guard passes
+        if (guard(*fsm_, source, event)) {
+            target_slot< TargetIndex > target{states_, *fsm_};
+            change_state_safe(::std::forward<Event>(event), source, target.get(),
+                    action, exit, enter, clear, TargetIndex);
+            target.commit();
+            return actions::event_process_result::process;
         }
+        return actions::event_process_result::refuse;
     }
-    template < typename SourceState, typename TargetState,
+    template < ::std::size_t TargetIndex, typename SourceState,
         typename Event, typename Guard, typename Action,
         typename SourceExit, typename TargetEnter, typename SourceClear >
     actions::event_process_result
-    transit_state_impl(Event&& event, SourceState& source, TargetState& target,
+    transit_state_impl(Event&& event, SourceState& source,
             Guard guard, Action action, SourceExit exit,
             TargetEnter enter, SourceClear clear,
-            ::std::size_t target_index,
             def::tags::nothrow_guarantee const&)
     {
-        SourceState source_backup{source};
-        TargetState target_backup{target};
         try {
-            return transit_state_impl(
-                    ::std::forward<Event>(event), source, target,
+            return transit_state_impl< TargetIndex >(
+                    ::std::forward<Event>(event), source,
                      guard, action, exit, enter, clear,
-                     target_index,
-                     def::tags::basic_exception_safety{});
+                     def::tags::strong_exception_safety{});
         } catch (...) {}
-        using ::std::swap;
-        swap(source, source_backup);
-        swap(target, target_backup);
         return actions::event_process_result::refuse;
     }
+    /**
+     * Exit source state, invoke transition action, enter target state.
+     * Observer notifications are not expected to throw.
+     */
+    template < typename SourceState, typename TargetState, typename Event,
+        typename Action, typename SourceExit, typename TargetEnter, typename SourceClear >
+    void
+    change_state(Event&& event, SourceState& source, TargetState& target,
+            Action action, SourceExit exit, TargetEnter enter, SourceClear clear,
+            ::std::size_t target_index)
+        noexcept(noexcept(exit(source, ::std::forward<Event>(event), ::std::declval<fsm_type&>())) &&
+                noexcept(action(::std::forward<Event>(event), ::std::declval<fsm_type&>(), source, target)) &&
+                noexcept(enter(target, ::std::forward<Event>(event), ::std::declval<fsm_type&>())) &&
+                noexcept(clear(::std::declval<fsm_type&>(), source)))
+    {
+        auto const& observer = root_machine(*fsm_);
+        exit(source, ::std::forward<Event>(event), *fsm_);
+        observer.state_exited(*fsm_, source, event);
+        action(::std::forward<Event>(event), *fsm_, source, target);
+        enter(target, ::std::forward<Event>(event), *fsm_);
+        observer.state_entered(*fsm_, target, event);
+        if (clear(*fsm_, source))
+            observer.state_cleared(*fsm_, source);
+        current_state_ = (index_value_type)target_index;
+        observer.state_changed(*fsm_, source, target, event);
+    }
+    /**
+     * Change state and roll back the source and target states if anything
+     * throws. No backup is made when the state change is noexcept.
+     */
+    template < typename SourceState, typename TargetState, typename Event,
+        typename Action, typename SourceExit, typename TargetEnter, typename SourceClear >
+    void
+    change_state_safe(Event&& event, SourceState& source, TargetState& target,
+            Action action, SourceExit exit, TargetEnter enter, SourceClear clear,
+            ::std::size_t target_index)
+    {
+        constexpr bool nothrow = noexcept(change_state(::std::forward<Event>(event),
+                source, target, action, exit, enter, clear, target_index));
+        detail::state_backup< SourceState, nothrow > source_backup{source};
+        detail::state_backup< TargetState, nothrow > target_backup{target};
+        try {
+            change_state(::std::forward<Event>(event), source, target,
+                    action, exit, enter, clear, target_index);
+        } catch (...) {
+            source_backup.restore(source);
+            target_backup.restore(target);
+            throw;
+        }
+    }
 
     event_set
     current_handled_events() const
     {
+        auto const& masks = get_state_masks_table(state_indexes{})[current_state_];
+        if (!masks.dynamic)
+            return masks.handled;
         auto const& table = get_current_events_table(state_indexes{});
         auto res = table[current_state_](states_);
-        auto const& available_transitions
-                            = get_available_transitions_table(state_indexes{});
-        auto const& trans = available_transitions[current_state_];
-        res.insert( trans.begin(), trans.end());
+        res |= masks.handled;
         return res;
     }
 
     event_set
     current_deferrable_events() const
     {
+        auto const& masks = get_state_masks_table(state_indexes{})[current_state_];
+        if (!masks.dynamic)
+            return masks.deferred;
         auto const& table = get_current_deferred_events_table(state_indexes{});
         return table[current_state_](states_);
     }
@@ -688,6 +1074,57 @@ public:
         return ct[current_state_]( states_ );
     }
 private:
+    void
+    set_states_fsm(fsm_type& fsm, ::std::false_type const&)
+    {
+        ::afsm::detail::set_enclosing_fsm< size - 1 >::set(fsm, states_);
+    }
+    void
+    set_states_fsm(fsm_type& fsm, ::std::true_type const&)
+    {
+        states_.set_fsm(fsm);
+    }
+    void
+    reset_states(::std::false_type const&)
+    {
+        reset_states(::std::make_index_sequence<size>{});
+    }
+    template < ::std::size_t ... Indexes >
+    void
+    reset_states(::std::index_sequence<Indexes...> const&)
+    {
+        using expand = int[];
+        (void)expand{ 0, (detail::state_frame_reset{}(
+                *fsm_, ::std::get<Indexes>(states_)), 0)... };
+    }
+    void
+    reset_states(::std::true_type const&)
+    {
+        states_.reset(*fsm_, detail::state_frame_reset{});
+    }
+    template < typename Event >
+    void
+    enter(Event&& event, ::std::false_type const&)
+    {
+        using initial_state_type = typename ::std::tuple_element<initial_state_index, inner_states_tuple>::type;
+        using initial_enter = detail::state_enter< fsm_type, initial_state_type, Event >;
+
+        auto& initial = ::std::get< initial_state_index >(states_);
+        initial_enter{}(initial, ::std::forward<Event>(event), *fsm_);
+    }
+    /**
+     * Only the current state is alive in the compact storage. It is the
+     * initial state unless the machine keeps history, then the state
+     * active when the machine was left is entered again.
+     */
+    template < typename Event >
+    void
+    enter(Event&& event, ::std::true_type const&)
+    {
+        auto const& table = enter_table<Event>( state_indexes{} );
+        table[current_state()](states_, ::std::forward<Event>(event), *fsm_);
+    }
+
     template < typename Event, ::std::size_t ... Indexes >
     static transition_table_type< Event > const&
     transition_table( ::psst::meta::indexes_tuple< Indexes... > const& )
@@ -695,14 +1132,16 @@ private:
         using event_type = typename ::std::decay<Event>::type;
         using event_transitions = typename ::psst::meta::find_if<
                 def::handles_event< event_type >::template type, transitions_tuple >::type;
-        static transition_table_type< Event > _table {{
-            typename detail::transition_action_selector< fsm_type, this_type,
-                typename ::psst::meta::find_if<
-                    def::originates_from<
-                        typename inner_states_def::template type< Indexes >
-                    >::template type,
-                    event_transitions
-                >::type >::type{} ...
+        static constexpr transition_table_type< Event > _table{{
+            &detail::transition_invocation_func<
+                typename detail::transition_action_selector< fsm_type, this_type,
+                    typename ::psst::meta::find_if<
+                        def::originates_from<
+                            typename inner_states_def::template type< Indexes >
+                        >::template type,
+                        event_transitions
+                    >::type >::type
+            >::template invoke< this_type, Event > ...
         }};
         return _table;
     }
@@ -710,8 +1149,19 @@ private:
     static exit_table_type<Event> const&
     exit_table( ::psst::meta::indexes_tuple< Indexes... > const& )
     {
-        static exit_table_type<Event> _table {{
-            detail::final_state_exit_func<Indexes>{} ...
+        static constexpr exit_table_type<Event> _table{{
+            &detail::final_state_exit_func<Indexes>::template invoke<
+                inner_states_tuple, Event, fsm_type > ...
+        }};
+        return _table;
+    }
+    template < typename Event, ::std::size_t ... Indexes >
+    static enter_table_type<Event> const&
+    enter_table( ::psst::meta::indexes_tuple< Indexes... > const& )
+    {
+        static constexpr enter_table_type<Event> _table{{
+            &detail::current_state_enter_func<Indexes>::template invoke<
+                inner_states_tuple, Event, fsm_type > ...
         }};
         return _table;
     }
@@ -719,8 +1169,9 @@ private:
     static current_events_table const&
     get_current_events_table( ::psst::meta::indexes_tuple< Indexes ... > const& )
     {
-        static current_events_table _table{{
-            detail::get_current_events_func<Indexes>{} ...
+        static constexpr current_events_table _table{{
+            &detail::get_current_events_func<Indexes>::template invoke<
+                event_set, inner_states_tuple > ...
         }};
 
         return _table;
@@ -729,28 +1180,41 @@ private:
     static current_events_table const&
     get_current_deferred_events_table( ::psst::meta::indexes_tuple< Indexes ... > const& )
     {
-        static current_events_table _table{{
-            detail::get_current_deferred_events_func<Indexes>{} ...
+        static constexpr current_events_table _table{{
+            &detail::get_current_deferred_events_func<Indexes>::template invoke<
+                event_set, inner_states_tuple > ...
         }};
 
         return _table;
     }
     template < ::std::size_t ... Indexes >
-    static available_transtions_table const&
-    get_available_transitions_table( ::psst::meta::indexes_tuple< Indexes ...> const& )
+    static state_masks_table const&
+    get_state_masks_table( ::psst::meta::indexes_tuple< Indexes ...> const& )
     {
-        static available_transtions_table _table{{
-            ::afsm::detail::make_event_set(
-                typename ::psst::meta::transform<
-                    def::detail::event_type,
-                    typename ::psst::meta::find_if<
-                        def::originates_from<
-                            typename inner_states_def::template type< Indexes >
-                        >:: template type,
-                        transitions_tuple
-                    >::type
-                 > ::type {}
-            ) ...
+        static constexpr state_masks_table _table{{
+            state_events_masks{
+                event_set::make(
+                    typename ::psst::meta::transform<
+                        def::detail::event_type,
+                        typename ::psst::meta::find_if<
+                            def::originates_from<
+                                typename inner_states_def::template type< Indexes >
+                            >:: template type,
+                            transitions_tuple
+                        >::type
+                     > ::type {}
+                ) | event_set::make(
+                    typename detail::static_state_events<
+                        typename ::std::tuple_element< Indexes, inner_states_tuple >::type
+                    >::handled_events{}),
+                event_set::make(
+                    typename detail::static_state_events<
+                        typename ::std::tuple_element< Indexes, inner_states_tuple >::type
+                    >::deferred_events{}),
+                detail::static_state_events<
+                    typename ::std::tuple_element< Indexes, inner_states_tuple >::type
+                >::is_dynamic
+            } ...
         }};
 
         return _table;
@@ -759,14 +1223,14 @@ private:
     static cast_table_type<T, StateTuple> const&
     get_cast_table( ::psst::meta::indexes_tuple< Indexes... > const& )
     {
-        static cast_table_type<T, StateTuple> _table {{
-            detail::common_base_cast_func<T, Indexes>{}...
+        static constexpr cast_table_type<T, StateTuple> _table{{
+            &detail::common_base_cast_func<T, Indexes>::template cast<StateTuple>...
         }};
         return _table;
     }
 private:
     fsm_type*           fsm_;
-    size_type           current_state_;
+    index_type          current_state_;
     inner_states_tuple  states_;
 };
 
@@ -779,22 +1243,29 @@ public:
     using fsm_type                      = typename state_table_type::fsm_type;
     using state_machine_definition_type = typename state_table_type::state_machine_definition_type;
     using size_type                     = typename state_table_type::size_type;
+    using index_type                    = typename state_table_type::index_type;
     using inner_states_tuple            = typename state_table_type::inner_states_tuple;
     using event_set                     = typename state_table_type::event_set;
 
-    using stack_constructor_type        = afsm::detail::stack_constructor<FSM, state_table_type>;
+    using allocator_type                = afsm::detail::machine_allocator_type<
+            FSM, state_machine_definition_type >;
+    /**
+     * Frames popped from the stack are reset in place when the
+     * transition that popped them completes and are reused, the depth
+     * can be limited with def::tags::pushdown_depth for inline storage.
+     */
+    using stack_type                    = afsm::detail::frame_stack< FSM, state_table_type,
+            def::traits::pushdown_depth< state_machine_definition_type >::value,
+            allocator_type >;
 public:
-    state_transition_stack(fsm_type& fsm)
-        : fsm_{&fsm},
-          state_stack_{ stack_constructor_type::construct(fsm) }
+    state_transition_stack(fsm_type& fsm, allocator_type const& alloc)
+        : state_stack_{ fsm, typename stack_type::allocator_type{ alloc } }
     {}
     state_transition_stack(fsm_type& fsm, state_transition_stack const& rhs)
-        : fsm_{&fsm},
-          state_stack_{ stack_constructor_type::copy_construct(fsm, rhs.state_stack_) }
+        : state_stack_{ fsm, rhs.state_stack_ }
     {}
     state_transition_stack(fsm_type& fsm, state_transition_stack&& rhs)
-        : fsm_{&fsm},
-          state_stack_{ stack_constructor_type::move_construct(fsm, ::std::move(rhs.state_stack_)) }
+        : state_stack_{ fsm, ::std::move(rhs.state_stack_) }
     {}
 
     state_transition_stack(state_transition_stack const&) = delete;
@@ -807,16 +1278,16 @@ public:
     void
     swap(state_transition_stack& rhs)
     {
-        using ::std::swap;
-        swap(state_stack_, rhs.state_stack_);
-        set_fsm(*fsm_);
-        rhs.set_fsm(*rhs.fsm_);
+        auto& fsm = state_stack_.fsm();
+        auto& rhs_fsm = rhs.state_stack_.fsm();
+        state_stack_.swap(rhs.state_stack_);
+        set_fsm(fsm);
+        rhs.set_fsm(rhs_fsm);
     }
 
     void
     set_fsm(fsm_type& fsm)
     {
-        fsm_ = &fsm;
         for (auto& item : state_stack_) {
             item.set_fsm(fsm);
         }
@@ -846,7 +1317,9 @@ public:
     actions::event_process_result
     process_event(Event&& event)
     {
-        return top().process_event(::std::forward<Event>(event));
+        auto res = top().process_event(::std::forward<Event>(event));
+        state_stack_.reset_popped();
+        return res;
     }
 
     template < typename Event >
@@ -866,7 +1339,7 @@ public:
     void
     push(Event&& event)
     {
-        state_stack_.emplace_back( *fsm_ );
+        state_stack_.push();
         enter(::std::forward<Event>(event));
     }
 
@@ -876,7 +1349,7 @@ public:
     {
         if (state_stack_.size() > 1) {
             exit(::std::forward<Event>(event));
-            state_stack_.pop_back();
+            state_stack_.pop();
         }
     }
 
@@ -910,16 +1383,13 @@ public:
         return top().template cast_current_state<T>();
     }
 private:
-    using stack_type = typename stack_constructor_type::type;
-
     state_table_type&
     top()
-    { return state_stack_.back(); }
+    { return state_stack_.top(); }
     state_table_type const&
     top() const
-    { return state_stack_.back(); }
+    { return state_stack_.top(); }
 private:
-    fsm_type*           fsm_;
     stack_type          state_stack_;
 };
 
@@ -938,8 +1408,9 @@ namespace detail {
 template < typename FSM, typename FSM_DEF, typename Size, bool HasPushdowns >
 struct transition_container {
     using transitions_tuple = typename transition_container_selector<FSM, FSM_DEF, Size, HasPushdowns>::type;
+    using allocator_type    = afsm::detail::machine_allocator_type<FSM, FSM_DEF>;
 
-    transition_container(FSM* fsm)
+    transition_container(FSM* fsm, allocator_type const&)
         : transitions_{*fsm}
     {}
     transition_container(FSM* fsm, transition_container const& rhs)
@@ -955,9 +1426,10 @@ protected:
 template < typename FSM, typename FSM_DEF, typename Size >
 struct transition_container< FSM, FSM_DEF, Size, true > {
     using transitions_tuple = typename transition_container_selector<FSM, FSM_DEF, Size, true>::type;
+    using allocator_type    = afsm::detail::machine_allocator_type<FSM, FSM_DEF>;
 
-    transition_container(FSM* fsm)
-        : transitions_{*fsm}
+    transition_container(FSM* fsm, allocator_type const& alloc)
+        : transitions_{*fsm, alloc}
     {}
     transition_container(FSM* fsm, transition_container const& rhs)
         : transitions_{*fsm, rhs.transitions_}
@@ -1002,8 +1474,10 @@ struct transition_container
     using base_type = detail::transition_container<FSM, FSM_DEF, Size,
                             def::has_pushdown_stack<FSM_DEF>::value>;
     using transitions_tuple = typename base_type::transitions_tuple;
+    using allocator_type    = typename base_type::allocator_type;
 
-    transition_container( FSM* fsm ) : base_type{fsm} {}
+    transition_container(FSM* fsm, allocator_type const& alloc)
+        : base_type{fsm, alloc} {}
     transition_container(FSM* fsm, transition_container const& rhs)
         : base_type{fsm, rhs} {}
     transition_container(FSM* fsm, transition_container&& rhs)
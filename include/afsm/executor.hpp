@@ -0,0 +1,293 @@
+/*
+ * executor.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_EXECUTOR_HPP_
+#define AFSM_EXECUTOR_HPP_
+
+#include <afsm/fsm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace afsm {
+
+/**
+ * Runs a large number of state machines on a fixed set of worker threads.
+ *
+ * Each machine has an id and is owned by the shard the id hashes to.
+ * Every shard has a worker thread and a lock-free mailbox, events are
+ * pushed to the mailbox and the worker drains it in batches, passing the
+ * events to the machines' process_event. A machine is only touched by
+ * its worker thread, so it doesn't need a mutex and producers never
+ * contend on machines, only on the mailbox push.
+ *
+ * Machines are created, fed with events and removed asynchronously, the
+ * operations for one machine are applied in the order they were posted
+ * from one thread. Events for an unknown id are dropped. An exception
+ * thrown while a worker handles an item, for instance by a machine's
+ * process_event, is caught and passed to the error handler along with
+ * the machine id, the worker goes on with the next item.
+ */
+template < typename FSM, typename Id = ::std::uint64_t,
+        typename Hash = ::std::hash<Id>,
+        ::std::size_t StorageSize = def::tags::default_event_storage_size >
+class executor {
+public:
+    using machine_type  = FSM;
+    using id_type       = Id;
+    using hash_type     = Hash;
+    using size_type     = ::std::size_t;
+    /**
+     * Called in a worker thread with the id of the machine that threw
+     * and the exception. Must not throw.
+     */
+    using error_handler = ::std::function< void(id_type const&, ::std::exception_ptr) >;
+
+    static constexpr size_type default_batch_size = 64;
+public:
+    /**
+     * Start the worker threads.
+     * @param workers       Number of shards, one worker thread per shard.
+     * @param batch_size    Max number of mailbox items handled between
+     *                      checks of the stop request.
+     * @param on_error      Handler of exceptions thrown by the machines,
+     *                      the exceptions are dropped if it is empty.
+     */
+    explicit
+    executor(size_type workers = default_workers(),
+            size_type batch_size = default_batch_size,
+            error_handler on_error = error_handler{})
+        : hash_{}, batch_size_{batch_size ? batch_size : 1},
+          on_error_{ ::std::move(on_error) }, shards_{}
+    {
+        if (!workers)
+            workers = 1;
+        shards_.reserve(workers);
+        for (size_type i = 0; i < workers; ++i)
+            shards_.emplace_back(new shard{});
+        for (auto& s : shards_)
+            s->worker = ::std::thread{ &executor::run, this, ::std::ref(*s) };
+    }
+    executor(executor const&) = delete;
+    executor&
+    operator = (executor const&) = delete;
+    ~executor()
+    {
+        stop();
+    }
+
+    size_type
+    workers() const noexcept
+    { return shards_.size(); }
+
+    /**
+     * Create a machine with the id. The machine is constructed in the
+     * calling thread and handed over to the worker. If a machine with
+     * the id exists it is left intact.
+     */
+    template < typename ... Args >
+    void
+    spawn(id_type const& id, Args&& ... args)
+    {
+        mail item{ mail_type::spawn, id };
+        item.machine.reset(new machine_type(::std::forward<Args>(args)...));
+        post_mail(::std::move(item));
+    }
+    /**
+     * Destroy the machine with the id.
+     */
+    void
+    remove(id_type const& id)
+    {
+        post_mail(mail{ mail_type::remove, id });
+    }
+    /**
+     * Send an event to the machine with the id.
+     */
+    template < typename Event >
+    void
+    post(id_type const& id, Event&& event)
+    {
+        using event_type = typename ::std::decay<Event>::type;
+        mail item{ mail_type::event, id };
+        item.event = event_item::template create< event_type, &executor::deliver<event_type> >(
+                ::std::forward<Event>(event), event_item::npos);
+        post_mail(::std::move(item));
+    }
+
+    /**
+     * Block until all posted items are handled. Must not be called from
+     * a worker thread.
+     */
+    void
+    wait_idle() const
+    {
+        for (auto const& s : shards_) {
+            while (s->pending.load(::std::memory_order_acquire))
+                ::std::this_thread::yield();
+        }
+    }
+    /**
+     * Handle the items already posted, destroy the machines and join the
+     * worker threads. Nothing can be posted after the call.
+     */
+    void
+    stop()
+    {
+        for (auto& s : shards_) {
+            {
+                ::std::lock_guard< ::std::mutex > lock{s->mutex};
+                s->stopping = true;
+            }
+            s->wake.notify_one();
+        }
+        for (auto& s : shards_) {
+            if (s->worker.joinable())
+                s->worker.join();
+        }
+    }
+
+    static size_type
+    default_workers() noexcept
+    {
+        auto n = ::std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+private:
+    using event_item    = detail::queued_event< machine_type, StorageSize >;
+    using machine_ptr   = ::std::unique_ptr< machine_type >;
+
+    enum class mail_type {
+        spawn,
+        event,
+        remove
+    };
+
+    struct mail {
+        mail() noexcept
+            : type{mail_type::event}, id{}, event{}, machine{} {}
+        mail(mail_type t, id_type const& i)
+            : type{t}, id{i}, event{}, machine{} {}
+
+        mail_type   type;
+        id_type     id;
+        event_item  event;
+        machine_ptr machine;
+    };
+
+    using machine_map   = ::std::unordered_map< id_type, machine_ptr, hash_type >;
+
+    struct shard {
+        detail::mpsc_queue<mail>    mailbox{};
+        ::std::atomic<size_type>    pending{0};
+        ::std::mutex                mutex{};
+        ::std::condition_variable   wake{};
+        bool                        stopping{false};
+        machine_map                 machines{};
+        ::std::thread               worker{};
+    };
+    using shard_ptr = ::std::unique_ptr<shard>;
+
+    template < typename Event >
+    static actions::event_process_result
+    deliver(machine_type& fsm, Event&& event)
+    {
+        return fsm.process_event(::std::forward<Event>(event));
+    }
+
+    shard&
+    shard_for(id_type const& id)
+    {
+        return *shards_[hash_(id) % shards_.size()];
+    }
+
+    void
+    post_mail(mail&& item)
+    {
+        shard& s = shard_for(item.id);
+        s.mailbox.push(::std::move(item));
+        if (s.pending.fetch_add(1, ::std::memory_order_acq_rel) == 0) {
+            ::std::lock_guard< ::std::mutex > lock{s.mutex};
+            s.wake.notify_one();
+        }
+    }
+
+    void
+    run(shard& s)
+    {
+        mail item;
+        while (true) {
+            size_type handled = 0;
+            while (handled < batch_size_ && s.mailbox.try_pop(item)) {
+                handle(s, item);
+                ++handled;
+            }
+            if (handled) {
+                s.pending.fetch_sub(handled, ::std::memory_order_acq_rel);
+                continue;
+            }
+            ::std::unique_lock< ::std::mutex > lock{s.mutex};
+            if (s.pending.load(::std::memory_order_acquire)) {
+                // A producer is in the middle of a push
+                lock.unlock();
+                ::std::this_thread::yield();
+                continue;
+            }
+            if (s.stopping)
+                break;
+            s.wake.wait(lock, [&s]{
+                return s.stopping || s.pending.load(::std::memory_order_acquire);
+            });
+        }
+        s.machines.clear();
+    }
+
+    void
+    handle(shard& s, mail& item)
+    {
+        try {
+            switch (item.type) {
+                case mail_type::spawn:
+                    s.machines.emplace(item.id, ::std::move(item.machine));
+                    break;
+                case mail_type::event: {
+                    auto f = s.machines.find(item.id);
+                    if (f != s.machines.end())
+                        item.event(*f->second);
+                    break;
+                }
+                case mail_type::remove:
+                    s.machines.erase(item.id);
+                    break;
+            }
+        } catch (...) {
+            if (on_error_)
+                on_error_(item.id, ::std::current_exception());
+        }
+        item.event.reset();
+        item.machine.reset();
+    }
+private:
+    hash_type                   hash_;
+    size_type                   batch_size_;
+    error_handler               on_error_;
+    ::std::vector< shard_ptr >  shards_;
+};
+
+template < typename FSM, typename Id, typename Hash, ::std::size_t StorageSize >
+constexpr ::std::size_t executor<FSM, Id, Hash, StorageSize>::default_batch_size;
+
+}  /* namespace afsm */
+
+#endif /* AFSM_EXECUTOR_HPP_ */
@@ -0,0 +1,323 @@
+/*
+ * fleet.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#ifndef AFSM_FLEET_HPP_
+#define AFSM_FLEET_HPP_
+
+#include <afsm/fsm.hpp>
+#include <array>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace afsm {
+
+namespace detail {
+
+/**
+ * A refused event has no side effects in the machine: there is no
+ * observer to notify and the definition doesn't handle rejects.
+ */
+template < typename FSM, typename Event >
+struct silent_refuse : ::std::integral_constant< bool,
+        ::std::is_base_of< null_observer, FSM >::value &&
+        !actions::detail::handles_reject<
+            typename FSM::state_machine_definition_type, Event >::value > {};
+
+}  /* namespace detail */
+
+/**
+ * A large number of instances of a flat state machine.
+ *
+ * The current state indices of the instances are kept in a contiguous
+ * column next to the machines. An event broadcast to the fleet visits
+ * the instances grouped by the current state, so consecutive dispatches
+ * go through the same transition function, and the groups of states
+ * that would refuse the event without side effects are skipped after
+ * checking a single instance.
+ *
+ * Each instance is a complete machine and an event is passed to its
+ * process_event, so the semantics of actions, guards, deferred and
+ * queued events are the same as for a standalone machine. Only flat
+ * machines are accepted, the events handled by a flat machine depend on
+ * its current state only.
+ *
+ * This is not a structure-of-arrays layout: the state objects stay in
+ * their machines, the state column mirrors the machines' current state
+ * indices so that grouping doesn't touch the machines.
+ *
+ * The machines are only modified via the fleet, the fleet is not
+ * thread safe and an action of an instance must not dispatch events to
+ * the fleet it belongs to.
+ */
+template < typename FSM >
+class fleet {
+public:
+    using machine_type      = FSM;
+    using definition_type   = typename machine_type::state_machine_definition_type;
+    static_assert(!def::traits::has_orthogonal_regions< definition_type >::value,
+            "Fleet instances cannot have orthogonal regions");
+    static_assert(!machine_type::has_pushdowns::value,
+            "Fleet instances cannot have pushdown states");
+    static_assert(::psst::meta::is_empty< typename ::psst::meta::find_if<
+                def::traits::is_state_machine,
+                typename machine_type::inner_states_def >::type >::value,
+            "Fleet instances must be flat state machines");
+
+    using size_type         = ::std::size_t;
+    using allocator_type    = typename machine_type::allocator_type;
+    using index_value_type  = typename machine_type::transition_tuple::index_value_type;
+    using event_set         = typename machine_type::event_set;
+    static constexpr size_type state_count = machine_type::inner_state_count;
+private:
+    using machine_allocator = detail::rebind_alloc< allocator_type, machine_type >;
+    using index_allocator   = detail::rebind_alloc< allocator_type, index_value_type >;
+    using size_allocator    = detail::rebind_alloc< allocator_type, size_type >;
+    using machine_storage   = ::std::deque< machine_type, machine_allocator >;
+    using index_column      = ::std::vector< index_value_type, index_allocator >;
+    using instance_list     = ::std::vector< size_type, size_allocator >;
+    using state_offsets     = ::std::array< size_type, state_count + 1 >;
+public:
+    fleet()
+        : fleet{ allocator_type{} } {}
+    /**
+     * The allocator is passed to the machines and is used for the
+     * fleet's own storage.
+     */
+    explicit
+    fleet(allocator_type const& alloc)
+        : alloc_{alloc},
+          machines_{ machine_allocator{alloc} },
+          states_{ index_allocator{alloc} },
+          order_{ size_allocator{alloc} },
+          subset_{ size_allocator{alloc} }
+    {}
+    fleet(fleet const&) = delete;
+    fleet&
+    operator = (fleet const&) = delete;
+
+    allocator_type
+    get_allocator() const noexcept
+    { return alloc_; }
+
+    size_type
+    size() const noexcept
+    { return machines_.size(); }
+    bool
+    empty() const noexcept
+    { return machines_.empty(); }
+
+    void
+    reserve(size_type n)
+    {
+        states_.reserve(n);
+        order_.reserve(n);
+    }
+    void
+    clear() noexcept
+    {
+        machines_.clear();
+        states_.clear();
+        order_.clear();
+        subset_.clear();
+    }
+
+    /**
+     * Add an instance, the arguments are passed to the state machine
+     * definition constructor.
+     * @return Index of the instance in the fleet
+     */
+    template < typename ... Args >
+    size_type
+    emplace_back(Args&& ... args)
+    {
+        machines_.emplace_back(::std::allocator_arg, alloc_, ::std::forward<Args>(args)...);
+        try {
+            states_.push_back( static_cast<index_value_type>(machines_.back().current_state()) );
+        } catch (...) {
+            machines_.pop_back();
+            throw;
+        }
+        return machines_.size() - 1;
+    }
+
+    machine_type const&
+    operator[](size_type n) const
+    { return machines_[n]; }
+    machine_type const&
+    at(size_type n) const
+    { return machines_.at(n); }
+
+    /**
+     * Index of the current state of an instance
+     */
+    size_type
+    current_state(size_type n) const
+    { return states_[n]; }
+    /**
+     * Contiguous column of the current state indices of all instances
+     */
+    index_value_type const*
+    current_states() const noexcept
+    { return states_.data(); }
+
+    /**
+     * Number of instances in the immediate inner state
+     */
+    template < typename StateDef >
+    size_type
+    count_in_state() const
+    {
+        using index_of_state = ::psst::meta::index_of<
+                StateDef, typename machine_type::inner_states_def >;
+        static_assert(index_of_state::found,
+                "Type is not a definition of inner state");
+        size_type res = 0;
+        for (auto s : states_)
+            res += (static_cast<size_type>(s) == index_of_state::value);
+        return res;
+    }
+
+    /**
+     * Process an event in a single instance.
+     */
+    template < typename Event >
+    actions::event_process_result
+    process_event(size_type n, Event&& event)
+    {
+        return dispatch(n, ::std::forward<Event>(event));
+    }
+
+    /**
+     * Process an event in every instance of the fleet. The instances are
+     * visited grouped by their current state, in the order of the state
+     * index, and in the order of addition inside of a group. An exception
+     * thrown by an instance stops the broadcast.
+     * @return Number of instances that didn't refuse the event
+     */
+    template < typename Event >
+    size_type
+    broadcast(Event const& event)
+    {
+        state_offsets offsets;
+        offsets.fill(0);
+        for (auto s : states_)
+            ++offsets[s + 1];
+        make_offsets(offsets);
+        order_.resize(states_.size());
+        for (size_type n = 0; n < states_.size(); ++n)
+            order_[offsets[states_[n]]++] = n;
+        return dispatch_groups(event, offsets);
+    }
+    /**
+     * Process an event in a subset of the fleet, the iterators yield
+     * valid instance indices. The instances are grouped by the state they are
+     * in before the broadcast, an index repeated in the range receives
+     * the event once for each occurrence.
+     * @return Number of dispatches that didn't refuse the event
+     */
+    template < typename InputIterator, typename Event,
+        typename = typename ::std::iterator_traits<InputIterator>::iterator_category >
+    size_type
+    broadcast(InputIterator first, InputIterator last, Event const& event)
+    {
+        state_offsets offsets;
+        offsets.fill(0);
+        subset_.assign(first, last);
+        for (auto n : subset_)
+            ++offsets[states_[n] + 1];
+        make_offsets(offsets);
+        order_.resize(subset_.size());
+        for (auto n : subset_)
+            order_[offsets[states_[n]]++] = n;
+        return dispatch_groups(event, offsets);
+    }
+private:
+    /**
+     * Turn the instance counts shifted by one state into the beginnings
+     * of the state groups in the order_ column. After the column is
+     * filled an offset is the end of the group.
+     */
+    static void
+    make_offsets(state_offsets& offsets)
+    {
+        for (size_type s = 1; s < state_count; ++s)
+            offsets[s] += offsets[s - 1];
+    }
+
+    template < typename Event >
+    size_type
+    dispatch_groups(Event const& event, state_offsets const& ends)
+    {
+        using event_type = typename ::std::decay<Event>::type;
+        size_type res = 0;
+        size_type begin = 0;
+        for (size_type s = 0; s < state_count; ++s) {
+            auto const end = ends[s];
+            if (begin == end)
+                continue;
+            if (!skip_group<event_type>(order_[begin],
+                    detail::silent_refuse<machine_type, event_type>{})) {
+                for (auto i = begin; i < end; ++i) {
+                    if (dispatch(order_[i], event) != actions::event_process_result::refuse)
+                        ++res;
+                }
+            }
+            begin = end;
+        }
+        return res;
+    }
+
+    /**
+     * All instances of a group are in the same state, the first one
+     * tells if the event would be refused by the whole group.
+     */
+    template < typename Event >
+    bool
+    skip_group(size_type n, ::std::true_type const&) const
+    {
+        auto const idx = event_set::template index<Event>();
+        auto const& machine = machines_[n];
+        return !machine.current_handled_events().test(idx) &&
+                !machine.current_deferrable_events().test(idx);
+    }
+    template < typename Event >
+    constexpr bool
+    skip_group(size_type, ::std::false_type const&) const
+    {
+        return false;
+    }
+
+    template < typename Event >
+    actions::event_process_result
+    dispatch(size_type n, Event&& event)
+    {
+        auto& machine = machines_[n];
+        try {
+            auto res = machine.process_event(::std::forward<Event>(event));
+            states_[n] = static_cast<index_value_type>(machine.current_state());
+            return res;
+        } catch (...) {
+            states_[n] = static_cast<index_value_type>(machine.current_state());
+            throw;
+        }
+    }
+private:
+    allocator_type      alloc_;
+    machine_storage     machines_;
+    index_column        states_;
+    instance_list       order_;
+    instance_list       subset_;
+};
+
+template < typename FSM >
+constexpr ::std::size_t fleet<FSM>::state_count;
+
+}  /* namespace afsm */
+
+#endif /* AFSM_FLEET_HPP_ */
@@ -12,9 +12,13 @@
 #include <afsm/detail/observer.hpp>
 #include <afsm/detail/reject_policies.hpp>
 #include <afsm/detail/event_identity.hpp>
+#include <afsm/detail/event_queue.hpp>
+#include <array>
 #include <deque>
-#include <queue>
-#include <list>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <thread>
 
 namespace afsm {
 
@@ -22,20 +26,27 @@ namespace afsm {
 //  State
 //----------------------------------------------------------------------------
 template < typename T, typename FSM >
-class state : public detail::state_base< T > {
+class state : public detail::enclosing_fsm_holder< FSM,
+                def::traits::has_enclosing_fsm_pointer<T>::value >,
+        public detail::state_base< T > {
 public:
     using enclosing_fsm_type    = FSM;
+    using event_set             = typename detail::machine_event_set<FSM, T>::type;
+    using fsm_holder_type       = detail::enclosing_fsm_holder< FSM,
+                def::traits::has_enclosing_fsm_pointer<T>::value >;
 public:
     state(enclosing_fsm_type& fsm)
-        : state::state_type{}, fsm_{&fsm}
+        : fsm_holder_type{fsm}, state::state_type{}
     {}
     state(state const& rhs) = default;
     state(state&& rhs) = default;
     state(enclosing_fsm_type& fsm, state const& rhs)
-        : state::state_type{static_cast<typename state::state_type const&>(rhs)}, fsm_{&fsm}
+        : fsm_holder_type{fsm},
+          state::state_type{static_cast<typename state::state_type const&>(rhs)}
     {}
     state(enclosing_fsm_type& fsm, state&& rhs)
-        : state::state_type{static_cast<typename state::state_type&&>(rhs)}, fsm_{&fsm}
+        : fsm_holder_type{fsm},
+          state::state_type{static_cast<typename state::state_type&&>(rhs)}
     {}
 
     state&
@@ -57,24 +68,30 @@ public:
         static_cast<typename state::state_type&>(*this).swap(rhs);
     }
 
-    enclosing_fsm_type&
-    enclosing_fsm()
-    { return *fsm_; }
-    enclosing_fsm_type const&
-    enclosing_fsm() const
-    { return *fsm_; }
-    void
-    enclosing_fsm(enclosing_fsm_type& fsm)
-    { fsm_ = &fsm; }
+    using fsm_holder_type::enclosing_fsm;
+
+    event_set const&
+    current_handled_events() const
+    { return static_handled_events(); }
+    event_set const&
+    current_deferrable_events() const
+    { return static_deferrable_events(); }
+
+    static event_set const&
+    static_handled_events()
+    { return detail::event_mask<event_set, typename state::handled_events>::value; }
+    static event_set const&
+    static_deferrable_events()
+    { return detail::event_mask<event_set, typename state::deferred_events>::value; }
 protected: // For tests
     template < ::std::size_t StateIndex >
     friend struct actions::detail::process_event_handler;
 
     template < typename Event >
     actions::event_process_result
-    process_event( Event&& evt )
+    process_event( enclosing_fsm_type& fsm, Event&& evt )
     {
-        return process_event_impl(::std::forward<Event>(evt),
+        return process_event_impl(fsm, ::std::forward<Event>(evt),
                 detail::event_process_selector<
                     Event,
                     typename state::internal_events,
@@ -83,27 +100,25 @@ protected: // For tests
 private:
     template < typename Event >
     actions::event_process_result
-    process_event_impl(Event&& evt,
+    process_event_impl(enclosing_fsm_type& fsm, Event&& evt,
         detail::process_type<actions::event_process_result::process> const&)
     {
-        return actions::handle_in_state_event(::std::forward<Event>(evt), *fsm_, *this);
+        return actions::handle_in_state_event(::std::forward<Event>(evt), fsm, *this);
     }
     template < typename Event >
     constexpr actions::event_process_result
-    process_event_impl(Event&&,
+    process_event_impl(enclosing_fsm_type&, Event&&,
         detail::process_type<actions::event_process_result::defer> const&) const
     {
         return actions::event_process_result::defer;
     }
     template < typename Event >
     constexpr actions::event_process_result
-    process_event_impl(Event&&,
+    process_event_impl(enclosing_fsm_type&, Event&&,
         detail::process_type<actions::event_process_result::refuse> const&) const
     {
         return actions::event_process_result::refuse;
     }
-private:
-    enclosing_fsm_type*    fsm_;
 };
 
 //----------------------------------------------------------------------------
@@ -117,19 +132,25 @@ public:
     using base_machine_type     = detail::state_machine_base< T, none, this_type >;
 public:
     inner_state_machine(enclosing_fsm_type& fsm)
-        : base_machine_type{this}, fsm_{&fsm} {}
+        : base_machine_type{this, ::std::allocator_arg,
+                detail::enclosing_allocator<
+                    typename base_machine_type::allocator_type >(fsm) },
+          fsm_{&fsm} {}
     inner_state_machine(inner_state_machine const& rhs)
-        : base_machine_type{this, rhs}, fsm_{rhs.fsm_} {}
+        : base_machine_type{this, static_cast<base_machine_type const&>(rhs)},
+          fsm_{rhs.fsm_} {}
     inner_state_machine(inner_state_machine&& rhs)
-        : base_machine_type{this, ::std::move(rhs)},
+        : base_machine_type{this, static_cast<base_machine_type&&>(rhs)},
           fsm_{rhs.fsm_}
     {
     }
 
     inner_state_machine(enclosing_fsm_type& fsm, inner_state_machine const& rhs)
-        : base_machine_type{static_cast<base_machine_type const&>(rhs)}, fsm_{&fsm} {}
+        : base_machine_type{this, static_cast<base_machine_type const&>(rhs)},
+          fsm_{&fsm} {}
     inner_state_machine(enclosing_fsm_type& fsm, inner_state_machine&& rhs)
-        : base_machine_type{static_cast<base_machine_type&&>(rhs)}, fsm_{&fsm} {}
+        : base_machine_type{this, static_cast<base_machine_type&&>(rhs)},
+          fsm_{&fsm} {}
 
     void
     swap(inner_state_machine& rhs) noexcept
@@ -167,9 +188,9 @@ protected: // For tests
 
     template < typename Event >
     actions::event_process_result
-    process_event( Event&& event )
+    process_event( enclosing_fsm_type& fsm, Event&& event )
     {
-        return process_event_impl(*fsm_, ::std::forward<Event>(event),
+        return process_event_impl(fsm, ::std::forward<Event>(event),
                 detail::event_process_selector<
                     Event,
                     typename inner_state_machine::handled_events,
@@ -198,73 +219,207 @@ public:
     using mutex_type        = Mutex;
     using lock_guard        = typename detail::lock_guard_type<mutex_type>::type;
     using observer_wrapper  = ObserverWrapper<Observer>;
-    using event_invokation  = ::std::function< actions::event_process_result() >;
-    using event_queue_item  = ::std::pair< event_invokation, detail::event_base::id_type const* >;
-    using event_queue       = ::std::deque< event_queue_item >;
-    using deferred_queue    = ::std::list< event_queue_item >;
+    using event_set         = typename base_machine_type::event_set;
+    using event_queue_item  = detail::queued_event< this_type,
+                                    def::traits::event_storage_size<T>::value >;
+    using queue_policy      = typename def::traits::event_queue_policy<T>::type;
+    using overflow_policy   = typename def::traits::event_queue_capacity<T>::overflow_policy;
+    static constexpr ::std::size_t queue_capacity = def::traits::event_queue_capacity<T>::value;
+    using allocator_type    = typename def::traits::allocator_type<T>::type;
+    using item_allocator    = detail::rebind_alloc< allocator_type, event_queue_item >;
+    using event_queue       = typename ::std::conditional<
+                ::std::is_same< queue_policy, def::tags::lock_free_event_queue >::value,
+                typename ::std::conditional< queue_capacity == 0,
+                    detail::mpsc_queue< event_queue_item, item_allocator >,
+                    detail::bounded_mpsc_queue< event_queue_item, queue_capacity, item_allocator >
+                >::type,
+                detail::ring_buffer< event_queue_item, item_allocator >
+            >::type;
+    using swap_queue        = detail::ring_buffer< event_queue_item, item_allocator >;
+    using deferred_queue    = detail::deferred_event_buckets<
+                                    event_queue_item, event_set,
+                                    typename def::detail::recursive_deferred_events<T>::type,
+                                    item_allocator >;
+
+    static_assert(!::std::is_same< queue_policy, def::tags::lock_free_event_queue >::value
+            || !::std::is_same< overflow_policy, def::tags::drop_oldest_on_full_queue >::value,
+            "Lock-free event queue cannot drop the oldest event");
+    static_assert(!::std::is_same< queue_policy, def::tags::lock_free_event_queue >::value
+            || (queue_capacity & (queue_capacity - 1)) == 0,
+            "Lock-free event queue capacity must be a power of two");
 public:
     state_machine()
-        : base_machine_type{this},
-          is_top_{},
-          handled_{ base_machine_type::current_handled_events() },
-          deferred_{ base_machine_type::current_deferrable_events() },
-          mutex_{},
-          queued_events_{},
-          queue_size_{0},
-          deferred_top_{},
-          deferred_events_{},
-          deferred_event_ids_{}
-      {}
-    template<typename ... Args>
+        : state_machine{ ::std::allocator_arg, allocator_type{} } {}
+    template<typename ... Args, typename = typename ::std::enable_if<
+            !detail::starts_with_allocator_arg<Args...>::value >::type>
     explicit
     state_machine(Args&& ... args)
-        : base_machine_type(this, ::std::forward<Args>(args)...),
+        : state_machine{ ::std::allocator_arg, allocator_type{},
+                ::std::forward<Args>(args)... } {}
+    /**
+     * Construct the state machine with an allocator for the event queues,
+     * the deferred events and the pushdown stacks, the rest of arguments
+     * are passed to the state machine definition constructor.
+     */
+    template<typename ... Args>
+    state_machine(::std::allocator_arg_t, allocator_type const& alloc, Args&& ... args)
+        : base_machine_type(this, ::std::allocator_arg, alloc, ::std::forward<Args>(args)...),
           is_top_{},
           handled_{ base_machine_type::current_handled_events() },
           deferred_{ base_machine_type::current_deferrable_events() },
           mutex_{},
-          queued_events_{},
+          queued_events_{ item_allocator{alloc} },
+          processing_{ item_allocator{alloc} },
           queue_size_{0},
           deferred_top_{},
-          deferred_events_{},
-          deferred_event_ids_{}
-    {}
+          deferred_events_{ item_allocator{alloc} }
+    {
+        reserve_queue(queued_events_);
+        reserve_queue(processing_);
+    }
+    /**
+     * Handlers of events still waiting in the queue are called with
+     * event_process_result::overflow.
+     */
+    ~state_machine()
+    {
+        discard_queued_events(queued_events_);
+        discard_queued_events(processing_);
+    }
 
     template < typename Event >
     actions::event_process_result
     process_event( Event&& event )
     {
         if (!queue_size_ && !is_top_.test_and_set()) {
-            auto res = process_event_dispatch(::std::forward<Event>(event));
-            is_top_.clear();
+            auto res = process_top_event(::std::forward<Event>(event));
             // Process enqueued events
             process_event_queue();
             return res;
         } else {
             // Enqueue event
-            enqueue_event(::std::forward<Event>(event));
-            return actions::event_process_result::defer;
+            return enqueue_event(::std::forward<Event>(event));
         }
     }
 
-    detail::event_set const&
+    /**
+     * Process an event and pass the result to the handler. If the machine
+     * is busy the handler is stored with the queued event and called
+     * when the event is dispatched, in the thread that dispatches it.
+     * An event deferred by the current state completes with
+     * event_process_result::defer. The handler is not called if
+     * processing the event throws. A handler of an event dropped from a
+     * full queue or still queued when the machine is destroyed is called
+     * with event_process_result::overflow.
+     * @param handler   Callable with signature void(event_process_result)
+     */
+    template < typename Event, typename Handler >
+    void
+    process_event( Event&& event, Handler&& handler )
+    {
+        using event_type = typename ::std::decay<Event>::type;
+        using handler_type = typename ::std::decay<Handler>::type;
+        if (!queue_size_ && !is_top_.test_and_set()) {
+            auto res = process_top_event(::std::forward<Event>(event));
+            // The event is complete before the events it has enqueued
+            handler(res);
+            process_event_queue();
+        } else {
+            // The handler of an event rejected by a full queue is called
+            // by the queue
+            enqueue_event(detail::completion_event<event_type, handler_type>{
+                    ::std::forward<Event>(event), ::std::forward<Handler>(handler) });
+        }
+    }
+    /**
+     * Process an event, the future is ready when the event is dispatched.
+     */
+    template < typename Event >
+    ::std::future< actions::event_process_result >
+    process_event_async( Event&& event )
+    {
+        auto promise = ::std::make_shared< ::std::promise< actions::event_process_result > >();
+        auto res = promise->get_future();
+        process_event(::std::forward<Event>(event),
+            [promise](actions::event_process_result r)
+            {
+                promise->set_value(r);
+            });
+        return res;
+    }
+
+    /**
+     * Process a range of events as a batch. The run-to-completion flag
+     * is taken once for the whole batch, if the machine is busy the
+     * events are enqueued one by one.
+     * @param out   Output iterator receiving the result for each event
+     * @return      Output iterator past the last result written
+     */
+    template < typename InputIterator, typename OutputIterator,
+        typename = typename ::std::iterator_traits<InputIterator>::iterator_category >
+    OutputIterator
+    process_events( InputIterator first, InputIterator last, OutputIterator out )
+    {
+        if (!queue_size_ && !is_top_.test_and_set()) {
+            {
+                detail::flag_guard top{is_top_};
+                for (; first != last; ++first)
+                    *out++ = process_batch_event(*first);
+            }
+            process_event_queue();
+        } else {
+            for (; first != last; ++first)
+                *out++ = process_event(*first);
+        }
+        return out;
+    }
+    /**
+     * Process events of different types as a batch, in the order of
+     * arguments.
+     * @return Results for each event
+     */
+    template < typename ... Events >
+    ::std::array< actions::event_process_result, sizeof ... (Events) >
+    process_events( Events&& ... events )
+    {
+        if (!queue_size_ && !is_top_.test_and_set()) {
+            ::std::array< actions::event_process_result, sizeof ... (Events) > res{};
+            {
+                detail::flag_guard top{is_top_};
+                // Braced initializers are evaluated left to right
+                res = {{ process_batch_event(::std::forward<Events>(events)) ... }};
+            }
+            process_event_queue();
+            return res;
+        }
+        return {{ process_event(::std::forward<Events>(events)) ... }};
+    }
+
+    event_set const&
     current_handled_events() const
     { return handled_; }
-    detail::event_set const&
+    event_set const&
     current_deferrable_events() const
     { return deferred_; }
-    detail::event_set const&
+    event_set const&
     current_deferred_events() const
-    { return deferred_event_ids_; }
+    { return deferred_events_.event_ids(); }
 
     void
     clear_deferred_events()
     {
         lock_guard lock{mutex_};
-        deferred_queue{}.swap(deferred_events_);
-        detail::event_set{}.swap(deferred_event_ids_);
+        deferred_events_.clear();
     }
 private:
+    template < typename Event >
+    actions::event_process_result
+    process_top_event( Event&& event )
+    {
+        detail::flag_guard top{is_top_};
+        return process_event_dispatch(::std::forward<Event>(event));
+    }
+
     template < typename Event >
     actions::event_process_result
     process_event_dispatch( Event&& event )
@@ -337,29 +492,211 @@ private:
     }
 
     template < typename Event >
-    void
+    actions::event_process_result
     enqueue_event(Event&& event)
     {
-        using evt_identity = typename detail::event_identity<Event>::type;
-        {
-            lock_guard lock{mutex_};
-            ++queue_size_;
-            observer_wrapper::enqueue_event(*this, ::std::forward<Event>(event));
-            Event evt{::std::forward<Event>(event)};
-            queued_events_.emplace_back([&, evt]() mutable {
-                return process_event_dispatch(::std::move(evt));
-            }, &evt_identity::id);
-        }
+        auto res = enqueue_event(::std::forward<Event>(event), queue_policy{});
         // Process enqueued events in case we've been waiting for queue
         // mutex release
         process_event_queue();
+        return res;
     }
 
+    template < typename Event >
+    actions::event_process_result
+    enqueue_event(Event&& event, def::tags::mutex_event_queue const&)
+    {
+        using detail::queue_overflow_action;
+        auto res = actions::event_process_result::defer;
+        event_queue_item dropped;
+        while (true) {
+            {
+                lock_guard lock{mutex_};
+                auto action = queue_full() ?
+                        on_queue_overflow(queued_events_, dropped, overflow_policy{}) :
+                        queue_overflow_action::push;
+                if (action == queue_overflow_action::push) {
+                    ++queue_size_;
+                    observer_wrapper::enqueue_event(*this, detail::observed_event(event));
+                    queued_events_.push_back(make_queue_item(::std::forward<Event>(event)));
+                    break;
+                }
+                if (action == queue_overflow_action::discard) {
+                    res = actions::event_process_result::overflow;
+                    break;
+                }
+            }
+            // Wait for the queue to drain, or drain it if nobody does
+            process_event_queue();
+            ::std::this_thread::yield();
+        }
+        // The handlers of dropped and rejected events are called without
+        // holding the mutex
+        dropped.discard(actions::event_process_result::overflow);
+        if (res == actions::event_process_result::overflow)
+            detail::discard_event(event, res);
+        return res;
+    }
+
+    template < typename Event >
+    actions::event_process_result
+    enqueue_event(Event&& event, def::tags::lock_free_event_queue const&)
+    {
+        // Count the event before publishing it, so that process_event
+        // doesn't overtake it
+        ++queue_size_;
+        observer_wrapper::enqueue_event(*this, detail::observed_event(event));
+        return push_queue_item(queued_events_, make_queue_item(::std::forward<Event>(event)));
+    }
+
+    template < typename Item >
+    actions::event_process_result
+    push_queue_item(detail::mpsc_queue<Item, item_allocator>& queue, event_queue_item&& item)
+    {
+        queue.push(::std::move(item));
+        return actions::event_process_result::defer;
+    }
+
+    template < typename Item, ::std::size_t Capacity >
+    actions::event_process_result
+    push_queue_item(detail::bounded_mpsc_queue<Item, Capacity, item_allocator>& queue,
+            event_queue_item&& item)
+    {
+        using detail::queue_overflow_action;
+        // The lock-free queue never drops a queued event
+        event_queue_item dropped;
+        while (!queue.try_push(item)) {
+            // Uncount the event while waiting, the queue is drained only
+            // when all counted events are published
+            --queue_size_;
+            if (on_queue_overflow(queue, dropped, overflow_policy{}) == queue_overflow_action::discard) {
+                item.discard(actions::event_process_result::overflow);
+                return actions::event_process_result::overflow;
+            }
+            process_event_queue();
+            ::std::this_thread::yield();
+            ++queue_size_;
+        }
+        return actions::event_process_result::defer;
+    }
+
+    bool
+    queue_full() const
+    {
+        return queue_capacity > 0 && queue_size_ >= queue_capacity;
+    }
+
+    //@{
+    /** @name Queue overflow policies, called when the queue is full */
+    template < typename Queue >
+    detail::queue_overflow_action
+    on_queue_overflow(Queue&, event_queue_item&, def::tags::block_on_full_queue const&)
+    {
+        return detail::queue_overflow_action::wait;
+    }
+    template < typename Queue >
+    detail::queue_overflow_action
+    on_queue_overflow(Queue&, event_queue_item&, def::tags::reject_on_full_queue const&)
+    {
+        return detail::queue_overflow_action::discard;
+    }
+    template < typename Queue >
+    detail::queue_overflow_action
+    on_queue_overflow(Queue&, event_queue_item&, def::tags::drop_newest_on_full_queue const&)
+    {
+        observer_wrapper::drop_queued_event(*this);
+        return detail::queue_overflow_action::discard;
+    }
+    /**
+     * The oldest event is moved to dropped, the caller discards it after
+     * releasing the queue mutex.
+     */
+    template < typename Queue >
+    detail::queue_overflow_action
+    on_queue_overflow(Queue& queue, event_queue_item& dropped,
+            def::tags::drop_oldest_on_full_queue const&)
+    {
+        dropped = ::std::move(queue.front());
+        queue.pop_front();
+        --queue_size_;
+        observer_wrapper::drop_queued_event(*this);
+        return detail::queue_overflow_action::push;
+    }
+    //@}
+
+    template < typename Item >
+    static void
+    discard_queued_events(detail::ring_buffer<Item, item_allocator>& queue)
+    {
+        while (!queue.empty()) {
+            queue.front().discard(actions::event_process_result::overflow);
+            queue.pop_front();
+        }
+    }
+    template < typename Queue >
+    static void
+    discard_queued_events(Queue& queue)
+    {
+        event_queue_item event;
+        while (queue.try_pop(event))
+            event.discard(actions::event_process_result::overflow);
+    }
+
+    template < typename Item >
+    static void
+    reserve_queue(detail::ring_buffer<Item, item_allocator>& queue)
+    {
+        if (queue_capacity > 0)
+            queue.reserve(queue_capacity);
+    }
+    template < typename Queue >
+    static void
+    reserve_queue(Queue&)
+    {}
+
+    template < typename Event >
+    static event_queue_item
+    make_queue_item(Event&& event)
+    {
+        using event_type = typename ::std::decay<Event>::type;
+        return event_queue_item::template create<
+                    event_type, &state_machine::dispatch_queued_event<event_type> >(
+                ::std::forward<Event>(event), event_set::template index<event_type>());
+    }
+
+    template < typename Event >
+    static actions::event_process_result
+    dispatch_queued_event(state_machine& fsm, Event&& event)
+    {
+        return fsm.process_event_dispatch(::std::forward<Event>(event));
+    }
+
+    template < typename Event, typename Handler >
+    static event_queue_item
+    make_queue_item(detail::completion_event<Event, Handler>&& event)
+    {
+        using event_type = detail::completion_event<Event, Handler>;
+        return event_queue_item::template create<
+                    event_type, &state_machine::dispatch_completion_event<Event, Handler> >(
+                ::std::move(event), event_set::template index<Event>());
+    }
+
+    template < typename Event, typename Handler >
+    static actions::event_process_result
+    dispatch_completion_event(state_machine& fsm,
+            detail::completion_event<Event, Handler>&& event)
+    {
+        auto res = fsm.process_event_dispatch(::std::move(event.event));
+        event.handler(res);
+        return res;
+    }
+
+    template < typename Queue >
     void
-    lock_and_swap_queue(event_queue& queue)
+    lock_and_swap_queue(Queue& queued, swap_queue& queue)
     {
         lock_guard lock{mutex_};
-        ::std::swap(queued_events_, queue);
+        queued.swap(queue);
         queue_size_ -= queue.size();
     }
 
@@ -367,126 +704,163 @@ private:
     process_event_queue()
     {
         while (queue_size_ > 0 && !is_top_.test_and_set()) {
-            observer_wrapper::start_process_events_queue(*this);
-            while (queue_size_ > 0) {
-                event_queue postponed;
-                lock_and_swap_queue(postponed);
-                for (auto const& event : postponed) {
-                    event.first();
-                }
+            detail::flag_guard top{is_top_};
+            drain_event_queue(queued_events_, queue_policy{});
+        }
+    }
+
+    // The queue is a template parameter so that only the functions for
+    // the selected policy are instantiated
+    template < typename Queue >
+    void
+    drain_event_queue(Queue& queued, def::tags::mutex_event_queue const&)
+    {
+        observer_wrapper::start_process_events_queue(*this);
+        while (queue_size_ > 0) {
+            lock_and_swap_queue(queued, processing_);
+            while (!processing_.empty()) {
+                event_queue_item event{ ::std::move(processing_.front()) };
+                processing_.pop_front();
+                event(*this);
+            }
+        }
+        observer_wrapper::end_process_events_queue(*this);
+    }
+
+    template < typename Queue >
+    void
+    drain_event_queue(Queue& queued, def::tags::lock_free_event_queue const&)
+    {
+        observer_wrapper::start_process_events_queue(*this);
+        event_queue_item event;
+        while (queue_size_ > 0) {
+            if (queued.try_pop(event)) {
+                --queue_size_;
+                event(*this);
+            } else {
+                // A producer has counted the event but not published
+                // it yet
+                ::std::this_thread::yield();
             }
-            observer_wrapper::end_process_events_queue(*this);
-            is_top_.clear();
         }
+        observer_wrapper::end_process_events_queue(*this);
+    }
+
+    /**
+     * Dispatch an event of a batch. Events enqueued while processing it
+     * are handled before the next event of the batch.
+     * Must be called with the run-to-completion flag set.
+     */
+    template < typename Event >
+    actions::event_process_result
+    process_batch_event( Event&& event )
+    {
+        auto res = process_event_dispatch(::std::forward<Event>(event));
+        if (queue_size_ > 0)
+            drain_event_queue(queued_events_, queue_policy{});
+        return res;
     }
 
     template < typename Event >
     void
     defer_event(Event&& event)
     {
-        using evt_identity = typename detail::event_identity<Event>::type;
-
         observer_wrapper::defer_event(*this, ::std::forward<Event>(event));
-        Event evt{::std::forward<Event>(event)};
-        deferred_events_.emplace_back([&, evt]() mutable {
-            return process_event_dispatch(::std::move(evt));
-        }, &evt_identity::id);
-        deferred_event_ids_.insert(&evt_identity::id);
+        if (!deferred_events_.push(make_queue_item(::std::forward<Event>(event)))) {
+            // The event is not handled by any state of the machine
+            observer_wrapper::drop_deferred_event(*this);
+        }
     }
     void
     process_deferred_queue()
     {
+        using actions::event_process_result;
         if (!deferred_top_.test_and_set()) {
-            using actions::event_process_result;
-            deferred_queue deferred;
-            detail::event_set event_ids;
-            if (skip_deferred_queue()) {
-                observer_wrapper::skip_processing_deferred_queue(*this);
-            } else {
-                ::std::swap(deferred_events_, deferred);
-                ::std::swap(deferred_event_ids_, event_ids);
-            }
-            while (!deferred.empty()) {
-                observer_wrapper::start_process_deferred_queue(*this, deferred.size());
-                auto res = event_process_result::refuse;
-                for (auto event = deferred.begin(); event != deferred.end();) {
-                    if (handled_.count(event->second)) {
-                        res = event->first();
-                        deferred.erase(event++);
-                    } else if (deferred_.count(event->second)) {
-                        // Move directly to the deferred queue
-                        ::std::size_t count{0};
-                        auto next = event;
-                        while (next != deferred.end() && next->second == event->second) {
-                            ++next;
-                            ++count;
-                        }
-                        deferred_events_.splice(deferred_events_.end(),
-                            deferred, event, next);
-                        deferred_event_ids_.insert(event->second);
-                        event = next;
-                        observer_wrapper::postpone_deferred_events(*this, count);
-                    } else {
-                        deferred.erase(event++);
-                        observer_wrapper::drop_deferred_event(*this);
-                    }
-                    if (res == event_process_result::process)
-                        break;
-                }
-                for (auto event = deferred.begin(); event != deferred.end();) {
-                    ::std::size_t count{0};
-                    auto next = event;
-                    while (next != deferred.end() && next->second == event->second) {
-                        ++count;
-                        ++next;
-                    }
-                    deferred_events_.splice(deferred_events_.end(),
-                        deferred, event, next);
-                    deferred_event_ids_.insert(event->second);
-                    event = next;
-                    observer_wrapper::postpone_deferred_events(*this, count);
-                }
-                event_ids.clear();
-                observer_wrapper::end_process_deferred_queue(*this, deferred_events_.size());
-                if (res == event_process_result::process) {
-                    if (skip_deferred_queue()) {
-                        observer_wrapper::skip_processing_deferred_queue(*this);
-                    } else {
-                        ::std::swap(deferred_events_, deferred);
-                        ::std::swap(deferred_event_ids_, event_ids);
-                    }
+            detail::flag_guard top{deferred_top_};
+            auto res = event_process_result::process;
+            while (res == event_process_result::process) {
+                if (skip_deferred_queue()) {
+                    observer_wrapper::skip_processing_deferred_queue(*this);
+                    return;
                 }
+                res = process_deferred_events();
             }
-            deferred_top_.clear();
+            drop_deferred_events();
+        }
+    }
+    /**
+     * Process deferred events handled in current state in the order they
+     * were deferred, until an event changes the state. Only the buckets of
+     * handled event types are visited.
+     */
+    actions::event_process_result
+    process_deferred_events()
+    {
+        using actions::event_process_result;
+        auto const pending = deferred_events_.size();
+        observer_wrapper::start_process_deferred_queue(*this, pending);
+        // Events deferred again while processing wait for the next state
+        // change
+        auto const last = deferred_events_.next_sequence();
+        auto res = event_process_result::refuse;
+        ::std::size_t replayed{0};
+        for (auto idx = deferred_events_.oldest(handled_, last);
+                idx != deferred_queue::npos;
+                idx = deferred_events_.oldest(handled_, last)) {
+            auto event = deferred_events_.pop(idx);
+            ++replayed;
+            res = event(*this);
+            if (res == event_process_result::process)
+                break;
+        }
+        if (pending > replayed)
+            observer_wrapper::postpone_deferred_events(*this, pending - replayed);
+        observer_wrapper::end_process_deferred_queue(*this, deferred_events_.size());
+        return res;
+    }
+
+    /**
+     * Drop deferred events that are neither handled nor deferred in the
+     * state the replay ended in. Events are not dropped in the states
+     * passed on the way, a later replayed event can lead to a state that
+     * handles them.
+     */
+    void
+    drop_deferred_events()
+    {
+        for (auto dropped = deferred_events_.drop(
+                deferred_events_.event_ids() - (handled_ | deferred_));
+                dropped > 0; --dropped) {
+            observer_wrapper::drop_deferred_event(*this);
         }
     }
 
     bool
     skip_deferred_queue() const
     {
-        detail::event_set st;
-        ::std::set_intersection(handled_.begin(), handled_.end(),
-            deferred_event_ids_.begin(), deferred_event_ids_.end(),
-            ::std::inserter(st, st.end()));
-        return st.empty();
+        return !handled_.intersects(deferred_events_.event_ids());
     }
 private:
     using atomic_counter    = ::std::atomic< ::std::size_t >;
 
     ::std::atomic_flag      is_top_;
 
-    detail::event_set       handled_;
-    detail::event_set       deferred_;
+    event_set               handled_;
+    event_set               deferred_;
 
     mutex_type              mutex_;
     event_queue             queued_events_;
+    swap_queue              processing_;
     atomic_counter          queue_size_;
 
     ::std::atomic_flag      deferred_top_;
     deferred_queue          deferred_events_;
-    detail::event_set       deferred_event_ids_;
 };
 
+template < typename T, typename Mutex, typename Observer,
+        template<typename> class ObserverWrapper >
+constexpr ::std::size_t state_machine<T, Mutex, Observer, ObserverWrapper>::queue_capacity;
+
 //----------------------------------------------------------------------------
 //  Priority State machine
 //----------------------------------------------------------------------------
@@ -508,34 +882,51 @@ public:
     using mutex_type        = Mutex;
     using lock_guard        = typename detail::lock_guard_type<mutex_type>::type;
     using observer_wrapper  = ObserverWrapper<Observer>;
+    using event_set         = typename base_machine_type::event_set;
     using event_invokation  = ::std::function< actions::event_process_result() >;
-    using prioritized_event = ::std::pair<event_invokation, event_priority_type>;
-    struct event_comparison {
-        bool
-        operator()(prioritized_event const& lhs, prioritized_event const& rhs) const
-        { return lhs.second < rhs.second; }
-    };
-    using event_queue       = ::std::priority_queue< prioritized_event, ::std::vector<prioritized_event>, event_comparison >;
+    using allocator_type    = typename def::traits::allocator_type<T>::type;
+    using item_allocator    = detail::rebind_alloc< allocator_type, event_invokation >;
+    using event_queue       = detail::priority_buckets<
+                                    event_invokation, event_priority_type, item_allocator >;
+    using deferred_queue    = detail::deferred_priority_buckets<
+                                    event_invokation, event_set, event_priority_type,
+                                    typename def::detail::recursive_deferred_events<T>::type,
+                                    item_allocator >;
+    using deferred_sequence = typename deferred_queue::sequence_type;
+    using overflow_policy   = typename def::traits::event_queue_capacity<T>::overflow_policy;
+    static constexpr ::std::size_t queue_capacity = def::traits::event_queue_capacity<T>::value;
+
+    static_assert(!::std::is_same< overflow_policy, def::tags::drop_oldest_on_full_queue >::value,
+            "Priority state machine cannot drop the oldest event");
 public:
     priority_state_machine()
-        : base_machine_type{this},
-          is_top_{},
-          mutex_{},
-          queued_events_{},
-          queue_size_{0},
-          deferred_mutex_{},
-          deferred_events_{}
-      {}
-    template<typename ... Args>
+        : priority_state_machine{ ::std::allocator_arg, allocator_type{} } {}
+    template<typename ... Args, typename = typename ::std::enable_if<
+            !detail::starts_with_allocator_arg<Args...>::value >::type>
     explicit
     priority_state_machine(Args&& ... args)
-        : base_machine_type(this, ::std::forward<Args>(args)...),
+        : priority_state_machine{ ::std::allocator_arg, allocator_type{},
+                ::std::forward<Args>(args)... } {}
+    /**
+     * Construct the state machine with an allocator for the event queues,
+     * the deferred events and the pushdown stacks, the rest of arguments
+     * are passed to the state machine definition constructor. Event
+     * invocations are std::function objects, they can allocate on their
+     * own.
+     */
+    template<typename ... Args>
+    priority_state_machine(::std::allocator_arg_t, allocator_type const& alloc, Args&& ... args)
+        : base_machine_type(this, ::std::allocator_arg, alloc, ::std::forward<Args>(args)...),
           is_top_{},
+          handled_{ base_machine_type::current_handled_events() },
+          deferred_{ base_machine_type::current_deferrable_events() },
           mutex_{},
-          queued_events_{},
+          queued_events_{ make_event_queue(alloc) },
+          processing_{ make_event_queue(alloc) },
           queue_size_{0},
+          deferred_top_{},
           deferred_mutex_{},
-          deferred_events_{}
+          deferred_events_{ item_allocator{alloc} }
     {}
 
     template < typename Event >
@@ -544,18 +935,41 @@ public:
                 event_priority_traits< typename ::std::decay<Event>::type >::value )
     {
         if (!queue_size_ && !is_top_.test_and_set()) {
-            auto res = process_event_dispatch(::std::forward<Event>(event), priority);
-            is_top_.clear();
+            auto res = process_top_event(::std::forward<Event>(event), priority);
             // Process enqueued events
             process_event_queue();
             return res;
         } else {
             // Enqueue event
-            enqueue_event(::std::forward<Event>(event), priority);
-            return actions::event_process_result::defer;
+            return enqueue_event(::std::forward<Event>(event), priority);
         }
     }
+
+    event_set const&
+    current_handled_events() const
+    { return handled_; }
+    event_set const&
+    current_deferrable_events() const
+    { return deferred_; }
+    event_set const&
+    current_deferred_events() const
+    { return deferred_events_.event_ids(); }
+
+    void
+    clear_deferred_events()
+    {
+        lock_guard lock{deferred_mutex_};
+        deferred_events_.clear();
+    }
 private:
+    template < typename Event >
+    actions::event_process_result
+    process_top_event( Event&& event, event_priority_type priority )
+    {
+        detail::flag_guard top{is_top_};
+        return process_event_dispatch(::std::forward<Event>(event), priority);
+    }
+
     template < typename Event >
     actions::event_process_result
     process_event_dispatch( Event&& event, event_priority_type priority )
@@ -577,6 +991,8 @@ private:
         switch (res) {
             case event_process_result::process:
                 // Changed state. Process deferred events
+                handled_    = base_machine_type::current_handled_events();
+                deferred_   = base_machine_type::current_deferrable_events();
                 process_deferred_queue();
                 break;
             case event_process_result::process_in_state:
@@ -610,28 +1026,79 @@ private:
     }
 
     template < typename Event >
-    void
+    actions::event_process_result
     enqueue_event(Event&& event, event_priority_type priority)
     {
-        {
-            lock_guard lock{mutex_};
-            ++queue_size_;
-            observer_wrapper::enqueue_event(*this, ::std::forward<Event>(event));
-            Event evt{::std::forward<Event>(event)};
-            queued_events_.emplace([&, evt, priority]() mutable {
-                return process_event_dispatch(::std::move(evt), priority);
-            }, priority);
+        auto res = actions::event_process_result::defer;
+        while (true) {
+            {
+                lock_guard lock{mutex_};
+                auto action = queue_full() ?
+                        on_queue_overflow(overflow_policy{}) :
+                        detail::queue_overflow_action::push;
+                if (action == detail::queue_overflow_action::push) {
+                    ++queue_size_;
+                    observer_wrapper::enqueue_event(*this, ::std::forward<Event>(event));
+                    Event evt{::std::forward<Event>(event)};
+                    queued_events_.push(priority, [&, evt, priority]() mutable {
+                        return process_event_dispatch(::std::move(evt), priority);
+                    });
+                    break;
+                }
+                if (action == detail::queue_overflow_action::discard) {
+                    res = actions::event_process_result::overflow;
+                    break;
+                }
+            }
+            // Wait for the queue to drain, or drain it if nobody does
+            process_event_queue();
+            ::std::this_thread::yield();
         }
         // Process enqueued events in case we've been waiting for queue
         // mutex release
         process_event_queue();
+        return res;
+    }
+
+    bool
+    queue_full() const
+    {
+        return queue_capacity > 0 && queue_size_ >= queue_capacity;
+    }
+
+    //@{
+    /** @name Queue overflow policies, called when the queue is full */
+    detail::queue_overflow_action
+    on_queue_overflow(def::tags::block_on_full_queue const&)
+    {
+        return detail::queue_overflow_action::wait;
+    }
+    detail::queue_overflow_action
+    on_queue_overflow(def::tags::reject_on_full_queue const&)
+    {
+        return detail::queue_overflow_action::discard;
+    }
+    detail::queue_overflow_action
+    on_queue_overflow(def::tags::drop_newest_on_full_queue const&)
+    {
+        observer_wrapper::drop_queued_event(*this);
+        return detail::queue_overflow_action::discard;
+    }
+    //@}
+
+    static event_queue
+    make_event_queue(allocator_type const& alloc)
+    {
+        event_queue queue{ item_allocator{alloc} };
+        queue.reserve(event_priority_type{}, queue_capacity);
+        return queue;
     }
 
     void
     lock_and_swap_queue(event_queue& queue)
     {
         lock_guard lock{mutex_};
-        ::std::swap(queued_events_, queue);
+        queued_events_.swap(queue);
         queue_size_ -= queue.size();
     }
 
@@ -639,17 +1106,17 @@ private:
     process_event_queue()
     {
         while (queue_size_ > 0 && !is_top_.test_and_set()) {
+            detail::flag_guard top{is_top_};
             observer_wrapper::start_process_events_queue(*this);
             while (queue_size_ > 0) {
-                event_queue postponed;
-                lock_and_swap_queue(postponed);
-                while (!postponed.empty()) {
-                    postponed.top().first();
-                    postponed.pop();
+                lock_and_swap_queue(processing_);
+                while (!processing_.empty()) {
+                    auto event = ::std::move(processing_.top());
+                    processing_.pop();
+                    event();
                 }
             }
             observer_wrapper::end_process_events_queue(*this);
-            is_top_.clear();
         }
     }
 
@@ -657,57 +1124,130 @@ private:
     void
     defer_event(Event&& event, event_priority_type priority)
     {
-        lock_guard lock{deferred_mutex_};
+        using event_type = typename ::std::decay<Event>::type;
         observer_wrapper::defer_event(*this, ::std::forward<Event>(event));
         Event evt{::std::forward<Event>(event)};
-        deferred_events_.emplace([&, evt, priority]() mutable {
-            return process_event_dispatch(::std::move(evt), priority);
-        }, priority);
+        bool stored;
+        {
+            lock_guard lock{deferred_mutex_};
+            stored = deferred_events_.push(event_set::template index<event_type>(), priority,
+                [&, evt, priority]() mutable {
+                    return process_event_dispatch(::std::move(evt), priority);
+                });
+        }
+        if (!stored) {
+            // The event is not handled by any state of the machine
+            observer_wrapper::drop_deferred_event(*this);
+        }
     }
     void
     process_deferred_queue()
     {
         using actions::event_process_result;
-        event_queue deferred;
+        if (!deferred_top_.test_and_set()) {
+            detail::flag_guard top{deferred_top_};
+            auto res = event_process_result::process;
+            while (res == event_process_result::process) {
+                if (skip_deferred_queue()) {
+                    observer_wrapper::skip_processing_deferred_queue(*this);
+                    return;
+                }
+                res = process_deferred_events();
+            }
+            drop_deferred_events();
+        }
+    }
+    /**
+     * Process deferred events handled in current state by priority, until
+     * an event changes the state. Only the queues of handled event types
+     * are visited, the other events stay in place. The deferred mutex is
+     * not held while an event is processed.
+     */
+    actions::event_process_result
+    process_deferred_events()
+    {
+        using actions::event_process_result;
+        ::std::size_t pending;
+        deferred_sequence last;
         {
             lock_guard lock{deferred_mutex_};
-            ::std::swap(deferred_events_, deferred);
+            pending = deferred_events_.size();
+            // Events deferred again while processing wait for the next
+            // state change
+            last = deferred_events_.next_sequence();
         }
-        while (!deferred.empty()) {
-            observer_wrapper::start_process_deferred_queue(*this, deferred.size());
-            auto res = event_process_result::refuse;
-            while (!deferred.empty()) {
-                res = deferred.top().first();
-                deferred.pop();
-                if (res == event_process_result::process)
-                    break;
-            }
+        observer_wrapper::start_process_deferred_queue(*this, pending);
+        auto res = event_process_result::refuse;
+        ::std::size_t replayed{0};
+        while (res != event_process_result::process) {
+            event_invokation event;
             {
                 lock_guard lock{deferred_mutex_};
-                while (!deferred.empty()) {
-                    deferred_events_.push(deferred.top());
-                    deferred.pop();
-                }
-            }
-            observer_wrapper::end_process_deferred_queue(*this, deferred_events_.size());
-            if (res == event_process_result::process) {
-                ::std::swap(deferred_events_, deferred);
+                auto idx = deferred_events_.top(handled_, last);
+                if (idx == deferred_queue::npos)
+                    break;
+                event = deferred_events_.pop(idx);
             }
+            ++replayed;
+            res = event();
+        }
+        if (pending > replayed)
+            observer_wrapper::postpone_deferred_events(*this, pending - replayed);
+        observer_wrapper::end_process_deferred_queue(*this, deferred_size());
+        return res;
+    }
+    /**
+     * Drop deferred events that are neither handled nor deferred in the
+     * state the replay ended in.
+     */
+    void
+    drop_deferred_events()
+    {
+        ::std::size_t dropped;
+        {
+            lock_guard lock{deferred_mutex_};
+            dropped = deferred_events_.drop(
+                    deferred_events_.event_ids() - (handled_ | deferred_));
         }
+        for (; dropped > 0; --dropped)
+            observer_wrapper::drop_deferred_event(*this);
+    }
+
+    ::std::size_t
+    deferred_size()
+    {
+        lock_guard lock{deferred_mutex_};
+        return deferred_events_.size();
+    }
+
+    bool
+    skip_deferred_queue()
+    {
+        lock_guard lock{deferred_mutex_};
+        return !handled_.intersects(deferred_events_.event_ids());
     }
 private:
     using atomic_counter    = ::std::atomic< ::std::size_t >;
 
     ::std::atomic_flag      is_top_;
 
+    event_set               handled_;
+    event_set               deferred_;
+
     mutex_type              mutex_;
     event_queue             queued_events_;
+    event_queue             processing_;
     atomic_counter          queue_size_;
 
+    ::std::atomic_flag      deferred_top_;
     mutex_type              deferred_mutex_;
-    event_queue             deferred_events_;
+    deferred_queue          deferred_events_;
 };
 
+template < typename T, typename Mutex, typename Observer,
+        template<typename> class ObserverWrapper >
+constexpr ::std::size_t priority_state_machine<T, Mutex, Observer, ObserverWrapper>::queue_capacity;
+
 template < typename T, typename Mutex, typename Observer,
         template<typename> class ObserverWrapper >
 state_machine<T, Mutex, Observer, ObserverWrapper>&
@@ -772,6 +1312,71 @@ root_machine(state<T, FSM> const& fsm)
     return root_machine(fsm.enclosing_fsm());
 }
 
+//----------------------------------------------------------------------------
+//  Memory footprint
+//----------------------------------------------------------------------------
+/**
+ * Per-instance memory used by a state machine type
+ */
+struct memory_footprint_info {
+    /** Size of the machine object */
+    ::std::size_t   machine;
+    /** Storage of the inner states or of the orthogonal regions */
+    ::std::size_t   inner_states;
+    /** Index of the current state, zero for orthogonal machines */
+    ::std::size_t   state_index;
+    /** Number of the inner states or of the orthogonal regions */
+    ::std::size_t   state_count;
+};
+
+namespace detail {
+
+template < typename FSM, bool Orthogonal >
+struct machine_footprint {
+    static constexpr memory_footprint_info
+    value()
+    {
+        return {
+            sizeof(FSM),
+            sizeof(typename FSM::inner_states_tuple),
+            sizeof(typename FSM::transition_tuple::index_type),
+            FSM::inner_state_count
+        };
+    }
+};
+
+template < typename FSM >
+struct machine_footprint< FSM, true > {
+    static constexpr memory_footprint_info
+    value()
+    {
+        return {
+            sizeof(FSM),
+            sizeof(typename FSM::region_tuple),
+            0,
+            FSM::region_count
+        };
+    }
+};
+
+}  /* namespace detail */
+
+/**
+ * Report of the memory used by an instance of a state machine type
+ *
+ * @code
+ * static_assert(afsm::memory_footprint<my_fsm>().state_index == 1, "");
+ * @endcode
+ */
+template < typename FSM >
+constexpr memory_footprint_info
+memory_footprint()
+{
+    return detail::machine_footprint< FSM,
+            def::traits::has_orthogonal_regions<
+                typename FSM::state_machine_definition_type >::value >::value();
+}
+
 }  /* namespace afsm */
 
 #endif /* AFSM_FSM_HPP_ */
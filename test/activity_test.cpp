@@ -0,0 +1,269 @@
+/*
+ * activity_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct start {};
+struct stop {};
+struct tick {};
+
+}  /* namespace events */
+
+namespace {
+
+/**
+ * Holds the posted tasks until they are run explicitly
+ */
+struct manual_executor {
+    template < typename Task >
+    void
+    post(Task&& task)
+    {
+        tasks.emplace_back(::std::forward<Task>(task));
+    }
+    void
+    run_all()
+    {
+        auto run = ::std::move(tasks);
+        tasks.clear();
+        for (auto& task : run)
+            task();
+    }
+
+    ::std::vector< ::std::function<void()> > tasks{};
+};
+
+/**
+ * Sends ticks to the machine until stopped
+ */
+struct ticker {
+    template < typename FSM, typename State >
+    void
+    start(FSM& fsm, State&)
+    {
+        auto& root = root_machine(fsm);
+        root.activity_thread = ::std::this_thread::get_id();
+        ++root.started;
+        while (!stopped) {
+            root.process_event(events::tick{});
+            ::std::this_thread::yield();
+        }
+        ++root.finished;
+    }
+    template < typename FSM, typename State >
+    void
+    stop(FSM&, State&)
+    {
+        stopped = true;
+    }
+
+    ::std::atomic<bool> stopped{false};
+};
+
+template < typename ... Tags >
+struct activity_def : def::state_machine< activity_def<Tags...>, Tags... > {
+    struct count_tick {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::tick const&, FSM& fsm, Source&, Target&) const
+        {
+            ++root_machine(fsm).ticks;
+        }
+    };
+    struct idle : def::state<idle> {};
+    struct working : def::state<working> {
+        using activity = ticker;
+        using internal_transitions = def::transition_table<
+            def::internal_transition< events::tick, count_tick >
+        >;
+    };
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,      events::start,  working >,
+        def::transition< working,   events::stop,   idle    >
+    >;
+
+    static manual_executor&
+    activity_executor()
+    {
+        static manual_executor executor;
+        return executor;
+    }
+
+    ::std::atomic<int>  started{0};
+    ::std::atomic<int>  finished{0};
+    ::std::atomic<int>  ticks{0};
+    ::std::thread::id   activity_thread{};
+};
+
+/**
+ * Activity that fails to start
+ */
+struct failing {
+    template < typename FSM, typename State >
+    void
+    start(FSM&, State&)
+    {
+        throw ::std::runtime_error{"activity failed"};
+    }
+    template < typename FSM, typename State >
+    void
+    stop(FSM&, State&) {}
+};
+
+struct failing_def : def::state_machine< failing_def, def::tags::custom_activity_executor > {
+    struct idle : def::state<idle> {};
+    struct working : def::state<working> {
+        using activity = failing;
+    };
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,      events::start,  working >,
+        def::transition< working,   events::stop,   idle    >
+    >;
+
+    static manual_executor&
+    activity_executor()
+    {
+        static manual_executor executor;
+        return executor;
+    }
+};
+
+struct error_observer : detail::null_observer {
+    template < typename FSM, typename State >
+    void
+    activity_error(FSM const&, State const&, ::std::exception_ptr const& error) const noexcept
+    {
+        try {
+            ::std::rethrow_exception(error);
+        } catch (::std::runtime_error const& e) {
+            message = e.what();
+        } catch (...) {}
+    }
+
+    mutable ::std::string message{};
+};
+
+using pool_fsm = state_machine< activity_def<>, ::std::mutex >;
+using manual_fsm = state_machine<
+        activity_def< def::tags::custom_activity_executor >, ::std::mutex >;
+
+static_assert(def::traits::has_activity<pool_fsm::working>::value, "");
+static_assert(!def::traits::has_activity<pool_fsm::idle>::value, "");
+static_assert(def::traits::has_activity_executor<manual_fsm::state_machine_definition_type>::value, "");
+
+}  /* namespace  */
+
+TEST(Activity, StartStop)
+{
+    pool_fsm fsm;
+    fsm.process_event(events::start{});
+    while (fsm.ticks < 10)
+        ::std::this_thread::yield();
+    EXPECT_NE(::std::this_thread::get_id(), fsm.activity_thread)
+            << "Activity runs on the thread pool";
+    EXPECT_TRUE(fsm.get_state<pool_fsm::working>().state_activity().active());
+
+    fsm.process_event(events::stop{});
+    // The stop is queued if the activity is processing a tick, then the
+    // activity thread leaves the state
+    while (fsm.finished == 0)
+        ::std::this_thread::yield();
+    EXPECT_EQ(1, fsm.started);
+    EXPECT_EQ(1, fsm.finished);
+    EXPECT_TRUE(fsm.is_in_state< pool_fsm::idle >());
+    EXPECT_FALSE(fsm.get_state<pool_fsm::working>().state_activity().active());
+    auto ticks = fsm.ticks.load();
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds{10});
+    EXPECT_EQ(ticks, fsm.ticks) << "No ticks after the state is left";
+
+    // Restart
+    fsm.process_event(events::start{});
+    while (fsm.ticks == ticks)
+        ::std::this_thread::yield();
+    fsm.process_event(events::stop{});
+    while (fsm.finished == 1)
+        ::std::this_thread::yield();
+    EXPECT_EQ(2, fsm.started);
+    EXPECT_EQ(2, fsm.finished);
+}
+
+TEST(Activity, ThreadLimit)
+{
+    auto& pool = detail::activity_thread_pool::instance();
+    auto const limit = pool.max_threads();
+    pool.max_threads(::std::max< ::std::size_t >(pool.thread_count(), 1));
+    auto const threads = pool.max_threads();
+
+    ::std::vector< ::std::unique_ptr<pool_fsm> > machines;
+    for (::std::size_t i = 0; i <= threads; ++i) {
+        machines.emplace_back(new pool_fsm{});
+        machines.back()->process_event(events::start{});
+    }
+    for (::std::size_t i = 0; i < threads; ++i) {
+        while (machines[i]->started == 0)
+            ::std::this_thread::yield();
+    }
+    ::std::this_thread::sleep_for(::std::chrono::milliseconds{10});
+    EXPECT_EQ(0, machines.back()->started) << "Waits for a free thread";
+    EXPECT_EQ(threads, pool.thread_count());
+
+    machines.front()->process_event(events::stop{});
+    while (machines.back()->started == 0)
+        ::std::this_thread::yield();
+    for (auto& fsm : machines)
+        fsm->process_event(events::stop{});
+    EXPECT_EQ(threads, pool.thread_count());
+    pool.max_threads(limit);
+}
+
+TEST(Activity, StartThrows)
+{
+    using fsm_type = state_machine< failing_def, none, error_observer >;
+    auto& executor = failing_def::activity_executor();
+    auto observer = ::std::make_shared<error_observer>();
+    fsm_type fsm;
+    fsm.set_observer(observer);
+    fsm.process_event(events::start{});
+    ASSERT_EQ(1ul, executor.tasks.size());
+    EXPECT_NO_THROW(executor.run_all());
+    EXPECT_EQ("activity failed", observer->message);
+    fsm.process_event(events::stop{});
+    EXPECT_TRUE(fsm.is_in_state< failing_def::idle >())
+            << "The failed activity has finished, exit doesn't wait";
+}
+
+TEST(Activity, CancelPending)
+{
+    auto& executor = manual_fsm::state_machine_definition_type::activity_executor();
+    manual_fsm fsm;
+    fsm.process_event(events::start{});
+    EXPECT_EQ(1ul, executor.tasks.size());
+    fsm.process_event(events::stop{});
+    executor.run_all();
+    EXPECT_EQ(0, fsm.started) << "Activity is cancelled before it starts";
+    EXPECT_EQ(0, fsm.ticks);
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -0,0 +1,315 @@
+/*
+ * allocator_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define AFSM_TEST_MEMORY_RESOURCE
+#endif
+#endif
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct start {};
+struct stop {};
+struct burst {};
+struct tick {
+    int n;
+};
+struct open {};
+struct close {};
+
+}  /* namespace events */
+
+namespace {
+
+struct allocation_stats {
+    ::std::size_t allocations{0};
+    ::std::size_t deallocations{0};
+};
+
+allocation_stats&
+default_stats()
+{
+    static allocation_stats stats;
+    return stats;
+}
+
+/**
+ * Allocator counting the calls, a default constructed allocator counts
+ * to the default_stats
+ */
+template < typename T >
+struct counting_allocator {
+    using value_type = T;
+
+    counting_allocator() noexcept
+        : stats{ &default_stats() } {}
+    explicit
+    counting_allocator(allocation_stats& s) noexcept
+        : stats{ &s } {}
+    counting_allocator(counting_allocator const&) = default;
+    template < typename U >
+    counting_allocator(counting_allocator<U> const& rhs) noexcept
+        : stats{ rhs.stats } {}
+
+    counting_allocator&
+    operator = (counting_allocator const&) = default;
+
+    T*
+    allocate(::std::size_t n)
+    {
+        ++stats->allocations;
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void
+    deallocate(T* p, ::std::size_t) noexcept
+    {
+        ++stats->deallocations;
+        ::operator delete(p);
+    }
+
+    allocation_stats* stats;
+};
+
+template < typename T, typename U >
+bool
+operator == (counting_allocator<T> const& lhs, counting_allocator<U> const& rhs)
+{ return lhs.stats == rhs.stats; }
+template < typename T, typename U >
+bool
+operator != (counting_allocator<T> const& lhs, counting_allocator<U> const& rhs)
+{ return !(lhs == rhs); }
+
+/**
+ * The burst action posts three ticks while the machine is busy, the
+ * busy state defers ticks
+ */
+template < typename Allocator, typename ... Tags >
+struct alloc_def : def::state_machine< alloc_def<Allocator, Tags...>,
+        def::tags::allocator<Allocator>, Tags... > {
+    struct post_ticks {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::burst const&, FSM& fsm, Source&, Target&) const
+        {
+            for (auto i = 0; i < 3; ++i)
+                root_machine(fsm).process_event(events::tick{i});
+        }
+    };
+    struct record {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::tick const& evt, FSM& fsm, Source&, Target&) const
+        {
+            fsm.ticks.push_back(evt.n);
+        }
+    };
+
+    struct idle : def::state<idle> {
+        using internal_transitions = def::transition_table<
+            def::internal_transition< events::burst,  post_ticks  >,
+            def::internal_transition< events::tick,   record      >
+        >;
+    };
+    struct busy : def::state<busy> {
+        using deferred_events = ::psst::meta::type_tuple< events::tick >;
+    };
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle, events::start, busy >,
+        def::transition< busy, events::stop,  idle >
+    >;
+
+    ::std::vector<int> ticks{};
+};
+
+template < typename FSM >
+void
+queue_and_defer(FSM& fsm)
+{
+    fsm.process_event(events::burst{});
+    fsm.process_event(events::start{});
+    for (auto i = 3; i < 6; ++i)
+        fsm.process_event(events::tick{i});
+    fsm.process_event(events::stop{});
+    EXPECT_EQ((::std::vector<int>{ 0, 1, 2, 3, 4, 5 }), fsm.ticks);
+}
+
+template < typename ... Tags >
+struct nest_def : def::state_machine< nest_def<Tags...>,
+        def::tags::allocator< counting_allocator<char> >, Tags... > {
+    using this_type = nest_def<Tags...>;
+    struct idle : def::state<idle> {};
+    struct inner : def::pushdown< inner, this_type > {};
+    struct done : def::popup< done, this_type > {};
+
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,  events::open,   inner   >,
+        def::transition< inner, events::close,  done    >,
+        def::transition< inner, events::open,   inner   >
+    >;
+};
+
+/**
+ * The pushdown machine is an inner state of the outer one
+ */
+template < typename Allocator >
+struct outer_def : def::state_machine< outer_def<Allocator>,
+        def::tags::allocator<Allocator> > {
+    struct nest : def::state_machine<nest> {
+        struct idle : def::state<idle> {};
+        struct inner : def::pushdown< inner, nest > {};
+        struct done : def::popup< done, nest > {};
+
+        using initial_state = idle;
+        using transitions = def::transition_table<
+            def::transition< idle,  events::open,   inner   >,
+            def::transition< inner, events::close,  done    >,
+            def::transition< inner, events::open,   inner   >
+        >;
+    };
+    struct stopped : def::state<stopped> {};
+
+    using initial_state = nest;
+    using transitions = def::transition_table<
+        def::transition< nest,  events::stop,   stopped >
+    >;
+};
+
+}  /* namespace  */
+
+TEST(Allocator, EventQueue)
+{
+    using fsm_type = state_machine< alloc_def< counting_allocator<char> > >;
+    static_assert(::std::is_same< fsm_type::allocator_type,
+            counting_allocator<char> >::value, "");
+    allocation_stats stats;
+    {
+        fsm_type fsm{ ::std::allocator_arg, counting_allocator<char>{stats} };
+        EXPECT_EQ(&stats, fsm.get_allocator().stats);
+        queue_and_defer(fsm);
+        EXPECT_LT(0ul, stats.allocations)
+                << "Queued and deferred events use the allocator";
+    }
+    EXPECT_EQ(stats.allocations, stats.deallocations);
+}
+
+TEST(Allocator, LockFreeQueue)
+{
+    using fsm_type = state_machine< alloc_def< counting_allocator<char>,
+            def::tags::lock_free_event_queue > >;
+    allocation_stats stats;
+    {
+        fsm_type fsm{ ::std::allocator_arg, counting_allocator<char>{stats} };
+        fsm.process_event(events::burst{});
+        EXPECT_EQ((::std::vector<int>{ 0, 1, 2 }), fsm.ticks);
+        EXPECT_LE(3ul, stats.allocations) << "A node per queued event";
+    }
+    EXPECT_EQ(stats.allocations, stats.deallocations);
+}
+
+TEST(Allocator, PriorityQueue)
+{
+    using fsm_type = priority_state_machine< alloc_def< counting_allocator<char> > >;
+    allocation_stats stats;
+    {
+        fsm_type fsm{ ::std::allocator_arg, counting_allocator<char>{stats} };
+        EXPECT_EQ(&stats, fsm.get_allocator().stats);
+        queue_and_defer(fsm);
+        EXPECT_LT(0ul, stats.allocations);
+    }
+    EXPECT_EQ(stats.allocations, stats.deallocations);
+}
+
+TEST(Allocator, PushdownFrames)
+{
+    using fsm_type = state_machine< nest_def<> >;
+    using inline_fsm_type = state_machine< nest_def< def::tags::pushdown_depth<4> > >;
+    using outer_fsm_type = state_machine< outer_def< counting_allocator<char> > >;
+    using nest_def_type = outer_def< counting_allocator<char> >::nest;
+    allocation_stats stats;
+    auto const before = default_stats().allocations;
+    {
+        fsm_type fsm{ ::std::allocator_arg, counting_allocator<char>{stats} };
+        fsm.process_event(events::open{});
+        fsm.process_event(events::open{});
+        EXPECT_EQ(3ul, fsm.stack_size());
+
+        outer_fsm_type outer{ ::std::allocator_arg, counting_allocator<char>{stats} };
+        auto& nest = outer.get_state< nest_def_type >();
+        EXPECT_EQ(&stats, nest.get_allocator().stats);
+        outer.process_event(events::open{});
+        outer.process_event(events::open{});
+        EXPECT_EQ(3ul, nest.stack_size());
+    }
+    EXPECT_EQ(before, default_stats().allocations)
+            << "Frame stacks use the allocator passed to the outer machine";
+    EXPECT_EQ(stats.allocations, stats.deallocations);
+
+    auto const inline_before = default_stats().allocations;
+    {
+        inline_fsm_type fsm;
+        fsm.process_event(events::open{});
+        fsm.process_event(events::open{});
+        EXPECT_EQ(3ul, fsm.stack_size());
+    }
+    EXPECT_EQ(inline_before, default_stats().allocations)
+            << "Inline frames don't allocate";
+}
+
+#ifdef AFSM_TEST_MEMORY_RESOURCE
+TEST(Allocator, MemoryResource)
+{
+    using allocator_type = ::std::pmr::polymorphic_allocator<char>;
+    using fsm_type = state_machine< alloc_def< allocator_type > >;
+    ::std::array< ::std::byte, 1 << 16 > buffer;
+    // Running out of the buffer throws
+    ::std::pmr::monotonic_buffer_resource resource{
+        buffer.data(), buffer.size(), ::std::pmr::null_memory_resource() };
+    fsm_type fsm{ ::std::allocator_arg, &resource };
+    EXPECT_EQ(&resource, fsm.get_allocator().resource());
+    queue_and_defer(fsm);
+}
+
+TEST(Allocator, MemoryResourcePushdown)
+{
+    using allocator_type = ::std::pmr::polymorphic_allocator<char>;
+    using fsm_type = state_machine< outer_def< allocator_type > >;
+    using nest_def_type = outer_def< allocator_type >::nest;
+    ::std::array< ::std::byte, 1 << 16 > buffer;
+    ::std::pmr::monotonic_buffer_resource resource{
+        buffer.data(), buffer.size(), ::std::pmr::null_memory_resource() };
+    // Allocating from the default resource throws
+    auto const default_resource =
+            ::std::pmr::set_default_resource(::std::pmr::null_memory_resource());
+    {
+        fsm_type fsm{ ::std::allocator_arg, &resource };
+        auto& nest = fsm.get_state< nest_def_type >();
+        EXPECT_EQ(&resource, nest.get_allocator().resource());
+        EXPECT_NO_THROW(fsm.process_event(events::open{}));
+        EXPECT_NO_THROW(fsm.process_event(events::open{}));
+        EXPECT_EQ(3ul, nest.stack_size());
+    }
+    ::std::pmr::set_default_resource(default_resource);
+}
+#endif
+
+}  /* namespace test */
+}  /* namespace afsm */
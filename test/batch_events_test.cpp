@@ -0,0 +1,93 @@
+/*
+ * batch_events_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <iterator>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct open {};
+struct close {};
+struct knock {};
+
+}  /* namespace events */
+
+namespace {
+
+struct door_def : def::state_machine<door_def> {
+    /**
+     * Knocking on a closed door opens it, the event is posted from
+     * the action
+     */
+    struct answer {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::knock const&, FSM& fsm, Source&, Target&) const
+        {
+            root_machine(fsm).process_event(events::open{});
+        }
+    };
+    struct record {
+        template < typename Event, typename FSM, typename Source, typename Target >
+        void
+        operator()(Event const&, FSM& fsm, Source&, Target&) const
+        {
+            fsm.log.push_back(::std::is_same<Event, events::open>::value ? 'o' : 'c');
+        }
+    };
+
+    struct closed : state<closed> {};
+    struct opened : state<opened> {};
+
+    using initial_state = closed;
+    using transitions = transition_table<
+        tr< closed, events::open,   opened, record  >,
+        tr< closed, events::knock,  closed, answer  >,
+        tr< opened, events::close,  closed, record  >
+    >;
+
+    ::std::vector<char> log{};
+};
+
+using door_fsm = state_machine<door_def>;
+
+}  /* namespace  */
+
+TEST(BatchEvents, Range)
+{
+    using actions::event_process_result;
+    door_fsm fsm;
+    ::std::vector<events::open> opens(2);
+    ::std::vector<event_process_result> res;
+
+    fsm.process_events(opens.begin(), opens.end(), ::std::back_inserter(res));
+    EXPECT_EQ((::std::vector<event_process_result>{
+            event_process_result::process, event_process_result::refuse }), res);
+    EXPECT_TRUE(fsm.is_in_state<door_def::opened>());
+}
+
+TEST(BatchEvents, Variadic)
+{
+    using actions::event_process_result;
+    door_fsm fsm;
+
+    auto res = fsm.process_events(events::knock{}, events::close{}, events::close{});
+    EXPECT_EQ(event_process_result::process, res[0]);
+    EXPECT_EQ(event_process_result::process, res[1])
+            << "Event posted by the action is processed before the next one";
+    EXPECT_EQ(event_process_result::refuse, res[2]);
+    EXPECT_EQ((::std::vector<char>{ 'o', 'c' }), fsm.log);
+    EXPECT_TRUE(fsm.is_in_state<door_def::closed>());
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -0,0 +1,272 @@
+/*
+ * bounded_queue_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct burst {};
+struct async_burst {};
+struct fail {};
+struct hold {};
+struct stop {};
+struct tick {
+    int n;
+};
+
+}  /* namespace events */
+
+namespace {
+
+using actions::event_process_result;
+
+struct drop_counter : detail::null_observer {
+    template < typename FSM >
+    void
+    drop_queued_event(FSM const&) noexcept
+    { ++drops; }
+
+    ::std::size_t drops{0};
+};
+
+/**
+ * The burst action posts three ticks to a queue of two events
+ */
+template < typename ... Tags >
+struct bounded_def : def::state_machine< bounded_def<Tags...>, Tags... > {
+    struct post_ticks {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::burst const&, FSM& fsm, Source&, Target&) const
+        {
+            for (auto i = 0; i < 3; ++i)
+                fsm.results.push_back(root_machine(fsm).process_event(events::tick{i}));
+        }
+    };
+    /**
+     * Posts three ticks with completion handlers
+     */
+    struct post_completions {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::async_burst const&, FSM& fsm, Source&, Target&) const
+        {
+            for (auto i = 0; i < 3; ++i)
+                post(fsm, i);
+        }
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::fail const&, FSM& fsm, Source&, Target&) const
+        {
+            post(fsm, 0);
+            throw ::std::runtime_error{"Action failed"};
+        }
+        template < typename FSM >
+        static void
+        post(FSM& fsm, int n)
+        {
+            auto completed = fsm.completed;
+            root_machine(fsm).process_event(events::tick{n},
+                [completed, n](event_process_result res)
+                {
+                    completed->emplace_back(n, res);
+                });
+        }
+    };
+    struct hold_on {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::hold const&, FSM& fsm, Source&, Target&) const
+        {
+            fsm.holding = true;
+            while (!fsm.released)
+                ::std::this_thread::yield();
+        }
+    };
+    struct record {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::tick const& evt, FSM& fsm, Source&, Target&) const
+        {
+            fsm.ticks.push_back(evt.n);
+        }
+    };
+
+    struct idle : def::state<idle> {
+        using internal_transitions = def::transition_table<
+            def::internal_transition< events::burst,  post_ticks  >,
+            def::internal_transition< events::async_burst,  post_completions  >,
+            def::internal_transition< events::fail,   post_completions  >,
+            def::internal_transition< events::hold,   hold_on     >,
+            def::internal_transition< events::tick,   record      >
+        >;
+    };
+    struct stopped : def::state<stopped> {};
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle, events::stop, stopped >
+    >;
+
+    ::std::vector<event_process_result> results{};
+    ::std::vector<int>                  ticks{};
+    ::std::shared_ptr< ::std::vector< ::std::pair<int, event_process_result> > >
+        completed{ ::std::make_shared<
+            ::std::vector< ::std::pair<int, event_process_result> > >() };
+    ::std::atomic<bool>                 holding{false};
+    ::std::atomic<bool>                 released{false};
+};
+
+template < typename Overflow, typename ... Tags >
+using bounded_fsm = state_machine<
+        bounded_def< def::tags::event_queue_capacity<2, Overflow>, Tags... >,
+        none, drop_counter >;
+
+template < typename FSM >
+::std::shared_ptr<drop_counter>
+burst(FSM& fsm)
+{
+    auto observer = ::std::make_shared<drop_counter>();
+    fsm.set_observer(observer);
+    fsm.process_event(events::burst{});
+    return observer;
+}
+
+}  /* namespace  */
+
+TEST(BoundedQueue, Reject)
+{
+    bounded_fsm< def::tags::reject_on_full_queue > fsm;
+    auto observer = burst(fsm);
+    EXPECT_EQ((::std::vector<event_process_result>{
+            event_process_result::defer,
+            event_process_result::defer,
+            event_process_result::overflow}), fsm.results);
+    EXPECT_EQ((::std::vector<int>{ 0, 1 }), fsm.ticks);
+    EXPECT_EQ(0ul, observer->drops);
+}
+
+TEST(BoundedQueue, DropNewest)
+{
+    bounded_fsm< def::tags::drop_newest_on_full_queue > fsm;
+    auto observer = burst(fsm);
+    EXPECT_EQ(event_process_result::overflow, fsm.results.back());
+    EXPECT_EQ((::std::vector<int>{ 0, 1 }), fsm.ticks);
+    EXPECT_EQ(1ul, observer->drops);
+}
+
+TEST(BoundedQueue, DropOldest)
+{
+    bounded_fsm< def::tags::drop_oldest_on_full_queue > fsm;
+    auto observer = burst(fsm);
+    EXPECT_EQ((::std::vector<event_process_result>{
+            event_process_result::defer,
+            event_process_result::defer,
+            event_process_result::defer}), fsm.results);
+    EXPECT_EQ((::std::vector<int>{ 1, 2 }), fsm.ticks);
+    EXPECT_EQ(1ul, observer->drops);
+}
+
+TEST(BoundedQueue, DropOldestCompletion)
+{
+    using completion = ::std::pair<int, event_process_result>;
+    bounded_fsm< def::tags::drop_oldest_on_full_queue > fsm;
+    fsm.process_event(events::async_burst{});
+    // The handler of the dropped event gets the overflow result
+    EXPECT_EQ((::std::vector<completion>{
+            completion{ 0, event_process_result::overflow },
+            completion{ 1, event_process_result::process_in_state },
+            completion{ 2, event_process_result::process_in_state }}), *fsm.completed);
+    EXPECT_EQ((::std::vector<int>{ 1, 2 }), fsm.ticks);
+}
+
+template < typename FSM >
+void
+reject_completion()
+{
+    using completion = ::std::pair<int, event_process_result>;
+    FSM fsm;
+    fsm.process_event(events::async_burst{});
+    // The handler of the rejected event gets the overflow result
+    EXPECT_EQ((::std::vector<completion>{
+            completion{ 2, event_process_result::overflow },
+            completion{ 0, event_process_result::process_in_state },
+            completion{ 1, event_process_result::process_in_state }}), *fsm.completed);
+    EXPECT_EQ((::std::vector<int>{ 0, 1 }), fsm.ticks);
+}
+
+TEST(BoundedQueue, RejectCompletion)
+{
+    reject_completion< bounded_fsm< def::tags::reject_on_full_queue > >();
+    reject_completion< bounded_fsm< def::tags::reject_on_full_queue,
+            def::tags::lock_free_event_queue > >();
+}
+
+TEST(BoundedQueue, DestroyWithQueuedCompletion)
+{
+    using completion = ::std::pair<int, event_process_result>;
+    ::std::shared_ptr< ::std::vector<completion> > completed;
+    {
+        bounded_fsm< def::tags::reject_on_full_queue > fsm;
+        completed = fsm.completed;
+        EXPECT_THROW(fsm.process_event(events::fail{}), ::std::runtime_error);
+        EXPECT_TRUE(completed->empty());
+    }
+    // Still queued when the machine is destroyed
+    EXPECT_EQ((::std::vector<completion>{
+            completion{ 0, event_process_result::overflow }}), *completed);
+}
+
+TEST(BoundedQueue, LockFreeReject)
+{
+    bounded_fsm< def::tags::reject_on_full_queue, def::tags::lock_free_event_queue > fsm;
+    auto observer = burst(fsm);
+    EXPECT_EQ(event_process_result::overflow, fsm.results.back());
+    EXPECT_EQ((::std::vector<int>{ 0, 1 }), fsm.ticks);
+}
+
+TEST(BoundedQueue, Block)
+{
+    using def_type = bounded_def<
+            def::tags::event_queue_capacity<2, def::tags::block_on_full_queue> >;
+    state_machine< def_type, ::std::mutex > fsm;
+
+    ::std::thread producer{[&fsm]{
+        while (!fsm.holding)
+            ::std::this_thread::yield();
+        for (auto i = 0; i < 2; ++i)
+            EXPECT_EQ(event_process_result::defer, fsm.process_event(events::tick{i}));
+        fsm.released = true;
+        // Waits for the queue to drain
+        fsm.process_event(events::tick{2});
+    }};
+    fsm.process_event(events::hold{});
+    producer.join();
+    EXPECT_EQ((::std::vector<int>{ 0, 1, 2 }), fsm.ticks);
+}
+
+TEST(BoundedQueue, PriorityReject)
+{
+    using def_type = bounded_def<
+            def::tags::event_queue_capacity<2, def::tags::reject_on_full_queue> >;
+    priority_state_machine< def_type > fsm;
+    fsm.process_event(events::burst{});
+    EXPECT_EQ(event_process_result::overflow, fsm.results.back());
+    EXPECT_EQ(2ul, fsm.ticks.size());
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -0,0 +1,98 @@
+/*
+ * completion_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct start {};
+struct toggle {};
+
+}  /* namespace events */
+
+namespace {
+
+using actions::event_process_result;
+
+/**
+ * Start action posts two toggles, the second one is refused
+ * after the first one makes a transition
+ */
+struct completion_def : def::state_machine<completion_def> {
+    struct post_toggles {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::start const&, FSM& fsm, Source&, Target&) const
+        {
+            for (auto i = 0; i < 2; ++i) {
+                root_machine(fsm).process_event(events::toggle{},
+                    [&fsm](event_process_result res)
+                    {
+                        fsm.results.push_back(res);
+                    });
+            }
+            fsm.results_on_post = fsm.results.size();
+        }
+    };
+
+    struct idle : state<idle> {};
+    struct ready : state<ready> {};
+    struct done : state<done> {};
+
+    using initial_state = idle;
+    using transitions = transition_table<
+        tr< idle,   events::start,  ready,  post_toggles    >,
+        tr< ready,  events::toggle, done                    >
+    >;
+
+    ::std::vector<event_process_result> results{};
+    ::std::size_t                       results_on_post{0};
+};
+
+using completion_fsm = state_machine<completion_def>;
+
+}  /* namespace  */
+
+TEST(Completion, Reentrant)
+{
+    completion_fsm fsm;
+    fsm.process_event(events::start{},
+        [&fsm](event_process_result res) { fsm.results.push_back(res); });
+    EXPECT_EQ(0ul, fsm.results_on_post) << "Handlers are called on dispatch";
+    // The start handler is called before the handlers of the toggles it
+    // has posted
+    EXPECT_EQ((::std::vector<event_process_result>{
+            event_process_result::process,
+            event_process_result::process,
+            event_process_result::refuse}), fsm.results);
+    EXPECT_TRUE(fsm.is_in_state<completion_def::done>());
+}
+
+TEST(Completion, Future)
+{
+    state_machine<completion_def, ::std::mutex> fsm;
+    auto started = fsm.process_event_async(events::start{});
+    ASSERT_EQ(::std::future_status::ready, started.wait_for(::std::chrono::seconds{0}));
+    EXPECT_EQ(event_process_result::process, started.get());
+
+    auto toggled = ::std::async(::std::launch::async, [&fsm]{
+        return fsm.process_event_async(events::toggle{}).get();
+    });
+    EXPECT_EQ(event_process_result::refuse, toggled.get())
+            << "The toggles posted by start were processed first";
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -0,0 +1,260 @@
+/*
+ * coroutine_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/coroutine.hpp>
+
+#ifdef AFSM_HAS_COROUTINES
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct start {};
+struct stop {};
+struct hold {};
+struct tick {};
+struct fail {};
+
+}  /* namespace events */
+
+namespace {
+
+using actions::event_process_result;
+
+/**
+ * Coroutine starting immediately, nobody waits for it
+ */
+struct detached {
+    struct promise_type {
+        detached
+        get_return_object() const noexcept
+        { return {}; }
+        ::std::suspend_never
+        initial_suspend() const noexcept
+        { return {}; }
+        ::std::suspend_never
+        final_suspend() const noexcept
+        { return {}; }
+        void
+        return_void() const noexcept {}
+        void
+        unhandled_exception() const
+        { ::std::terminate(); }
+    };
+};
+
+/**
+ * Resumes the coroutine in the worker thread
+ */
+struct resume_in_thread {
+    bool
+    await_ready() const noexcept
+    { return false; }
+    void
+    await_suspend(::std::coroutine_handle<> handle)
+    {
+        worker = ::std::thread{ [handle]{ handle.resume(); } };
+    }
+    void
+    await_resume() const noexcept {}
+
+    ::std::thread& worker;
+};
+
+struct coro_def : def::state_machine< coro_def > {
+    struct async_action {
+        template < typename Event, typename FSM, typename Source, typename Target >
+        task<>
+        operator()(Event&&, FSM& fsm, Source&, Target&) const
+        {
+            co_await resume_in_thread{ fsm.worker };
+            fsm.action_thread = ::std::this_thread::get_id();
+            fsm.side_effect = true;
+        }
+    };
+    struct async_guard {
+        template < typename FSM, typename State >
+        task<bool>
+        operator()(FSM const& fsm, State const&) const
+        {
+            co_return fsm.allow;
+        }
+    };
+    struct throwing_action {
+        template < typename FSM >
+        task<>
+        operator()(events::fail const&, FSM&) const
+        {
+            throw ::std::runtime_error{"fail"};
+            co_return;
+        }
+    };
+    struct hold_on {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::hold const&, FSM& fsm, Source&, Target&) const
+        {
+            fsm.holding = true;
+            while (!fsm.released)
+                ::std::this_thread::yield();
+        }
+    };
+    struct count_tick {
+        template < typename FSM >
+        void
+        operator()(events::tick const&, FSM& fsm) const
+        { ++fsm.ticks; }
+    };
+
+    struct idle : def::state<idle> {
+        using internal_transitions = def::transition_table<
+            def::internal_transition< events::hold, hold_on     >,
+            def::internal_transition< events::tick, count_tick  >,
+            def::internal_transition< events::fail, throwing_action >
+        >;
+    };
+    struct running : def::state<running> {
+        template < typename FSM >
+        void
+        on_enter(events::start const&, FSM& fsm)
+        { fsm.side_effect_on_enter = fsm.side_effect; }
+    };
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,      events::start,  running,    async_action,   async_guard >,
+        def::transition< running,   events::stop,   idle >
+    >;
+
+    ::std::thread               worker{};
+    ::std::thread::id           action_thread{};
+    bool                        allow{true};
+    bool                        side_effect{false};
+    bool                        side_effect_on_enter{false};
+    int                         ticks{0};
+    ::std::atomic<bool>         holding{false};
+    ::std::atomic<bool>         released{false};
+};
+
+using coro_fsm = state_machine< coro_def, ::std::mutex >;
+
+/**
+ * Rejects events when one is already queued
+ */
+struct bounded_coro_def : coro_def,
+        def::tags::event_queue_capacity<1, def::tags::reject_on_full_queue> {};
+
+using bounded_coro_fsm = state_machine< bounded_coro_def, ::std::mutex >;
+
+static_assert(actions::detail::is_awaited_result< task<bool> >::value, "");
+static_assert(!actions::detail::is_awaited_result< bool >::value, "");
+
+template < typename FSM >
+detached
+submit(FSM& fsm, event_process_result& res,
+        ::std::thread::id& resumed_in, ::std::atomic<bool>& done)
+{
+    res = co_await co_process_event(fsm, events::tick{});
+    resumed_in = ::std::this_thread::get_id();
+    done = true;
+}
+
+}  /* namespace  */
+
+TEST(Coroutine, ProcessIdle)
+{
+    coro_fsm fsm;
+    event_process_result res{event_process_result::refuse};
+    ::std::thread::id resumed_in{};
+    ::std::atomic<bool> done{false};
+    submit(fsm, res, resumed_in, done);
+    EXPECT_TRUE(done) << "The coroutine is not suspended";
+    EXPECT_EQ(event_process_result::process_in_state, res);
+    EXPECT_EQ(::std::this_thread::get_id(), resumed_in);
+    EXPECT_EQ(1, fsm.ticks);
+}
+
+TEST(Coroutine, ProcessBusy)
+{
+    coro_fsm fsm;
+    ::std::thread holder{ [&fsm]{ fsm.process_event(events::hold{}); } };
+    while (!fsm.holding)
+        ::std::this_thread::yield();
+
+    event_process_result res{event_process_result::refuse};
+    ::std::thread::id resumed_in{};
+    ::std::atomic<bool> done{false};
+    submit(fsm, res, resumed_in, done);
+    EXPECT_FALSE(done) << "The coroutine waits for the machine";
+    EXPECT_EQ(0, fsm.ticks);
+
+    fsm.released = true;
+    holder.join();
+    EXPECT_TRUE(done);
+    EXPECT_EQ(event_process_result::process_in_state, res);
+    EXPECT_NE(::std::this_thread::get_id(), resumed_in)
+            << "The coroutine is resumed by the dispatching thread";
+    EXPECT_EQ(1, fsm.ticks);
+}
+
+TEST(Coroutine, ProcessOverflow)
+{
+    bounded_coro_fsm fsm;
+    ::std::thread holder{ [&fsm]{ fsm.process_event(events::hold{}); } };
+    while (!fsm.holding)
+        ::std::this_thread::yield();
+    EXPECT_EQ(event_process_result::defer, fsm.process_event(events::tick{}));
+
+    event_process_result res{event_process_result::refuse};
+    ::std::thread::id resumed_in{};
+    ::std::atomic<bool> done{false};
+    submit(fsm, res, resumed_in, done);
+    EXPECT_TRUE(done) << "The rejected event completes the coroutine at once";
+    EXPECT_EQ(event_process_result::overflow, res);
+    EXPECT_EQ(::std::this_thread::get_id(), resumed_in);
+
+    fsm.released = true;
+    holder.join();
+    EXPECT_EQ(1, fsm.ticks);
+}
+
+TEST(Coroutine, Action)
+{
+    coro_fsm fsm;
+    EXPECT_EQ(event_process_result::process, fsm.process_event(events::start{}));
+    fsm.worker.join();
+    EXPECT_TRUE(fsm.is_in_state<coro_fsm::running>());
+    EXPECT_TRUE(fsm.side_effect_on_enter)
+            << "The action finishes before the target state is entered";
+    EXPECT_NE(::std::this_thread::get_id(), fsm.action_thread);
+}
+
+TEST(Coroutine, Guard)
+{
+    coro_fsm fsm;
+    fsm.allow = false;
+    EXPECT_EQ(event_process_result::refuse, fsm.process_event(events::start{}));
+    EXPECT_TRUE(fsm.is_in_state<coro_fsm::idle>());
+    EXPECT_FALSE(fsm.side_effect);
+}
+
+TEST(Coroutine, ActionThrows)
+{
+    coro_fsm fsm;
+    EXPECT_THROW(fsm.process_event(events::fail{}), ::std::runtime_error);
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
+
+#endif /* AFSM_HAS_COROUTINES */
@@ -0,0 +1,417 @@
+/*
+ * event_queue_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace {
+
+struct fake_fsm {
+    ::std::vector<int> processed{};
+};
+
+struct small_event {
+    int value;
+};
+
+struct large_event {
+    ::std::array<int, 32> payload;
+};
+
+struct ptr_event {
+    ::std::unique_ptr<int> value;
+};
+
+template < typename Event >
+actions::event_process_result
+record_event(fake_fsm& fsm, Event&& event)
+{
+    fsm.processed.push_back(event.payload[0]);
+    return actions::event_process_result::process;
+}
+
+actions::event_process_result
+record_small(fake_fsm& fsm, small_event&& event)
+{
+    fsm.processed.push_back(event.value);
+    return actions::event_process_result::process;
+}
+
+actions::event_process_result
+record_ptr(fake_fsm& fsm, ptr_event&& event)
+{
+    fsm.processed.push_back(*event.value);
+    return actions::event_process_result::process;
+}
+
+}  /* namespace  */
+
+using queue_item = detail::queued_event< fake_fsm, 16 >;
+
+static_assert(queue_item::is_inline<small_event>::value, "");
+static_assert(queue_item::is_inline<ptr_event>::value, "");
+static_assert(!queue_item::is_inline<large_event>::value, "");
+
+TEST(EventQueue, QueuedEvent)
+{
+    fake_fsm fsm{};
+    large_event large;
+    large.payload[0] = 42;
+
+    auto small = queue_item::create< small_event, &record_small >(small_event{ 1 }, 0);
+    auto ptr = queue_item::create< ptr_event, &record_ptr >(
+            ptr_event{ ::std::unique_ptr<int>{ new int{2} } }, 1);
+    auto heap = queue_item::create< large_event, &record_event<large_event> >(large, 2);
+
+    EXPECT_EQ(0ul, small.index());
+    EXPECT_EQ(1ul, ptr.index());
+    EXPECT_EQ(2ul, heap.index());
+
+    queue_item moved{ ::std::move(heap) };
+    EXPECT_TRUE(heap.empty());
+    EXPECT_FALSE(moved.empty());
+
+    small(fsm);
+    ptr(fsm);
+    moved(fsm);
+    EXPECT_EQ((::std::vector<int>{ 1, 2, 42 }), fsm.processed);
+}
+
+TEST(EventQueue, RingBuffer)
+{
+    detail::ring_buffer< queue_item > queue;
+    fake_fsm fsm{};
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0ul, queue.capacity());
+
+    for (int i = 0; i < 5; ++i) {
+        queue.push_back(queue_item::create< small_event, &record_small >(small_event{ i }, 0));
+    }
+    auto capacity = queue.capacity();
+    // Steady state push/pop with the head wrapping around
+    for (int i = 5; i < 100; ++i) {
+        queue.push_back(queue_item::create< small_event, &record_small >(small_event{ i }, 0));
+        queue.front()(fsm);
+        queue.pop_front();
+        EXPECT_EQ(5ul, queue.size());
+    }
+    EXPECT_EQ(capacity, queue.capacity());
+    // Grow with the head in the middle of the buffer
+    for (int i = 100; i < 120; ++i) {
+        queue.push_back(queue_item::create< small_event, &record_small >(small_event{ i }, 0));
+    }
+    EXPECT_LT(capacity, queue.capacity());
+    while (!queue.empty()) {
+        queue.front()(fsm);
+        queue.pop_front();
+    }
+    ASSERT_EQ(120ul, fsm.processed.size());
+    for (int i = 0; i < 120; ++i) {
+        EXPECT_EQ(i, fsm.processed[i]);
+    }
+}
+
+TEST(EventQueue, DeferredBuckets)
+{
+    using event_set = detail::event_set< ::psst::meta::type_tuple<
+            small_event, large_event, ptr_event > >;
+    using buckets_type = detail::deferred_event_buckets< queue_item, event_set >;
+    constexpr auto small_idx = event_set::index<small_event>();
+    constexpr auto large_idx = event_set::index<large_event>();
+    constexpr auto ptr_idx = event_set::index<ptr_event>();
+
+    buckets_type buckets;
+    fake_fsm fsm{};
+    large_event large;
+    large.payload[0] = 2;
+
+    buckets.push(queue_item::create< small_event, &record_small >(small_event{ 1 }, small_idx));
+    buckets.push(queue_item::create< large_event, &record_event<large_event> >(large, large_idx));
+    buckets.push(queue_item::create< small_event, &record_small >(small_event{ 3 }, small_idx));
+    buckets.push(queue_item::create< ptr_event, &record_ptr >(
+            ptr_event{ ::std::unique_ptr<int>{ new int{4} } }, ptr_idx));
+    EXPECT_FALSE(buckets.push(queue_item::create< small_event, &record_small >(
+            small_event{ 5 }, event_set::npos)));
+    EXPECT_EQ(4ul, buckets.size());
+    EXPECT_EQ(3ul, buckets.event_ids().size());
+
+    auto last = buckets.next_sequence();
+    auto mask = event_set::make(::psst::meta::type_tuple< small_event, large_event >{});
+    for (auto idx = buckets.oldest(mask, last); idx != buckets_type::npos;
+            idx = buckets.oldest(mask, last)) {
+        buckets.pop(idx)(fsm);
+    }
+    EXPECT_EQ((::std::vector<int>{ 1, 2, 3 }), fsm.processed);
+    EXPECT_EQ(1ul, buckets.size());
+    EXPECT_FALSE(buckets.event_ids().contains<small_event>());
+    EXPECT_TRUE(buckets.event_ids().contains<ptr_event>());
+
+    EXPECT_EQ(1ul, buckets.drop(buckets.event_ids()));
+    EXPECT_TRUE(buckets.empty());
+    EXPECT_TRUE(buckets.event_ids().empty());
+}
+
+TEST(EventQueue, PriorityBuckets)
+{
+    detail::priority_buckets< queue_item, int > queue;
+    fake_fsm fsm{};
+    // Priorities, each event's value is its push order
+    ::std::vector<int> priorities{ 0, 5, -3, 5, 0, 100, -3, 70, 0, 5 };
+    for (::std::size_t i = 0; i < priorities.size(); ++i) {
+        queue.push(priorities[i], queue_item::create< small_event, &record_small >(
+                small_event{ static_cast<int>(i) }, 0));
+    }
+    EXPECT_EQ(priorities.size(), queue.size());
+    EXPECT_EQ(100, queue.top_priority());
+    while (!queue.empty()) {
+        queue.top()(fsm);
+        queue.pop();
+    }
+    // Higher priority first, FIFO within a priority
+    EXPECT_EQ((::std::vector<int>{ 5, 7, 1, 3, 9, 0, 4, 8, 2, 6 }), fsm.processed);
+
+    // Buckets are reused, a new priority below the non-empty ones
+    fsm.processed.clear();
+    queue.push(5, queue_item::create< small_event, &record_small >(small_event{ 0 }, 0));
+    queue.push(-10, queue_item::create< small_event, &record_small >(small_event{ 1 }, 0));
+    queue.push(5, queue_item::create< small_event, &record_small >(small_event{ 2 }, 0));
+    EXPECT_EQ(5, queue.top_priority());
+    while (!queue.empty()) {
+        queue.top()(fsm);
+        queue.pop();
+    }
+    EXPECT_EQ((::std::vector<int>{ 0, 2, 1 }), fsm.processed);
+
+    // More priorities than bits in a bitmap word
+    fsm.processed.clear();
+    for (int i = 0; i < 200; ++i) {
+        auto priority = (i * 37) % 200;
+        queue.push(priority, queue_item::create< small_event, &record_small >(
+                small_event{ priority }, 0));
+    }
+    while (!queue.empty()) {
+        queue.top()(fsm);
+        queue.pop();
+    }
+    ASSERT_EQ(200ul, fsm.processed.size());
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(199 - i, fsm.processed[i]);
+    }
+
+    // Empty buckets are removed when a new priority comes, a stream of
+    // distinct priorities doesn't accumulate buckets
+    for (int i = 0; i < 1000; ++i) {
+        queue.push(1000 + i, queue_item::create< small_event, &record_small >(
+                small_event{ i }, 0));
+        queue.pop();
+        EXPECT_GE(queue.max_empty_buckets + 1, queue.bucket_count());
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(EventQueue, DeferredPriorityBuckets)
+{
+    using event_set = detail::event_set< ::psst::meta::type_tuple<
+            small_event, large_event, ptr_event > >;
+    using buckets_type = detail::deferred_priority_buckets< queue_item, event_set, int >;
+    constexpr auto small_idx = event_set::index<small_event>();
+    constexpr auto large_idx = event_set::index<large_event>();
+    constexpr auto ptr_idx = event_set::index<ptr_event>();
+
+    buckets_type buckets;
+    fake_fsm fsm{};
+    large_event large;
+    large.payload[0] = 2;
+
+    buckets.push(small_idx, 0, queue_item::create< small_event, &record_small >(
+            small_event{ 1 }, small_idx));
+    buckets.push(large_idx, 0, queue_item::create< large_event, &record_event<large_event> >(
+            large, large_idx));
+    buckets.push(small_idx, 1, queue_item::create< small_event, &record_small >(
+            small_event{ 3 }, small_idx));
+    buckets.push(ptr_idx, 5, queue_item::create< ptr_event, &record_ptr >(
+            ptr_event{ ::std::unique_ptr<int>{ new int{4} } }, ptr_idx));
+    EXPECT_FALSE(buckets.push(event_set::npos, 0, queue_item::create< small_event, &record_small >(
+            small_event{ 5 }, event_set::npos)));
+    EXPECT_EQ(4ul, buckets.size());
+
+    auto last = buckets.next_sequence();
+    auto mask = event_set::make(::psst::meta::type_tuple< small_event, large_event >{});
+    for (auto idx = buckets.top(mask, last); idx != buckets_type::npos;
+            idx = buckets.top(mask, last)) {
+        buckets.pop(idx)(fsm);
+    }
+    // Higher priority first, then in the order of deferral
+    EXPECT_EQ((::std::vector<int>{ 3, 1, 2 }), fsm.processed);
+    EXPECT_EQ(1ul, buckets.size());
+    EXPECT_TRUE(buckets.event_ids().contains<ptr_event>());
+
+    EXPECT_EQ(1ul, buckets.drop(buckets.event_ids()));
+    EXPECT_TRUE(buckets.empty());
+    EXPECT_TRUE(buckets.event_ids().empty());
+
+    // A younger event of another type with a higher priority goes first
+    fsm.processed.clear();
+    large.payload[0] = 7;
+    buckets.push(small_idx, 0, queue_item::create< small_event, &record_small >(
+            small_event{ 6 }, small_idx));
+    buckets.push(large_idx, 5, queue_item::create< large_event, &record_event<large_event> >(
+            large, large_idx));
+    buckets.push(small_idx, 0, queue_item::create< small_event, &record_small >(
+            small_event{ 8 }, small_idx));
+    last = buckets.next_sequence();
+    for (auto idx = buckets.top(mask, last); idx != buckets_type::npos;
+            idx = buckets.top(mask, last)) {
+        buckets.pop(idx)(fsm);
+    }
+    EXPECT_EQ((::std::vector<int>{ 7, 6, 8 }), fsm.processed);
+}
+
+TEST(EventQueue, MPSCQueue)
+{
+    constexpr int producer_count = 4;
+    constexpr int event_count = 10000;
+    detail::mpsc_queue< queue_item > queue;
+    fake_fsm fsm{};
+
+    ::std::vector< ::std::thread > producers;
+    for (int p = 0; p < producer_count; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < event_count; ++i) {
+                queue.push(queue_item::create< small_event, &record_small >(
+                        small_event{ p * event_count + i }, 0));
+            }
+        });
+    }
+    queue_item item;
+    while (fsm.processed.size() < producer_count * event_count) {
+        if (queue.try_pop(item))
+            item(fsm);
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    EXPECT_FALSE(queue.try_pop(item));
+
+    // Events from one producer keep their order
+    ::std::vector<int> last(producer_count, -1);
+    for (auto v : fsm.processed) {
+        EXPECT_LT(last[v / event_count], v);
+        last[v / event_count] = v;
+    }
+}
+
+namespace {
+
+namespace events {
+struct tick {};
+struct stop {};
+struct low {};
+struct high {};
+}  /* namespace events */
+
+struct count_tick {
+    template < typename FSM >
+    void
+    operator()(events::tick const&, FSM& fsm) const
+    { ++fsm.ticks; }
+};
+
+struct lock_free_fsm_def
+    : def::state_machine_def< lock_free_fsm_def, def::tags::lock_free_event_queue > {
+    struct idle : state<idle> {};
+    struct done : state<done> {};
+    using initial_state = idle;
+    using internal_transitions = transition_table<
+        in< events::tick, count_tick >
+    >;
+    using transitions = transition_table<
+        tr< idle, events::stop, done >
+    >;
+
+    ::std::size_t ticks{0};
+};
+
+using lock_free_fsm = state_machine< lock_free_fsm_def, ::std::mutex >;
+
+struct record_priority {
+    template < typename FSM >
+    void
+    operator()(events::low const&, FSM& fsm) const
+    { fsm.replayed.push_back(0); }
+    template < typename FSM >
+    void
+    operator()(events::high const&, FSM& fsm) const
+    { fsm.replayed.push_back(5); }
+};
+
+/**
+ * Idle defers the events, done handles them
+ */
+struct priority_defer_def : def::state_machine_def< priority_defer_def > {
+    struct idle : state<idle> {
+        using deferred_events = type_tuple< events::low, events::high >;
+    };
+    struct done : state<done> {
+        using internal_transitions = transition_table<
+            in< events::low,  record_priority >,
+            in< events::high, record_priority >
+        >;
+    };
+    using initial_state = idle;
+    using transitions = transition_table<
+        tr< idle, events::stop, done >
+    >;
+
+    ::std::vector<int> replayed{};
+};
+
+}  /* namespace  */
+
+TEST(EventQueue, LockFreeMachine)
+{
+    constexpr int producer_count = 4;
+    constexpr int event_count = 10000;
+    lock_free_fsm fsm;
+
+    ::std::vector< ::std::thread > producers;
+    for (int p = 0; p < producer_count; ++p) {
+        producers.emplace_back([&fsm]() {
+            for (int i = 0; i < event_count; ++i) {
+                fsm.process_event(events::tick{});
+            }
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    EXPECT_EQ(::std::size_t(producer_count * event_count),
+            fsm.ticks);
+}
+
+TEST(EventQueue, PriorityMachineDeferredOrder)
+{
+    priority_state_machine< priority_defer_def > fsm;
+    fsm.process_event(events::low{}, 0);
+    fsm.process_event(events::high{}, 5);
+    fsm.process_event(events::low{}, 0);
+    fsm.process_event(events::stop{});
+    EXPECT_TRUE(fsm.is_in_state< priority_defer_def::done >());
+    // Higher priority first, then in the order of deferral
+    EXPECT_EQ((::std::vector<int>{ 5, 0, 0 }), fsm.replayed);
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -0,0 +1,103 @@
+/*
+ * event_set_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/detail/event_identity.hpp>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace {
+
+template < ::std::size_t N >
+struct numbered_event {};
+
+template < typename T >
+struct make_many_events;
+
+template < ::std::size_t ... Indexes >
+struct make_many_events< ::psst::meta::indexes_tuple<Indexes...> > {
+    using type = ::psst::meta::type_tuple< numbered_event<Indexes>... >;
+};
+
+struct unknown_event {};
+
+}  /* namespace  */
+
+using small_set = detail::event_set<
+        ::psst::meta::type_tuple< numbered_event<0>, numbered_event<1>, numbered_event<2> > >;
+using large_set = detail::event_set<
+        make_many_events< ::psst::meta::index_builder<100>::type >::type >;
+
+static_assert(small_set::word_count == 1, "");
+static_assert(large_set::word_count == 2, "");
+static_assert(small_set::index<numbered_event<2>>() == 2, "");
+static_assert(small_set::index<unknown_event>() == small_set::npos, "");
+
+TEST(EventSet, Basic)
+{
+    small_set evts;
+    EXPECT_TRUE(evts.empty());
+    EXPECT_EQ(0ul, evts.size());
+
+    evts.insert<numbered_event<1>>();
+    evts.insert<unknown_event>();
+    EXPECT_FALSE(evts.empty());
+    EXPECT_EQ(1ul, evts.size());
+    EXPECT_TRUE(evts.contains<numbered_event<1>>());
+    EXPECT_FALSE(evts.contains<numbered_event<0>>());
+    EXPECT_FALSE(evts.contains<unknown_event>());
+    EXPECT_EQ(1ul, evts.count(&detail::event<numbered_event<1>>::id));
+    EXPECT_EQ(0ul, evts.count(&detail::event<numbered_event<2>>::id));
+    EXPECT_EQ(0ul, evts.count(&detail::event<unknown_event>::id));
+
+    evts.clear();
+    EXPECT_TRUE(evts.empty());
+}
+
+TEST(EventSet, SetOperations)
+{
+    auto lhs = large_set::make(::psst::meta::type_tuple<
+            numbered_event<0>, numbered_event<64>, numbered_event<99>, unknown_event >{});
+    auto rhs = large_set::make(::psst::meta::type_tuple<
+            numbered_event<1>, numbered_event<99> >{});
+    EXPECT_EQ(3ul, lhs.size());
+    EXPECT_TRUE(lhs.intersects(rhs));
+
+    auto both = lhs & rhs;
+    EXPECT_EQ(1ul, both.size());
+    EXPECT_TRUE(both.contains<numbered_event<99>>());
+
+    auto any = lhs | rhs;
+    EXPECT_EQ(4ul, any.size());
+    EXPECT_NE(any, lhs);
+
+    rhs.reset(large_set::index<numbered_event<99>>());
+    EXPECT_FALSE(lhs.intersects(rhs));
+}
+
+TEST(EventSet, Iterate)
+{
+    auto evts = large_set::make(::psst::meta::type_tuple<
+            numbered_event<0>, numbered_event<63>, numbered_event<64>, numbered_event<99> >{});
+    ::std::vector< ::std::size_t > indexes;
+    for (auto idx = evts.next(); idx != large_set::npos; idx = evts.next(idx + 1)) {
+        indexes.push_back(idx);
+    }
+    EXPECT_EQ((::std::vector< ::std::size_t >{ 0, 63, 64, 99 }), indexes);
+    EXPECT_EQ(large_set::npos, large_set{}.next());
+
+    auto rest = evts - large_set::make(::psst::meta::type_tuple<
+            numbered_event<0>, numbered_event<64> >{});
+    EXPECT_EQ(2ul, rest.size());
+    EXPECT_EQ(63ul, rest.next());
+    EXPECT_EQ(99ul, rest.next(64));
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -0,0 +1,118 @@
+/*
+ * exception_safety_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <stdexcept>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct go {};
+struct fail {};
+
+}  /* namespace events */
+
+namespace {
+
+struct throwing_action {
+    template < typename FSM, typename Source, typename Target >
+    void
+    operator()(events::fail const&, FSM&, Source& source, Target& target) const
+    {
+        source.data.push_back(1);
+        target.data.push_back(1);
+        throw ::std::runtime_error{"Transition failed"};
+    }
+};
+
+template < typename ... Tags >
+struct safety_fsm_def : def::state_machine_def< safety_fsm_def<Tags...>, Tags... > {
+    struct source : def::state<source> {
+        ::std::vector<int> data{ 1, 2, 3 };
+    };
+    /**
+     * State with a snapshot, only the size of the data is saved
+     */
+    struct target : def::state<target> {
+        ::std::size_t
+        snapshot() const
+        { return data.size(); }
+        void
+        restore(::std::size_t size)
+        {
+            data.resize(size);
+            ++restore_count;
+        }
+
+        ::std::vector<int> data{ 4, 5 };
+        ::std::size_t restore_count{0};
+    };
+
+    using initial_state = source;
+    using transitions = def::transition_table<
+        def::transition< source, events::go,   target                      >,
+        def::transition< source, events::fail, target, throwing_action     >,
+        def::transition< target, events::go,   source                      >
+    >;
+};
+
+using strong_fsm = state_machine< safety_fsm_def< def::tags::strong_exception_safety > >;
+using nothrow_fsm = state_machine< safety_fsm_def< def::tags::nothrow_guarantee > >;
+using strong_priority_fsm = priority_state_machine<
+        safety_fsm_def< def::tags::strong_exception_safety > >;
+
+using strong_source = strong_fsm::substate_type< safety_fsm_def< def::tags::strong_exception_safety >::source >;
+using strong_target = strong_fsm::substate_type< safety_fsm_def< def::tags::strong_exception_safety >::target >;
+
+}  /* namespace  */
+
+static_assert(!transitions::detail::has_snapshot<strong_source>::value, "");
+static_assert(transitions::detail::has_snapshot<strong_target>::value, "");
+
+TEST(ExceptionSafety, Strong)
+{
+    using def_type = safety_fsm_def< def::tags::strong_exception_safety >;
+    strong_fsm fsm;
+    EXPECT_THROW(fsm.process_event(events::fail{}), ::std::runtime_error);
+    EXPECT_TRUE(fsm.is_in_state< def_type::source >());
+    EXPECT_EQ((::std::vector<int>{ 1, 2, 3 }), fsm.get_state< def_type::source >().data);
+    EXPECT_EQ((::std::vector<int>{ 4, 5 }), fsm.get_state< def_type::target >().data);
+    EXPECT_EQ(1ul, fsm.get_state< def_type::target >().restore_count);
+
+    EXPECT_EQ(actions::event_process_result::process, fsm.process_event(events::go{}));
+    EXPECT_TRUE(fsm.is_in_state< def_type::target >());
+    EXPECT_EQ(1ul, fsm.get_state< def_type::target >().restore_count);
+}
+
+TEST(ExceptionSafety, Nothrow)
+{
+    using def_type = safety_fsm_def< def::tags::nothrow_guarantee >;
+    nothrow_fsm fsm;
+    EXPECT_EQ(actions::event_process_result::refuse, fsm.process_event(events::fail{}));
+    EXPECT_TRUE(fsm.is_in_state< def_type::source >());
+    EXPECT_EQ((::std::vector<int>{ 1, 2, 3 }), fsm.get_state< def_type::source >().data);
+    EXPECT_EQ((::std::vector<int>{ 4, 5 }), fsm.get_state< def_type::target >().data);
+}
+
+TEST(ExceptionSafety, PriorityMachineStaysUsable)
+{
+    using def_type = safety_fsm_def< def::tags::strong_exception_safety >;
+    strong_priority_fsm fsm;
+    EXPECT_THROW(fsm.process_event(events::fail{}), ::std::runtime_error);
+    EXPECT_TRUE(fsm.is_in_state< def_type::source >());
+
+    // The machine is not left busy, the event is processed immediately
+    EXPECT_EQ(actions::event_process_result::process, fsm.process_event(events::go{}));
+    EXPECT_TRUE(fsm.is_in_state< def_type::target >());
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
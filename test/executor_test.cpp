@@ -0,0 +1,167 @@
+/*
+ * executor_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/executor.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct ping {};
+struct stop {};
+struct fail {};
+
+}  /* namespace events */
+
+namespace {
+
+struct session_def : def::state_machine<session_def> {
+    session_def(::std::atomic<int>& pings, ::std::atomic<int>& sessions)
+        : pings_{&pings}, sessions_{&sessions}
+    {
+        ++*sessions_;
+    }
+    session_def(session_def const&) = delete;
+    session_def&
+    operator = (session_def const&) = delete;
+    ~session_def()
+    {
+        --*sessions_;
+    }
+
+    struct count_ping {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::ping const&, FSM& fsm, Source&, Target&) const
+        {
+            ++*fsm.pings_;
+        }
+    };
+
+    struct throw_error {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::fail const&, FSM&, Source&, Target&) const
+        {
+            throw ::std::runtime_error{"session failed"};
+        }
+    };
+
+    struct active : state<active> {};
+    struct stopped : state<stopped> {};
+
+    using initial_state = active;
+    using transitions = transition_table<
+        tr< active, events::ping,   active,     count_ping  >,
+        tr< active, events::stop,   stopped                 >,
+        tr< active, events::fail,   active,     throw_error >
+    >;
+
+    ::std::atomic<int>* pings_;
+    ::std::atomic<int>* sessions_;
+};
+
+using session_fsm = state_machine<session_def>;
+using session_executor = executor<session_fsm>;
+
+}  /* namespace  */
+
+TEST(Executor, DeliverEvents)
+{
+    ::std::atomic<int> pings{0};
+    ::std::atomic<int> sessions{0};
+    {
+        session_executor exec{4};
+        EXPECT_EQ(4ul, exec.workers());
+        for (auto i = 0; i < 100; ++i)
+            exec.spawn(i, pings, sessions);
+        for (auto i = 0; i < 100; ++i)
+            exec.post(i, events::ping{});
+        exec.post(1000, events::ping{});    // Unknown machine
+        exec.wait_idle();
+        EXPECT_EQ(100, pings);
+        EXPECT_EQ(100, sessions);
+
+        for (auto i = 0; i < 50; ++i)
+            exec.post(i, events::stop{});
+        for (auto i = 0; i < 100; ++i)
+            exec.post(i, events::ping{});
+        exec.wait_idle();
+        EXPECT_EQ(150, pings) << "Stopped sessions refuse pings";
+
+        for (auto i = 0; i < 10; ++i)
+            exec.remove(i);
+        exec.wait_idle();
+        EXPECT_EQ(90, sessions);
+    }
+    EXPECT_EQ(0, sessions) << "Machines are destroyed with the executor";
+}
+
+TEST(Executor, ConcurrentProducers)
+{
+    ::std::atomic<int> pings{0};
+    ::std::atomic<int> sessions{0};
+    int const machine_count = 64;
+    int const thread_count = 4;
+    int const event_count = 1000;
+
+    session_executor exec{3};
+    for (auto i = 0; i < machine_count; ++i)
+        exec.spawn(i, pings, sessions);
+
+    ::std::vector< ::std::thread > producers;
+    for (auto t = 0; t < thread_count; ++t) {
+        producers.emplace_back([&exec, machine_count, event_count]{
+            for (auto i = 0; i < event_count; ++i)
+                exec.post(i % machine_count, events::ping{});
+        });
+    }
+    for (auto& t : producers)
+        t.join();
+    exec.stop();
+    EXPECT_EQ(thread_count * event_count, pings)
+            << "Stop handles all posted events";
+    EXPECT_EQ(0, sessions);
+}
+
+TEST(Executor, MachineThrows)
+{
+    ::std::atomic<int> pings{0};
+    ::std::atomic<int> sessions{0};
+    ::std::mutex mutex;
+    ::std::vector< session_executor::id_type > failed;
+    {
+        session_executor exec{2, session_executor::default_batch_size,
+            [&](session_executor::id_type const& id, ::std::exception_ptr error) {
+                ::std::lock_guard< ::std::mutex > lock{mutex};
+                failed.push_back(id);
+                EXPECT_THROW(::std::rethrow_exception(error), ::std::runtime_error);
+            }};
+        for (auto i = 0; i < 4; ++i)
+            exec.spawn(i, pings, sessions);
+        exec.post(1, events::fail{});
+        exec.post(2, events::fail{});
+        for (auto i = 0; i < 4; ++i)
+            exec.post(i, events::ping{});
+        exec.wait_idle();
+        EXPECT_EQ(4, pings) << "Workers go on after an exception";
+        EXPECT_EQ(4, sessions);
+    }
+    ::std::sort(failed.begin(), failed.end());
+    EXPECT_EQ((::std::vector< session_executor::id_type >{1, 2}), failed);
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
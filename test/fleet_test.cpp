@@ -0,0 +1,182 @@
+/*
+ * fleet_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fleet.hpp>
+#include <memory>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace {
+
+namespace events {
+
+struct start {};
+struct tick {};
+struct timeout {};
+struct reset {};
+
+}  /* namespace events */
+
+/**
+ * Idle timers defer the timeout, a running timer counts ticks
+ */
+struct timer_def : def::state_machine< timer_def > {
+    struct count_tick {
+        template < typename FSM, typename Source, typename Target >
+        void
+        operator()(events::tick const&, FSM& fsm, Source&, Target&) const
+        {
+            ++fsm.ticks;
+        }
+    };
+
+    struct idle : def::state<idle> {
+        using deferred_events = ::psst::meta::type_tuple< events::timeout >;
+    };
+    struct running : def::state<running> {
+        using internal_transitions = def::transition_table<
+            def::internal_transition< events::tick, count_tick >
+        >;
+    };
+    struct expired : def::state<expired> {};
+
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,      events::start,      running >,
+        def::transition< running,   events::timeout,    expired >,
+        def::transition< expired,   events::reset,      idle    >
+    >;
+
+    int ticks = 0;
+};
+
+using timer_fsm = state_machine< timer_def >;
+using timer_fleet = fleet< timer_fsm >;
+
+struct rejecting_def : def::state_machine< rejecting_def > {
+    struct a : def::state<a> {};
+    struct b : def::state<b> {};
+
+    using initial_state = a;
+    using transitions = def::transition_table<
+        def::transition< a, events::start, b >,
+        def::transition< b, events::tick,  a >
+    >;
+
+    template < typename Event, typename FSM >
+    actions::event_process_result
+    reject_event(Event&&, FSM&)
+    {
+        ++rejected;
+        return actions::event_process_result::refuse;
+    }
+
+    int rejected = 0;
+};
+
+using rejecting_fsm = state_machine< rejecting_def >;
+
+template < typename Event >
+::std::size_t
+process_all(::std::vector< ::std::unique_ptr<timer_fsm> >& machines, Event const& event)
+{
+    ::std::size_t res = 0;
+    for (auto& m : machines) {
+        if (m->process_event(event) != actions::event_process_result::refuse)
+            ++res;
+    }
+    return res;
+}
+
+void
+expect_same(timer_fleet const& timers,
+        ::std::vector< ::std::unique_ptr<timer_fsm> > const& machines)
+{
+    ASSERT_EQ(machines.size(), timers.size());
+    for (::std::size_t n = 0; n < timers.size(); ++n) {
+        EXPECT_EQ(machines[n]->current_state(), timers.current_state(n)) << n;
+        EXPECT_EQ(machines[n]->current_state(), timers[n].current_state()) << n;
+        EXPECT_EQ(machines[n]->ticks, timers[n].ticks) << n;
+    }
+}
+
+}  /* namespace  */
+
+TEST(Fleet, BroadcastMatchesStandalone)
+{
+    timer_fleet timers;
+    ::std::vector< ::std::unique_ptr<timer_fsm> > machines;
+    for (auto n = 0; n < 100; ++n) {
+        EXPECT_EQ((::std::size_t)n, timers.emplace_back());
+        machines.emplace_back(new timer_fsm{});
+    }
+    EXPECT_EQ(100ul, timers.count_in_state< timer_def::idle >());
+
+    for (::std::size_t n = 0; n < timers.size(); n += 3) {
+        EXPECT_EQ(machines[n]->process_event(events::start{}),
+                timers.process_event(n, events::start{}));
+    }
+    expect_same(timers, machines);
+    EXPECT_EQ(34ul, timers.count_in_state< timer_def::running >());
+
+    EXPECT_EQ(process_all(machines, events::tick{}), timers.broadcast(events::tick{}));
+    expect_same(timers, machines);
+    // Idle timers defer the timeout
+    EXPECT_EQ(process_all(machines, events::timeout{}), timers.broadcast(events::timeout{}));
+    expect_same(timers, machines);
+    EXPECT_EQ(34ul, timers.count_in_state< timer_def::expired >());
+    // Deferred timeouts are processed right after the start
+    EXPECT_EQ(process_all(machines, events::start{}), timers.broadcast(events::start{}));
+    expect_same(timers, machines);
+    EXPECT_EQ(100ul, timers.count_in_state< timer_def::expired >());
+
+    EXPECT_EQ(0ul, timers.broadcast(events::tick{}));
+    EXPECT_EQ(100ul, timers.broadcast(events::reset{}));
+    EXPECT_EQ(100ul, timers.count_in_state< timer_def::idle >());
+}
+
+TEST(Fleet, BroadcastSubset)
+{
+    timer_fleet timers;
+    timers.reserve(10);
+    for (auto n = 0; n < 10; ++n)
+        timers.emplace_back();
+    ::std::vector< ::std::size_t > odd{ 1, 3, 5, 7, 9 };
+    EXPECT_EQ(5ul, timers.broadcast(odd.begin(), odd.end(), events::start{}));
+    EXPECT_EQ(5ul, timers.count_in_state< timer_def::running >());
+
+    ::std::vector< ::std::size_t > some{ 0, 1, 1, 2, 3 };
+    // Idle instances refuse ticks, instance 1 gets two
+    EXPECT_EQ(3ul, timers.broadcast(some.begin(), some.end(), events::tick{}));
+    EXPECT_EQ(0, timers[0].ticks);
+    EXPECT_EQ(2, timers[1].ticks);
+    EXPECT_EQ(1, timers[3].ticks);
+    EXPECT_EQ(0, timers[5].ticks);
+
+    for (::std::size_t n = 0; n < timers.size(); ++n) {
+        EXPECT_EQ(timers[n].current_state(), timers.current_states()[n]);
+    }
+}
+
+TEST(Fleet, RejectIsNotSkipped)
+{
+    fleet< rejecting_fsm > machines;
+    for (auto n = 0; n < 5; ++n)
+        machines.emplace_back();
+    machines.process_event(2, events::start{});
+    // Instances in the initial state refuse the tick
+    EXPECT_EQ(1ul, machines.broadcast(events::tick{}));
+    for (::std::size_t n = 0; n < machines.size(); ++n) {
+        EXPECT_EQ(n == 2 ? 0 : 1, machines[n].rejected) << n;
+    }
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -0,0 +1,188 @@
+/*
+ * footprint_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <cstdint>
+#include <mutex>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct next {};
+template < int N >
+struct wide {};
+
+}  /* namespace events */
+
+namespace {
+
+struct small_def : def::state_machine< small_def > {
+    struct a : def::state<a>, def::tags::no_enclosing_fsm_pointer {};
+    struct b : def::state<b>, def::tags::no_enclosing_fsm_pointer {};
+    struct c : def::state<c>, def::tags::no_enclosing_fsm_pointer {};
+    struct inner : def::state_machine<inner> {
+        struct x : def::state<x>, def::tags::no_enclosing_fsm_pointer {};
+        struct y : def::state<y>, def::tags::no_enclosing_fsm_pointer {};
+        using initial_state = x;
+        using transitions = def::transition_table<
+            def::transition< x, events::next, y >
+        >;
+    };
+    using initial_state = a;
+    using transitions = def::transition_table<
+        def::transition< a,     events::next, b     >,
+        def::transition< b,     events::next, c     >,
+        def::transition< c,     events::next, inner >
+    >;
+};
+
+struct pointer_def : def::state_machine< pointer_def > {
+    struct a : def::state<a> {};
+    struct inner : def::state_machine<inner> {
+        struct x : def::state<x> {};
+        struct y : def::state<y> {};
+        using initial_state = x;
+        using transitions = def::transition_table<
+            def::transition< x, events::next, y >
+        >;
+    };
+    using initial_state = a;
+    using transitions = def::transition_table<
+        def::transition< a,     events::next, inner >
+    >;
+};
+
+template < typename Deferred >
+struct wide_def : def::state_machine< wide_def<Deferred> > {
+    struct a : def::state<a> {
+        using deferred_events = Deferred;
+    };
+    struct b : def::state<b> {};
+    using initial_state = a;
+    template < int N >
+    using in = def::internal_transition< events::wide<N> >;
+    using internal_transitions = def::transition_table<
+        in< 0>, in< 1>, in< 2>, in< 3>, in< 4>, in< 5>, in< 6>, in< 7>,
+        in< 8>, in< 9>, in<10>, in<11>, in<12>, in<13>, in<14>, in<15>,
+        in<16>, in<17>, in<18>, in<19>, in<20>, in<21>, in<22>, in<23>
+    >;
+    using transitions = def::transition_table<
+        def::transition< a,     events::next, b     >
+    >;
+};
+
+struct narrow_def : def::state_machine< narrow_def > {
+    struct a : def::state<a> {};
+    struct b : def::state<b> {};
+    using initial_state = a;
+    using internal_transitions = def::transition_table<
+        def::internal_transition< events::wide<0> >
+    >;
+    using transitions = def::transition_table<
+        def::transition< a,     events::next, b     >
+    >;
+};
+
+using small_fsm = state_machine< small_def >;
+using pointer_fsm = state_machine< pointer_def >;
+using locked_fsm = state_machine< small_def, ::std::mutex >;
+using small_inner = small_fsm::substate_type< small_def::inner >;
+using small_leaf = small_fsm::substate_type< small_def::a >;
+
+static_assert(::std::is_same<
+            small_fsm::transition_tuple::index_type, ::std::uint8_t >::value,
+        "Index of a few states is a byte");
+static_assert(::std::is_same<
+            locked_fsm::transition_tuple::index_type, ::std::atomic< ::std::uint8_t > >::value,
+        "Index of a locked machine is atomic");
+static_assert(::std::is_same<
+            detail::state_index_value<0x100>::type, ::std::uint16_t >::value, "");
+static_assert(::std::is_same<
+            detail::state_index_value<0x10000>::type, ::std::uint32_t >::value, "");
+
+static_assert(sizeof(small_leaf) < sizeof(void*),
+        "A tagged state doesn't keep a pointer to the enclosing machine");
+static_assert(::std::is_empty<small_leaf>::value,
+        "A state without an activity takes no space for the activity runner");
+static_assert(sizeof(pointer_fsm::substate_type< pointer_def::a >) >= sizeof(void*),
+        "A state keeps a pointer to the enclosing machine by default");
+
+using wide_fsm = state_machine< wide_def<void> >;
+using wide_defer_fsm = state_machine< wide_def< ::psst::meta::type_tuple< events::wide<0> > > >;
+using narrow_fsm = state_machine< narrow_def >;
+using wide_event_set = wide_fsm::event_set;
+
+static_assert(wide_event_set::capacity == 25, "");
+static_assert(sizeof(detail::deferred_event_buckets<
+                int, wide_event_set, ::psst::meta::type_tuple<> >)
+            <= sizeof(wide_event_set) + 3 * sizeof(::std::uint64_t),
+        "No deferrable events, no buckets");
+static_assert(sizeof(wide_fsm) == sizeof(narrow_fsm),
+        "A machine that doesn't defer events doesn't pay for the events it handles");
+static_assert(sizeof(wide_defer_fsm) <= sizeof(wide_fsm) + sizeof(detail::ring_buffer<int>),
+        "A machine pays for the deferrable events only");
+static_assert(sizeof(priority_state_machine< wide_def<void> >)
+            == sizeof(priority_state_machine< narrow_def >),
+        "A priority machine that doesn't defer events doesn't pay for the events it handles");
+static_assert(sizeof(priority_state_machine< wide_def< ::psst::meta::type_tuple< events::wide<0> > > >)
+            <= sizeof(priority_state_machine< wide_def<void> >)
+                + sizeof(detail::priority_buckets< int, int >),
+        "A priority machine pays for the deferrable events only");
+
+constexpr auto small_footprint = memory_footprint<small_fsm>();
+static_assert(small_footprint.machine == sizeof(small_fsm), "");
+static_assert(small_footprint.state_index == 1, "");
+static_assert(small_footprint.state_count == 4, "");
+
+}  /* namespace  */
+
+TEST(Footprint, InnerStates)
+{
+    auto const inner = memory_footprint<small_inner>();
+    EXPECT_EQ(sizeof(small_inner), inner.machine);
+    EXPECT_EQ(2ul, inner.state_count);
+    EXPECT_EQ(1ul, inner.state_index);
+    // Three leaf states fit in the padding of the inner machine
+    EXPECT_LE(small_footprint.inner_states,
+            sizeof(small_inner) + alignof(small_inner));
+    EXPECT_LE(inner.machine, 4 * sizeof(void*))
+            << "Inner machine keeps two pointers, the index and the states";
+}
+
+TEST(Footprint, Transitions)
+{
+    small_fsm fsm;
+    fsm.process_event(events::next{});
+    fsm.process_event(events::next{});
+    fsm.process_event(events::next{});
+    EXPECT_TRUE(fsm.is_in_state< small_def::inner >());
+    fsm.process_event(events::next{});
+    EXPECT_TRUE(fsm.is_in_state< small_def::inner::y >());
+}
+
+TEST(Footprint, EnclosingFsmPointer)
+{
+    pointer_fsm fsm;
+    auto& a = fsm.get_state< pointer_def::a >();
+    EXPECT_EQ(&fsm, &a.enclosing_fsm());
+    EXPECT_EQ(&fsm, &root_machine(a));
+
+    pointer_fsm copy{fsm};
+    EXPECT_EQ(&copy, &copy.get_state< pointer_def::a >().enclosing_fsm());
+
+    fsm.process_event(events::next{});
+    auto const& x = fsm.get_state< pointer_def::inner >()
+            .get_state< pointer_def::inner::x >();
+    EXPECT_EQ(&fsm.get_state< pointer_def::inner >(), &x.enclosing_fsm());
+    EXPECT_EQ(&fsm, &root_machine(x));
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
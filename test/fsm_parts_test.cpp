@@ -81,11 +81,11 @@ TEST(FSM, InnerStateTransitions)
     none n;
     test_state ts{n};
     EXPECT_EQ("none", ts.value);
-    EXPECT_EQ(actions::event_process_result::process_in_state, ts.process_event(event_a{}));
+    EXPECT_EQ(actions::event_process_result::process_in_state, ts.process_event(n, event_a{}));
     EXPECT_EQ("a", ts.value);
-    EXPECT_EQ(actions::event_process_result::process_in_state, ts.process_event(event_b{}));
+    EXPECT_EQ(actions::event_process_result::process_in_state, ts.process_event(n, event_b{}));
     EXPECT_EQ("b", ts.value);
-    EXPECT_EQ(actions::event_process_result::process_in_state, ts.process_event(event_c{}));
+    EXPECT_EQ(actions::event_process_result::process_in_state, ts.process_event(n, event_c{}));
     EXPECT_EQ("c", ts.value);
 }
 
@@ -190,14 +190,14 @@ TEST(FSM, InnerEventDispatch)
     test_sm tsm{n};
     EXPECT_EQ("none", tsm.value);
     EXPECT_EQ(test_sm::initial_state_index, tsm.current_state());
-    EXPECT_EQ(actions::event_process_result::process_in_state, tsm.process_event(inner_event{}));
+    EXPECT_EQ(actions::event_process_result::process_in_state, tsm.process_event(n, inner_event{}));
     EXPECT_EQ("in_a", tsm.value);
-    EXPECT_EQ(actions::event_process_result::process, tsm.process_event(event_ab{}));
+    EXPECT_EQ(actions::event_process_result::process, tsm.process_event(n, event_ab{}));
     EXPECT_NE(test_sm::initial_state_index, tsm.current_state());
-    EXPECT_EQ(actions::event_process_result::process_in_state, tsm.process_event(inner_event{}));
+    EXPECT_EQ(actions::event_process_result::process_in_state, tsm.process_event(n, inner_event{}));
     EXPECT_EQ("in_b", tsm.value);
-    EXPECT_EQ(actions::event_process_result::process, tsm.process_event(event_bca{}));
-    EXPECT_EQ(actions::event_process_result::process_in_state, tsm.process_event(inner_event{}));
+    EXPECT_EQ(actions::event_process_result::process, tsm.process_event(n, event_bca{}));
+    EXPECT_EQ(actions::event_process_result::process_in_state, tsm.process_event(n, inner_event{}));
 }
 
 }  /* namespace b */
@@ -76,6 +76,14 @@ static_assert(def::contains_substate<ortho_fsm, ortho_fsm::on>::value, "");
 static_assert(def::contains_substate<ortho_fsm, ortho_fsm::on::work>::value, "");
 static_assert(def::contains_substate<ortho_fsm, ortho_fsm::on::error>::value, "");
 
+// Events are dispatched only to the regions that can handle them
+using work_regions = work_fsm::region_tuple;
+static_assert(work_regions::accepting_regions<events::do_work>::count == 1, "");
+static_assert(work_regions::accepting_regions<events::do_work>::first == 0, "");
+static_assert(work_regions::accepting_regions<events::error const&>::count == 1, "");
+static_assert(work_regions::accepting_regions<events::error const&>::first == 1, "");
+static_assert(work_regions::accepting_regions<events::power_on>::count == 0, "");
+
 TEST(OrthogonalRegions, Simple)
 {
     ortho_fsm fsm;
@@ -103,5 +111,17 @@ TEST(OrthogonalRegions, Simple)
     EXPECT_TRUE(fsm.is_in_state<ortho_fsm::on::error::yes>());
 }
 
+TEST(OrthogonalRegions, RegionFilter)
+{
+    work_fsm fsm;
+    EXPECT_TRUE(done(fsm.process_event(events::do_work{})));
+    EXPECT_TRUE(fsm.is_in_state<work_fsm::work::state_b>());
+    EXPECT_TRUE(fsm.is_in_state<work_fsm::error::no>());
+    events::error err;
+    EXPECT_TRUE(done(fsm.process_event(err)));
+    EXPECT_TRUE(fsm.is_in_state<work_fsm::work::state_b>());
+    EXPECT_TRUE(fsm.is_in_state<work_fsm::error::yes>());
+}
+
 }  /* namespace test */
 }  /* namespace afsm */
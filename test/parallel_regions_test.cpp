@@ -0,0 +1,163 @@
+/*
+ * parallel_regions_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct power_on {};
+struct power_off {};
+struct work {};
+struct fail {};
+
+}  /* namespace events */
+
+namespace {
+
+/**
+ * Runs every task in a new thread, joins them on destruction. Throws
+ * when the number of posted tasks reaches the limit.
+ */
+class thread_per_task {
+public:
+    thread_per_task() = default;
+    thread_per_task(thread_per_task const&) = delete;
+    thread_per_task&
+    operator = (thread_per_task const&) = delete;
+    ~thread_per_task()
+    {
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    template < typename Task >
+    void
+    post(Task&& task)
+    {
+        if (posted == limit)
+            throw ::std::length_error{"Too many tasks"};
+        ++posted;
+        threads_.emplace_back(::std::forward<Task>(task));
+    }
+
+    ::std::size_t posted{0};
+    ::std::size_t limit{static_cast< ::std::size_t >(-1)};
+private:
+    ::std::vector< ::std::thread > threads_{};
+};
+
+/**
+ * Region work actions wait for each other, so the test would hang if
+ * the regions were processed sequentially
+ */
+struct parallel_def : def::state_machine<parallel_def> {
+    template < typename T >
+    struct region : state_machine<T> {
+        struct meet {
+            template < typename FSM, typename Source, typename Target >
+            void
+            operator()(events::work const&, FSM& fsm, Source&, Target&) const
+            {
+                auto& root = root_machine(fsm);
+                ++root.arrived;
+                while (root.arrived < 3)
+                    ::std::this_thread::yield();
+                root.threads[T::index] = ::std::this_thread::get_id();
+            }
+        };
+        struct fail {
+            template < typename FSM, typename Source, typename Target >
+            void
+            operator()(events::fail const&, FSM&, Source&, Target&) const
+            {
+                if (T::index == 2)
+                    throw ::std::runtime_error{"Region failed"};
+            }
+        };
+        struct idle : def::state<idle> {};
+        struct busy : def::state<busy> {};
+        using initial_state = idle;
+        using transitions = def::transition_table<
+            def::transition< idle, events::work, busy, meet >,
+            def::transition< busy, events::fail, idle, fail >
+        >;
+    };
+    struct region_a : region<region_a> { static constexpr ::std::size_t index = 0; };
+    struct region_b : region<region_b> { static constexpr ::std::size_t index = 1; };
+    struct region_c : region<region_c> { static constexpr ::std::size_t index = 2; };
+
+    struct off : state<off> {};
+    struct on : state_machine<on>, def::tags::parallel_regions {
+        using orthogonal_regions = type_tuple<region_a, region_b, region_c>;
+
+        static thread_per_task&
+        region_executor()
+        {
+            static thread_per_task executor;
+            return executor;
+        }
+    };
+
+    using initial_state = off;
+    using transitions = transition_table<
+        tr< off,    events::power_on,   on  >,
+        tr< on,     events::power_off,  off >
+    >;
+
+    ::std::atomic<int>          arrived{0};
+    ::std::vector< ::std::thread::id > threads = ::std::vector< ::std::thread::id >(3);
+};
+
+using parallel_fsm = state_machine<parallel_def, ::std::mutex>;
+
+static_assert(def::traits::has_parallel_regions<parallel_def::on>::value, "");
+
+}  /* namespace  */
+
+TEST(ParallelRegions, Dispatch)
+{
+    parallel_fsm fsm;
+    EXPECT_EQ(actions::event_process_result::process,
+            fsm.process_event(events::power_on{}));
+    EXPECT_EQ(actions::event_process_result::process,
+            fsm.process_event(events::work{}));
+    EXPECT_EQ(2ul, parallel_def::on::region_executor().posted);
+    EXPECT_EQ(::std::this_thread::get_id(), fsm.threads[0]);
+    EXPECT_NE(::std::this_thread::get_id(), fsm.threads[1]);
+    EXPECT_NE(::std::this_thread::get_id(), fsm.threads[2]);
+    EXPECT_TRUE(fsm.is_in_state<parallel_def::region_c::busy>());
+
+    EXPECT_THROW(fsm.process_event(events::fail{}), ::std::runtime_error)
+            << "Exception from a region is rethrown in the calling thread";
+}
+
+TEST(ParallelRegions, PostFails)
+{
+    auto& executor = parallel_def::on::region_executor();
+    parallel_fsm fsm;
+    fsm.process_event(events::power_on{});
+    fsm.process_event(events::work{});
+    // Region b is posted, posting region c fails
+    executor.limit = executor.posted + 1;
+    EXPECT_THROW(fsm.process_event(events::fail{}), ::std::length_error);
+    executor.limit = static_cast< ::std::size_t >(-1);
+    EXPECT_TRUE(fsm.is_in_state<parallel_def::region_b::idle>())
+            << "The posted region has finished before the exception left";
+    EXPECT_TRUE(fsm.is_in_state<parallel_def::region_c::busy>());
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
@@ -12,6 +12,7 @@
 #include <pushkin/util/demangle.hpp>
 
 #include <iostream>
+#include <memory>
 
 namespace afsm {
 namespace test {
@@ -393,6 +394,114 @@ TEST(Pushdown, EmptyObject)
     EXPECT_TRUE(fsm.is_in_state< json_parser_fsm::context::end >());
 }
 
+namespace events {
+
+struct open {};
+struct close {};
+struct touch {};
+
+}  /* namespace events */
+
+/**
+ * Data held by a state, the use count tells if the state holding it
+ * was reset
+ */
+inline ::std::shared_ptr<int> const&
+held_resource()
+{
+    static ::std::shared_ptr<int> resource = ::std::make_shared<int>(0);
+    return resource;
+}
+
+template < typename ... Tags >
+struct nest_def : def::state_machine< nest_def<Tags...>, Tags... > {
+    using this_type = nest_def<Tags...>;
+    struct idle : def::state<idle> {
+        struct mark {
+            template < typename FSM >
+            void
+            operator()(events::touch const&, FSM&, idle& state, idle&) const
+            {
+                state.touched = true;
+                state.held = held_resource();
+            }
+        };
+        using internal_transitions = def::transition_table<
+            def::internal_transition< events::touch, mark >
+        >;
+        bool touched = false;
+        ::std::shared_ptr<int> held{};
+    };
+    struct inner : def::pushdown< inner, this_type > {};
+    struct done : def::popup< done, this_type > {};
+
+    using initial_state = idle;
+    using transitions = def::transition_table<
+        def::transition< idle,  events::open,   inner   >,
+        def::transition< idle,  events::close,  done    >,
+        def::transition< inner, events::close,  done    >,
+        def::transition< inner, events::open,   inner   >
+    >;
+};
+
+using nest_fsm = state_machine< nest_def<> >;
+using inline_nest_fsm = state_machine< nest_def< def::tags::pushdown_depth<3> > >;
+using compact_nest_fsm = state_machine< nest_def< def::tags::compact_state_storage > >;
+
+static_assert(def::traits::pushdown_depth< nest_def<> >::value == 0, "");
+static_assert(def::traits::pushdown_depth<
+        nest_def< def::tags::pushdown_depth<3> > >::value == 3, "");
+
+template < typename FSM >
+void
+push_pop_reuse()
+{
+    FSM fsm;
+    for (auto i = 0; i < 3; ++i) {
+        EXPECT_TRUE(done(fsm.process_event(events::open{})));
+        EXPECT_TRUE(done(fsm.process_event(events::open{})));
+        EXPECT_EQ(3UL, fsm.stack_size());
+        EXPECT_TRUE(fsm.template is_in_state< typename FSM::idle >());
+        EXPECT_FALSE(fsm.template get_state< typename FSM::idle >().touched)
+                << "A reused frame is reset";
+        fsm.process_event(events::touch{});
+        EXPECT_TRUE(fsm.template get_state< typename FSM::idle >().touched);
+        EXPECT_EQ(2, held_resource().use_count());
+
+        EXPECT_TRUE(done(fsm.process_event(events::close{})));
+        EXPECT_EQ(2UL, fsm.stack_size());
+        EXPECT_EQ(1, held_resource().use_count())
+                << "A popped frame is reset when the transition completes";
+        EXPECT_TRUE(fsm.template is_in_state< typename FSM::inner >());
+        EXPECT_TRUE(done(fsm.process_event(events::close{})));
+        EXPECT_EQ(1UL, fsm.stack_size());
+        EXPECT_TRUE(fsm.template is_in_state< typename FSM::inner >());
+    }
+}
+
+TEST(Pushdown, ReuseFrames)
+{
+    push_pop_reuse< nest_fsm >();
+}
+
+TEST(Pushdown, CompactFrames)
+{
+    push_pop_reuse< compact_nest_fsm >();
+}
+
+TEST(Pushdown, InlineFrames)
+{
+    push_pop_reuse< inline_nest_fsm >();
+
+    inline_nest_fsm fsm;
+    EXPECT_TRUE(done(fsm.process_event(events::open{})));
+    EXPECT_TRUE(done(fsm.process_event(events::open{})));
+    EXPECT_EQ(3UL, fsm.stack_size());
+    EXPECT_THROW(fsm.process_event(events::open{}), ::std::length_error)
+            << "Pushing beyond the declared depth";
+    EXPECT_EQ(3UL, fsm.stack_size());
+}
+
 }  /* namespace test */
 }  /* namespace afsm */
 
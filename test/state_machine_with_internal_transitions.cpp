@@ -17,6 +17,8 @@ namespace events {
 struct a_to_b {};
 struct b_to_a {};
 struct in_state {};
+struct b_to_c {};
+struct c_to_d {};
 
 }  /* namespace events */
 
@@ -49,6 +51,22 @@ struct outer_machine : def::state_machine<outer_machine> {
     >;
 };
 
+struct replay_machine : def::state_machine<replay_machine> {
+    struct state_a : def::state<state_a> {
+        using deferred_events = type_tuple< events::b_to_c, events::c_to_d >;
+    };
+    struct state_b : def::state<state_b> {};
+    struct state_c : def::state<state_c> {};
+    struct state_d : def::state<state_d> {};
+
+    using initial_state = state_a;
+    using transitions           = def::transition_table<
+        tr< state_a,    events::a_to_b,     state_b,    none,   none    >,
+        tr< state_b,    events::b_to_c,     state_c,    none,   none    >,
+        tr< state_c,    events::c_to_d,     state_d,    none,   none    >
+    >;
+};
+
 } /* namespace test */
 // Instantiate it
 template class state_machine<test::outer_machine, none, test::test_fsm_observer>;
@@ -153,6 +171,22 @@ TEST(FSM, MachineWithInstateDefers)
     EXPECT_FALSE(tsm.is_in_state< outer_machine::state_a >());
 }
 
+TEST(FSM, DeferredReplayLeadsToHandlingState)
+{
+    state_machine<replay_machine> tsm;
+    EXPECT_EQ( actions::event_process_result::defer,
+            tsm.process_event(events::b_to_c{}));
+    EXPECT_EQ( actions::event_process_result::defer,
+            tsm.process_event(events::c_to_d{}));
+    // *** A -> B -> C -> D ***
+    // C -> D is neither handled nor deferred in B, it is replayed after
+    // B -> C
+    EXPECT_EQ( actions::event_process_result::process,
+            tsm.process_event(events::a_to_b{}));
+    EXPECT_TRUE(tsm.is_in_state< replay_machine::state_d >());
+    EXPECT_TRUE(tsm.current_deferred_events().empty());
+}
+
 }  /* namespace test */
 }  /* namespace afsm */
 
@@ -0,0 +1,87 @@
+/*
+ * state_reset_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <vector>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct next {};
+
+}  /* namespace events */
+
+namespace {
+
+struct reset_test_def : def::state_machine<reset_test_def> {
+    template < typename T >
+    struct data_state : def::state<T> {
+        template < typename Event, typename FSM >
+        void
+        on_enter(Event&&, FSM&)
+        { data.push_back(data.size()); }
+
+        ::std::vector< ::std::size_t > data{};
+    };
+
+    struct initial : def::state<initial> {};
+    struct reconstructed : data_state<reconstructed> {};
+    struct kept : data_state<kept>, def::tags::no_state_reset {};
+    struct custom : data_state<custom> {
+        void
+        reset()
+        {
+            data.clear();
+            ++reset_count;
+        }
+        ::std::size_t reset_count{0};
+    };
+
+    using initial_state = initial;
+    using transitions = transition_table<
+        tr< initial,        events::next,   reconstructed   >,
+        tr< reconstructed,  events::next,   kept            >,
+        tr< kept,           events::next,   custom          >,
+        tr< custom,         events::next,   initial         >
+    >;
+};
+
+using reset_test_fsm = state_machine<reset_test_def>;
+
+}  /* namespace  */
+
+static_assert(transitions::detail::state_reset_selector<
+        reset_test_fsm::substate_type<reset_test_def::reconstructed> >::value
+            == transitions::detail::state_reset_type::in_place, "");
+static_assert(transitions::detail::state_reset_selector<
+        reset_test_fsm::substate_type<reset_test_def::kept> >::value
+            == transitions::detail::state_reset_type::none, "");
+static_assert(transitions::detail::state_reset_selector<
+        reset_test_fsm::substate_type<reset_test_def::custom> >::value
+            == transitions::detail::state_reset_type::custom, "");
+
+TEST(FSM, StateReset)
+{
+    reset_test_fsm fsm;
+    for (auto i = 0; i < 3; ++i) {
+        for (auto j = 0; j < 4; ++j) {
+            EXPECT_EQ(actions::event_process_result::process,
+                    fsm.process_event(events::next{}));
+        }
+    }
+    EXPECT_TRUE(fsm.is_in_state<reset_test_def::initial>());
+    EXPECT_TRUE(fsm.get_state<reset_test_def::reconstructed>().data.empty());
+    EXPECT_EQ(3ul, fsm.get_state<reset_test_def::kept>().data.size());
+    EXPECT_TRUE(fsm.get_state<reset_test_def::custom>().data.empty());
+    EXPECT_EQ(3ul, fsm.get_state<reset_test_def::custom>().reset_count);
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
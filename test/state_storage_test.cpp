@@ -0,0 +1,245 @@
+/*
+ * state_storage_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: zmij
+ */
+
+#include <gtest/gtest.h>
+#include <afsm/fsm.hpp>
+#include <array>
+#include <stdexcept>
+
+namespace afsm {
+namespace test {
+
+namespace events {
+
+struct next {};
+struct again {};
+struct fail {};
+struct enter_sub {};
+struct leave_sub {};
+struct enter_hist {};
+struct leave_hist {};
+
+}  /* namespace events */
+
+namespace {
+
+int alive = 0;
+
+/**
+ * Counts the live instances
+ */
+template < typename T, ::std::size_t Size >
+struct counted_state : def::state<T> {
+    counted_state() noexcept { ++alive; }
+    counted_state(counted_state const& rhs) noexcept
+        : def::state<T>{rhs}, data{rhs.data}, entries{rhs.entries} { ++alive; }
+    counted_state(counted_state&& rhs) noexcept
+        : def::state<T>{rhs}, data{rhs.data}, entries{rhs.entries} { ++alive; }
+    ~counted_state() { --alive; }
+    counted_state&
+    operator = (counted_state const&) = default;
+
+    template < typename Event, typename FSM >
+    void
+    on_enter(Event&&, FSM&)
+    { ++entries; }
+
+    ::std::array<char, Size>    data{};
+    int                         entries{0};
+};
+
+struct throw_action {
+    template < typename FSM, typename Source, typename Target >
+    void
+    operator()(events::fail const&, FSM&, Source&, Target&) const
+    {
+        throw ::std::runtime_error{"fail"};
+    }
+};
+
+template < typename ... Tags >
+struct inner_def : def::state_machine< inner_def<Tags...>, Tags... > {
+    struct x : counted_state<x, 16> {};
+    struct y : counted_state<y, 32> {};
+    using initial_state = x;
+    using transitions = def::transition_table<
+        def::transition< x, events::next, y >,
+        def::transition< y, events::next, x >
+    >;
+};
+
+template < typename ... Tags >
+struct storage_def : def::state_machine< storage_def<Tags...>, Tags... > {
+    struct a : counted_state<a, 64> {};
+    struct b : counted_state<b, 256> {};
+    struct c : counted_state<c, 128> {};
+    struct kept : def::state<kept>, def::tags::no_state_reset {
+        template < typename Event, typename FSM >
+        void
+        on_enter(Event&&, FSM&)
+        { ++entries; }
+        int entries{0};
+    };
+    using sub = inner_def<Tags...>;
+    using hist = inner_def<def::tags::has_history, Tags...>;
+
+    using initial_state = a;
+    using transitions = def::transition_table<
+        def::transition< a,     events::next,       b               >,
+        def::transition< b,     events::next,       c               >,
+        def::transition< c,     events::next,       kept            >,
+        def::transition< kept,  events::next,       a               >,
+        def::transition< a,     events::again,      a               >,
+        def::transition< a,     events::fail,       b,  throw_action >,
+        def::transition< a,     events::enter_sub,  sub             >,
+        def::transition< sub,   events::leave_sub,  a               >,
+        def::transition< a,     events::enter_hist, hist            >,
+        def::transition< hist,  events::leave_hist, a               >
+    >;
+};
+
+using compact_def = storage_def<def::tags::compact_state_storage>;
+using default_fsm = state_machine< storage_def<> >;
+using compact_fsm = state_machine< compact_def >;
+using strong_compact_fsm = state_machine< storage_def<
+        def::tags::compact_state_storage, def::tags::strong_exception_safety> >;
+
+template < typename FSM, typename State >
+using substate = typename FSM::template substate_type<State>;
+
+/**
+ * The compact storage keeps two slots sized to the largest state reset
+ * when left, so it takes less memory only when that state is smaller than
+ * the other reset states combined. Here the inner machines use compact
+ * storage too and their slots outweigh the saving, the whole machine is
+ * larger than with the default storage.
+ */
+static_assert(sizeof(compact_fsm::transition_tuple) <=
+            2 * sizeof(substate<compact_fsm, compact_def::b>) +
+            sizeof(substate<compact_fsm, compact_def::kept>) +
+            sizeof(substate<compact_fsm, compact_def::hist>) +
+            4 * sizeof(::std::size_t),
+        "Compact storage keeps two slots and the states kept when left");
+static_assert(sizeof(default_fsm::transition_tuple) >=
+            sizeof(substate<default_fsm, storage_def<>::a>) +
+            sizeof(substate<default_fsm, storage_def<>::b>) +
+            sizeof(substate<default_fsm, storage_def<>::c>) +
+            sizeof(substate<default_fsm, storage_def<>::kept>) +
+            sizeof(substate<default_fsm, storage_def<>::sub>) +
+            sizeof(substate<default_fsm, storage_def<>::hist>),
+        "Default storage keeps all the states");
+static_assert(transitions::detail::in_slot<
+        ::psst::meta::index_of<compact_def::b, compact_fsm::inner_states_def>::value,
+        compact_fsm::transition_tuple::slot_states >::value, "");
+static_assert(!transitions::detail::in_slot<
+        ::psst::meta::index_of<compact_def::kept, compact_fsm::inner_states_def>::value,
+        compact_fsm::transition_tuple::slot_states >::value, "");
+
+/**
+ * The active state of the history machine is always alive
+ */
+constexpr int history_alive = 1;
+
+}  /* namespace  */
+
+TEST(StateStorage, OnlyActiveAlive)
+{
+    alive = 0;
+    {
+        compact_fsm fsm;
+        EXPECT_EQ(history_alive + 1, alive);
+        for (auto i = 0; i < 2; ++i) {
+            fsm.process_event(events::next{});
+            EXPECT_TRUE(fsm.is_in_state<compact_fsm::b>());
+            EXPECT_EQ(history_alive + 1, alive);
+            EXPECT_EQ(1, fsm.get_state<compact_fsm::b>().entries)
+                    << "A new instance is entered";
+            fsm.process_event(events::next{});
+            EXPECT_EQ(history_alive + 1, alive);
+            fsm.process_event(events::next{});
+            EXPECT_TRUE(fsm.is_in_state<compact_fsm::kept>());
+            EXPECT_EQ(history_alive, alive);
+            EXPECT_EQ(i + 1, fsm.get_state<compact_fsm::kept>().entries)
+                    << "Kept state is not reset";
+            fsm.process_event(events::next{});
+            EXPECT_TRUE(fsm.is_in_state<compact_fsm::a>());
+            EXPECT_EQ(history_alive + 1, alive);
+        }
+        // Self transition enters a new instance
+        fsm.process_event(events::again{});
+        EXPECT_EQ(history_alive + 1, alive);
+        EXPECT_EQ(1, fsm.get_state<compact_fsm::a>().entries);
+    }
+    EXPECT_EQ(0, alive);
+}
+
+#ifndef NDEBUG
+TEST(StateStorageDeathTest, InactiveState)
+{
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    compact_fsm fsm;
+    EXPECT_DEATH(fsm.get_state<compact_fsm::b>(), "not alive");
+}
+#endif
+
+TEST(StateStorage, InnerMachines)
+{
+    alive = 0;
+    {
+        compact_fsm fsm;
+        fsm.process_event(events::enter_sub{});
+        EXPECT_EQ(history_alive + 1, alive)
+                << "Only the active state of the inner machine";
+        fsm.process_event(events::next{});
+        EXPECT_TRUE(fsm.is_in_state<compact_fsm::sub::y>());
+        EXPECT_EQ(history_alive + 1, alive);
+        fsm.process_event(events::leave_sub{});
+        EXPECT_EQ(history_alive + 1, alive);
+        fsm.process_event(events::enter_sub{});
+        EXPECT_TRUE(fsm.is_in_state<compact_fsm::sub::x>())
+                << "Inner machine is reset";
+        fsm.process_event(events::leave_sub{});
+
+        fsm.process_event(events::enter_hist{});
+        EXPECT_EQ(history_alive, alive);
+        fsm.process_event(events::next{});
+        EXPECT_TRUE(fsm.is_in_state<compact_fsm::hist::y>());
+        fsm.process_event(events::leave_hist{});
+        EXPECT_EQ(history_alive + 1, alive)
+                << "The history machine keeps its active state";
+        fsm.process_event(events::enter_hist{});
+        EXPECT_TRUE(fsm.is_in_state<compact_fsm::hist::y>());
+        EXPECT_EQ(2, fsm.get_state<compact_fsm::hist::y>().entries)
+                << "The state active on exit is entered again";
+    }
+    EXPECT_EQ(0, alive);
+}
+
+TEST(StateStorage, FailedTransition)
+{
+    alive = 0;
+    {
+        compact_fsm fsm;
+        EXPECT_THROW(fsm.process_event(events::fail{}), ::std::runtime_error);
+        EXPECT_TRUE(fsm.is_in_state<compact_fsm::a>());
+        EXPECT_EQ(history_alive + 1, alive) << "The target is destroyed";
+    }
+    EXPECT_EQ(0, alive);
+    {
+        strong_compact_fsm fsm;
+        EXPECT_THROW(fsm.process_event(events::fail{}), ::std::runtime_error);
+        EXPECT_TRUE(fsm.is_in_state<strong_compact_fsm::a>());
+        EXPECT_EQ(history_alive + 1, alive);
+        fsm.process_event(events::next{});
+        EXPECT_TRUE(fsm.is_in_state<strong_compact_fsm::b>());
+        EXPECT_EQ(history_alive + 1, alive);
+    }
+    EXPECT_EQ(0, alive);
+}
+
+}  /* namespace test */
+}  /* namespace afsm */
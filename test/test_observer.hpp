@@ -277,6 +277,17 @@ struct test_fsm_observer : ::afsm::detail::null_observer {
              << ansi_color::clear  << ::std::setfill(' ')
              << ": Drop deferred event\n";
     }
+    template < typename FSM >
+    void
+    drop_queued_event(FSM const&) const noexcept
+    {
+        using ::psst::ansi_color;
+        ::std::cerr
+             << (ansi_color::red | ansi_color::bright)
+             << ::std::setw(event_name_width) << ::std::setfill('*') << "*"
+             << ansi_color::clear  << ::std::setfill(' ')
+             << ": Drop queued event, the queue is full\n";
+    }
 
     template < typename FSM, typename Event >
     void
@@ -292,6 +303,20 @@ struct test_fsm_observer : ::afsm::detail::null_observer {
              << ": Reject event.\n";
     }
 
+    template < typename FSM, typename State >
+    void
+    activity_error(FSM const&, State const&, ::std::exception_ptr const&) const noexcept
+    {
+        using ::psst::ansi_color;
+        using ::psst::util::demangle;
+        ::std::cerr
+             << (ansi_color::red | ansi_color::bright)
+             << ::std::setw(event_name_width) << ::std::left
+             << get_name_components(demangle<State>(), 1)
+             << ansi_color::clear
+             << ": Activity failed.\n";
+    }
+
     ::std::string def_name;
 };
 